@@ -193,6 +193,27 @@ class range_sum
   {
     return ::hpc::max(size_type(1), m_vector.size()) - size_type(1);
   }
+  // raw access to the size()+1 offsets, for bulk I/O
+  pointer
+  data() noexcept
+  {
+    return m_vector.data();
+  }
+  const_pointer
+  data() const noexcept
+  {
+    return m_vector.data();
+  }
+  void
+  resize(size_type count)
+  {
+    m_vector.resize(count + size_type(1));
+  }
+  void
+  clear()
+  {
+    m_vector.clear();
+  }
   template <class RangeSizes>
   void
   assign_sizes(RangeSizes const& sizes)
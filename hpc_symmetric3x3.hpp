@@ -260,6 +260,14 @@ transpose_times_self(matrix3x3<T> const in) noexcept
   return symmetric3x3<decltype(T() * T())>(transpose(in) * in);
 }
 
+template <class T>
+HPC_ALWAYS_INLINE HPC_HOST_DEVICE constexpr auto
+self_outer_product(vector3<T> const in) noexcept
+{
+  return symmetric3x3<decltype(T() * T())>(
+      in(0) * in(0), in(1) * in(1), in(2) * in(2), in(0) * in(1), in(1) * in(2), in(0) * in(2));
+}
+
 template <class L, class R>
 HPC_ALWAYS_INLINE HPC_HOST_DEVICE constexpr auto
 operator*(symmetric3x3<L> const left, vector3<R> const right) noexcept
@@ -397,6 +405,76 @@ HPC_ALWAYS_INLINE HPC_HOST_DEVICE constexpr symmetric3x3<T>
   return top / determinant(x);
 }
 
+// LDL^T factors of a symmetric 3x3 matrix: the pivots and the strictly lower
+// part of the unit triangular L. No pivoting, so only for positive definite A.
+template <class T>
+struct ldlt3x3
+{
+  T                                        d0, d1, d2;
+  std::remove_const_t<decltype(T() / T())> l10, l20, l21;
+  // all pivots safely above round-off relative to the diagonal
+  bool positive;
+};
+
+template <class T>
+HPC_ALWAYS_INLINE HPC_HOST_DEVICE constexpr ldlt3x3<T>
+                  ldlt(symmetric3x3<T> const& A) noexcept
+{
+  ldlt3x3<T> f{};
+  f.d0           = A(S_XX);
+  f.l10          = A(S_XY) / f.d0;
+  f.l20          = A(S_XZ) / f.d0;
+  f.d1           = A(S_YY) - f.l10 * A(S_XY);
+  f.l21          = (A(S_YZ) - f.l20 * A(S_XY)) / f.d1;
+  f.d2           = A(S_ZZ) - f.l20 * A(S_XZ) - f.l21 * f.l21 * f.d1;
+  auto const tol = 64.0 * machine_epsilon<double>() * trace(A);
+  f.positive     = f.d0 > tol && f.d1 > tol && f.d2 > tol;
+  return f;
+}
+
+// Solve for symmetric positive definite A by LDL^T, a fixed sequence of
+// operations with no pivot search. Near-singular or indefinite A, whose
+// pivots are not safely positive, go to solve_full_pivot instead.
+template <typename T>
+HPC_HOST_DEVICE constexpr auto
+solve_spd(symmetric3x3<T> const& A, vector3<T> const& b)
+{
+  auto const f = ldlt(A);
+  if (!f.positive) return solve_full_pivot(A.full(), b);
+  auto const y0 = b(0);
+  auto const y1 = b(1) - f.l10 * y0;
+  auto const y2 = b(2) - f.l20 * y0 - f.l21 * y1;
+  auto const x2 = y2 / f.d2;
+  auto const x1 = y1 / f.d1 - f.l21 * x2;
+  auto const x0 = y0 / f.d0 - f.l10 * x1 - f.l20 * x2;
+  return decltype(solve_full_pivot(A.full(), b))(x0, x1, x2);
+}
+
+// Inverse of symmetric positive definite A as L^-T D^-1 L^-1, with the same
+// fallback to full pivoting as solve_spd.
+template <typename T>
+HPC_HOST_DEVICE constexpr auto
+inverse_spd(symmetric3x3<T> const& A)
+{
+  using result_type = symmetric3x3<std::remove_const_t<decltype(1.0 / T())>>;
+  auto const f      = ldlt(A);
+  if (!f.positive) return result_type(inverse_full_pivot(A.full()));
+  // unit lower triangular L^-1
+  auto const m10 = -f.l10;
+  auto const m21 = -f.l21;
+  auto const m20 = f.l21 * f.l10 - f.l20;
+  auto const e0  = 1.0 / f.d0;
+  auto const e1  = 1.0 / f.d1;
+  auto const e2  = 1.0 / f.d2;
+  return result_type(
+      e0 + m10 * m10 * e1 + m20 * m20 * e2,
+      e1 + m21 * m21 * e2,
+      e2,
+      m10 * e1 + m20 * m21 * e2,
+      m21 * e2,
+      m20 * e2);
+}
+
 template <class T>
 class array_traits<symmetric3x3<T>>
 {
@@ -42,8 +42,8 @@ class vector3
   {
     return raw[weaken(i)];
   }
-  HPC_ALWAYS_INLINE HPC_HOST_DEVICE scalar_type&
-                                    operator()(axis_index const i) noexcept
+  HPC_ALWAYS_INLINE HPC_HOST_DEVICE constexpr scalar_type&
+                                              operator()(axis_index const i) noexcept
   {
     return raw[weaken(i)];
   }
@@ -1,3 +1,4 @@
+#include <hpc_atomic.hpp>
 #include <hpc_functional.hpp>
 #include <iomanip>
 #include <iostream>
@@ -50,8 +51,9 @@ inline HPC_HOST_DEVICE hpc::adimensional<double>
   return triangle_quality(triangle_basis_gradients(x, area), area);
 }
 
-HPC_NOINLINE inline void
-update_triangle_quality(state& s) noexcept
+template <class Elements>
+HPC_NOINLINE void
+update_triangle_quality(state& s, Elements const& elements) noexcept
 {
   auto const points_to_V           = s.V.cbegin();
   auto const point_nodes_to_grad_N = s.grad_N.cbegin();
@@ -69,7 +71,7 @@ update_triangle_quality(state& s) noexcept
     auto const fast_quality      = triangle_quality(grad_N, A);
     elements_to_quality[element] = fast_quality;
   };
-  hpc::for_each(hpc::device_policy(), s.elements, functor);
+  hpc::for_each(hpc::device_policy(), elements, functor);
 }
 
 /* Per:
@@ -91,8 +93,9 @@ update_triangle_quality(state& s) noexcept
    As such, our "quality" is the inverse of this quality measure to the fourth
    power
   */
-HPC_NOINLINE inline void
-update_tetrahedron_quality(state& s)
+template <class Elements>
+HPC_NOINLINE void
+update_tetrahedron_quality(state& s, Elements const& elements)
 {
   auto const points_to_V           = s.V.cbegin();
   auto const point_nodes_to_grad_N = s.grad_N.cbegin();
@@ -113,7 +116,21 @@ update_tetrahedron_quality(state& s)
     auto const V                 = points_to_V[point];
     elements_to_quality[element] = (V * V) * (sum_g_i_sq * sum_g_i_sq * sum_g_i_sq);
   };
-  hpc::for_each(hpc::device_policy(), s.elements, functor);
+  hpc::for_each(hpc::device_policy(), elements, functor);
+}
+
+// The measure above from node positions, normalized so that a regular
+// tetrahedron has quality 1, larger is better; -1 if inverted.
+inline HPC_HOST_DEVICE hpc::adimensional<double>
+                       tetrahedron_quality(hpc::array<hpc::position<double>, 4> const x) noexcept
+{
+  auto const volume = tetrahedron_volume(x);
+  if (volume <= 0.0) return -1.0;
+  auto const                          grad_N     = tetrahedron_basis_gradients(x, volume);
+  decltype(1.0 / hpc::area<double>()) sum_g_i_sq = 0.0;
+  for (int i = 0; i < 4; ++i) { sum_g_i_sq += grad_N[i] * grad_N[i]; }
+  double const inverse_q4 = double((volume * volume) * (sum_g_i_sq * sum_g_i_sq * sum_g_i_sq)) / 3.0;
+  return 1.0 / std::sqrt(std::sqrt(inverse_q4));
 }
 
 void
@@ -121,8 +138,19 @@ update_quality(input const& in, state& s)
 {
   switch (in.element) {
     case BAR: update_bar_quality(s); break;
-    case TRIANGLE: update_triangle_quality(s); break;
-    case TETRAHEDRON: update_tetrahedron_quality(s); break;
+    case TRIANGLE: update_triangle_quality(s, s.elements); break;
+    case TETRAHEDRON: update_tetrahedron_quality(s, s.elements); break;
+    case COMPOSITE_TETRAHEDRON: assert(0); break;
+  }
+}
+
+void
+update_quality(input const& in, state& s, element_list const elements)
+{
+  switch (in.element) {
+    case TRIANGLE: update_triangle_quality(s, elements); break;
+    case TETRAHEDRON: update_tetrahedron_quality(s, elements); break;
+    case BAR:
     case COMPOSITE_TETRAHEDRON: assert(0); break;
   }
 }
@@ -189,6 +217,8 @@ struct adapt_state
   hpc::device_vector<double, node_index>                               criteria;
   hpc::device_vector<node_index, node_index>                           other_node;
   hpc::device_vector<cavity_op, node_index>                            op;
+  hpc::device_vector<bool, node_index>                                 is_chosen;
+  hpc::device_vector<bool, node_index>                                 is_round_winner;
   hpc::device_vector<element_index, element_index>                     element_counts;
   hpc::device_vector<node_index, node_index>                           node_counts;
   hpc::device_vector<element_index, element_index>                     old_elements_to_new_elements;
@@ -208,6 +238,8 @@ adapt_state::adapt_state(state const& s)
     : criteria(s.nodes.size()),
       other_node(s.nodes.size()),
       op(s.nodes.size()),
+      is_chosen(s.nodes.size()),
+      is_round_winner(s.nodes.size()),
       element_counts(s.elements.size()),
       node_counts(s.nodes.size()),
       old_elements_to_new_elements(s.elements.size() + element_index(1)),
@@ -235,6 +267,19 @@ find_or_append(int& count, hpc::array<Index, Capacity>& buffer, Index const inde
   return count++;
 }
 
+// like find_or_append, but returns -1 instead of overflowing the buffer
+template <std::ptrdiff_t Capacity, class Index>
+inline HPC_HOST_DEVICE int
+try_find_or_append(int& count, hpc::array<Index, Capacity>& buffer, Index const index)
+{
+  for (int i = 0; i < count; ++i) {
+    if (buffer[i] == index) return i;
+  }
+  if (count == Capacity) return -1;
+  buffer[count] = index;
+  return count++;
+}
+
 template <int nodes_per_element, int max_shell_elements, int max_shell_nodes>
 struct eval_cavity
 {
@@ -398,8 +443,250 @@ evaluate_triangle_collapse(
   }
 }
 
-HPC_NOINLINE inline void
-evaluate_triangle_adapt(input const& in, state const& s, adapt_state& a)
+// best operation found so far for one cavity
+struct cavity_choice
+{
+  hpc::adimensional<double> best_swap_improvement   = 0.0;
+  int                       best_swap_edge_node     = -1;
+  hpc::adimensional<double> longest_split_edge      = 0.0;
+  int                       best_split_edge_node    = -1;
+  hpc::adimensional<double> shortest_collapse_edge  = 1.0;
+  int                       best_collapse_edge_node = -1;
+};
+
+template <int max_shell_elements, int max_shell_nodes>
+inline HPC_DEVICE void
+evaluate_cavity_edges(
+    eval_cavity<3, max_shell_elements, max_shell_nodes> const& c,
+    int const                                                  center_node,
+    material_set const                                         boundary_materials,
+    cavity_choice&                                             choice)
+{
+  for (int edge_node = 0; edge_node < c.num_shell_nodes; ++edge_node) {
+    if (edge_node == center_node) continue;
+    if (c.shell_nodes[center_node] < c.shell_nodes[edge_node]) {
+      // swaps and splits are non-directional, they only need to be
+      // examined by one of the nodes
+      evaluate_triangle_swap(center_node, edge_node, c, choice.best_swap_improvement, choice.best_swap_edge_node);
+      evaluate_triangle_split(center_node, edge_node, c, choice.longest_split_edge, choice.best_split_edge_node);
+    }
+    evaluate_triangle_collapse(
+        center_node,
+        edge_node,
+        c,
+        boundary_materials,
+        choice.shortest_collapse_edge,
+        choice.best_collapse_edge_node);
+  }
+}
+
+template <int max_shell_elements, int max_shell_nodes>
+inline HPC_DEVICE hpc::array<hpc::position<double>, 4>
+shell_element_x(eval_cavity<4, max_shell_elements, max_shell_nodes> const& c, int const element)
+{
+  hpc::array<hpc::position<double>, 4> x;
+  for (int i = 0; i < 4; ++i) { x[i] = c.shell_nodes_to_x[c.shell_elements_to_shell_nodes[element][i]]; }
+  return x;
+}
+
+template <int max_shell_elements, int max_shell_nodes>
+inline HPC_DEVICE bool
+shell_element_has_node(eval_cavity<4, max_shell_elements, max_shell_nodes> const& c, int const element, int const node)
+{
+  for (int i = 0; i < 4; ++i) {
+    if (c.shell_elements_to_shell_nodes[element][i] == node) return true;
+  }
+  return false;
+}
+
+/* The 3-2 edge swap: an interior edge shared by exactly three tetrahedra
+   is replaced by the triangle through the other three nodes, leaving two
+   tetrahedra. This is the flip that removes most slivers. */
+template <int max_shell_elements, int max_shell_nodes>
+inline HPC_DEVICE void
+evaluate_tetrahedron_swap(
+    int const                                                  center_node,
+    int const                                                  edge_node,
+    eval_cavity<4, max_shell_elements, max_shell_nodes> const& c,
+    hpc::adimensional<double>&                                 best_improvement,
+    int&                                                       best_swap_edge_node)
+{
+  hpc::array<int, 3> edge_elements;
+  int                num_edge_elements = 0;
+  hpc::array<int, 3> ring_nodes;
+  int                num_ring_nodes = 0;
+  for (int element = 0; element < c.num_shell_elements; ++element) {
+    if (!shell_element_has_node(c, element, edge_node)) continue;
+    if (num_edge_elements == 3) return;
+    edge_elements[num_edge_elements++] = element;
+    for (int node_in_element = 0; node_in_element < 4; ++node_in_element) {
+      int const shell_node = c.shell_elements_to_shell_nodes[element][node_in_element];
+      if (shell_node == center_node || shell_node == edge_node) continue;
+      if (try_find_or_append(num_ring_nodes, ring_nodes, shell_node) == -1) return;
+    }
+  }
+  if (num_edge_elements != 3 || num_ring_nodes != 3) return;
+  auto const material = c.shell_elements_to_materials[edge_elements[0]];
+  if (c.shell_elements_to_materials[edge_elements[1]] != material) return;
+  if (c.shell_elements_to_materials[edge_elements[2]] != material) return;
+  hpc::adimensional<double> quality_before = 1.0;
+  for (int i = 0; i < 3; ++i) {
+    quality_before = hpc::min(quality_before, tetrahedron_quality(shell_element_x(c, edge_elements[i])));
+  }
+  if (quality_before <= 0.0) return;
+  hpc::array<hpc::position<double>, 4> proposed_x;
+  proposed_x[0] = c.shell_nodes_to_x[ring_nodes[0]];
+  proposed_x[1] = c.shell_nodes_to_x[ring_nodes[1]];
+  proposed_x[2] = c.shell_nodes_to_x[ring_nodes[2]];
+  proposed_x[3] = c.shell_nodes_to_x[center_node];
+  if (tetrahedron_volume(proposed_x) < 0.0) hpc::swap(proposed_x[1], proposed_x[2]);
+  auto const new_quality1 = tetrahedron_quality(proposed_x);
+  if (new_quality1 <= quality_before) return;
+  hpc::swap(proposed_x[1], proposed_x[2]);
+  proposed_x[3]           = c.shell_nodes_to_x[edge_node];
+  auto const new_quality2 = tetrahedron_quality(proposed_x);
+  if (new_quality2 <= quality_before) return;
+  auto const quality_after = hpc::min(new_quality1, new_quality2);
+  auto const improvement   = ((quality_after - quality_before) / quality_before);
+  if (improvement < 0.05) return;
+  if (improvement > best_improvement) {
+    best_improvement    = improvement;
+    best_swap_edge_node = edge_node;
+  }
+}
+
+template <int max_shell_elements, int max_shell_nodes>
+inline HPC_DEVICE void
+evaluate_tetrahedron_split(
+    int const                                                  center_node,
+    int const                                                  edge_node,
+    eval_cavity<4, max_shell_elements, max_shell_nodes> const& c,
+    hpc::adimensional<double>&                                 longest_length,
+    int&                                                       best_split_edge_node)
+{
+  constexpr double min_acceptable_quality = 0.2;
+  auto const       h1                     = c.shell_nodes_to_h[center_node];
+  auto const       h2                     = c.shell_nodes_to_h[edge_node];
+  auto const       x1                     = c.shell_nodes_to_x[center_node];
+  auto const       x2                     = c.shell_nodes_to_x[edge_node];
+  auto const       h_min                  = hpc::min(h1, h2);
+  auto const       h_max                  = hpc::max(h1, h2);
+  auto const       l                      = norm(x1 - x2);
+  auto const       lm                     = measure_edge(h_min, h_max, l);
+  if (lm <= std::sqrt(2.0)) return;
+  if (lm <= longest_length) return;
+  auto const midpoint_x = 0.5 * (x1 + x2);
+  for (int element = 0; element < c.num_shell_elements; ++element) {
+    int const center_node_in_element = c.shell_elements_to_node_in_element[element];
+    int       edge_node_in_element   = -1;
+    for (int node_in_element = 0; node_in_element < 4; ++node_in_element) {
+      if (c.shell_elements_to_shell_nodes[element][node_in_element] == edge_node) {
+        edge_node_in_element = node_in_element;
+      }
+    }
+    if (edge_node_in_element == -1) continue;
+    auto child_x                    = shell_element_x(c, element);
+    child_x[center_node_in_element] = midpoint_x;
+    auto const new_quality1         = tetrahedron_quality(child_x);
+    if (new_quality1 < min_acceptable_quality) return;
+    child_x[center_node_in_element] = x1;
+    child_x[edge_node_in_element]   = midpoint_x;
+    auto const new_quality2         = tetrahedron_quality(child_x);
+    if (new_quality2 < min_acceptable_quality) return;
+  }
+  longest_length       = lm;
+  best_split_edge_node = edge_node;
+}
+
+/* Collapses short edges to coarsen, and also any edge of a sliver around the
+   center node (which removes the sliver) as long as every remaining element
+   ends up of acceptable quality. */
+template <int max_shell_elements, int max_shell_nodes>
+inline HPC_DEVICE void
+evaluate_tetrahedron_collapse(
+    int const                                                  center_node,
+    int const                                                  edge_node,
+    eval_cavity<4, max_shell_elements, max_shell_nodes> const& c,
+    material_set const                                         boundary_materials,
+    hpc::adimensional<double>&                                 shortest_length,
+    int&                                                       best_collapse_edge_node)
+{
+  if (!c.shell_nodes_to_materials[edge_node].contains(c.shell_nodes_to_materials[center_node])) return;
+  constexpr double min_acceptable_quality = 0.2;
+  constexpr double sliver_quality         = 0.1;
+  auto const       h1                     = c.shell_nodes_to_h[center_node];
+  auto const       h2                     = c.shell_nodes_to_h[edge_node];
+  auto const       x1                     = c.shell_nodes_to_x[center_node];
+  auto const       x2                     = c.shell_nodes_to_x[edge_node];
+  auto const       h_min                  = hpc::min(h1, h2);
+  auto const       h_max                  = hpc::max(h1, h2);
+  auto const       l                      = norm(x1 - x2);
+  auto const       lm                     = measure_edge(h_min, h_max, l);
+  if (lm >= shortest_length) { return; }
+  auto edge_materials = material_set::none();
+  bool removes_sliver = false;
+  for (int element = 0; element < c.num_shell_elements; ++element) {
+    material_index const element_material = c.shell_elements_to_materials[element];
+    edge_materials                        = edge_materials | material_set(element_material);
+    auto proposed_x                       = shell_element_x(c, element);
+    if (shell_element_has_node(c, element, edge_node)) {
+      removes_sliver = removes_sliver || (tetrahedron_quality(proposed_x) < sliver_quality);
+      continue;
+    }
+    proposed_x[c.shell_elements_to_node_in_element[element]] = x2;
+    auto const new_quality                                   = tetrahedron_quality(proposed_x);
+    if (new_quality < min_acceptable_quality) { return; }
+  }
+  if (lm >= (1.0 / std::sqrt(2.0)) && !removes_sliver) { return; }
+  // every other node must keep an element, or it would be left orphaned
+  for (int shell_node = 0; shell_node < c.num_shell_nodes; ++shell_node) {
+    if (shell_node == center_node || shell_node == edge_node) continue;
+    bool is_kept = false;
+    for (int element = 0; element < c.num_shell_elements; ++element) {
+      if (!shell_element_has_node(c, element, edge_node) && shell_element_has_node(c, element, shell_node)) {
+        is_kept = true;
+        break;
+      }
+    }
+    if (!is_kept) { return; }
+  }
+  auto const center_materials = c.shell_nodes_to_materials[center_node];
+  auto const target_materials = c.shell_nodes_to_materials[edge_node];
+  if ((center_materials - boundary_materials) == edge_materials && target_materials.contains(center_materials)) {
+    shortest_length         = lm;
+    best_collapse_edge_node = edge_node;
+  }
+}
+
+template <int max_shell_elements, int max_shell_nodes>
+inline HPC_DEVICE void
+evaluate_cavity_edges(
+    eval_cavity<4, max_shell_elements, max_shell_nodes> const& c,
+    int const                                                  center_node,
+    material_set const                                         boundary_materials,
+    cavity_choice&                                             choice)
+{
+  // sliver collapses may be longer than the usual collapse threshold
+  choice.shortest_collapse_edge = hpc::numeric_limits<double>::max();
+  for (int edge_node = 0; edge_node < c.num_shell_nodes; ++edge_node) {
+    if (edge_node == center_node) continue;
+    if (c.shell_nodes[center_node] < c.shell_nodes[edge_node]) {
+      evaluate_tetrahedron_swap(center_node, edge_node, c, choice.best_swap_improvement, choice.best_swap_edge_node);
+      evaluate_tetrahedron_split(center_node, edge_node, c, choice.longest_split_edge, choice.best_split_edge_node);
+    }
+    evaluate_tetrahedron_collapse(
+        center_node,
+        edge_node,
+        c,
+        boundary_materials,
+        choice.shortest_collapse_edge,
+        choice.best_collapse_edge_node);
+  }
+}
+
+template <int nodes_per_element, int max_shell_elements, int max_shell_nodes>
+HPC_NOINLINE void
+evaluate_adapt(input const& in, state const& s, adapt_state& a)
 {
   auto const nodes_to_node_elements           = s.nodes_to_node_elements.cbegin();
   auto const node_elements_to_elements        = s.node_elements_to_elements.cbegin();
@@ -418,7 +705,11 @@ evaluate_triangle_adapt(input const& in, state const& s, adapt_state& a)
   auto const boundary_materials =
       material_set::all(in.materials.size() + in.boundaries.size()) - material_set::all(in.materials.size());
   auto functor = [=] HPC_DEVICE(node_index const node) {
-    eval_cavity<3, 32, 32> c;
+    nodes_to_other_nodes[node] = node_index(-1);
+    nodes_to_op[node]          = cavity_op::NONE;
+    // cavities too large for the buffers are left alone
+    if (nodes_to_node_elements[node].size() > node_element_index(max_shell_elements)) return;
+    eval_cavity<nodes_per_element, max_shell_elements, max_shell_nodes> c;
     c.num_shell_nodes    = 0;
     c.num_shell_elements = 0;
     int center_node      = -1;
@@ -430,7 +721,8 @@ evaluate_triangle_adapt(input const& in, state const& s, adapt_state& a)
       for (auto const node_in_element : nodes_in_element) {
         element_node_index const element_node = element_nodes[node_in_element];
         node_index const         node2        = element_nodes_to_nodes[element_node];
-        int const                shell_node   = find_or_append(c.num_shell_nodes, c.shell_nodes, node2);
+        int const                shell_node   = try_find_or_append(c.num_shell_nodes, c.shell_nodes, node2);
+        if (shell_node == -1) return;
         if (node2 == node) center_node = shell_node;
         if (shell_node + 1 == c.num_shell_nodes) {
           c.shell_nodes_to_x[shell_node]         = nodes_to_x[node2].load();
@@ -446,88 +738,131 @@ evaluate_triangle_adapt(input const& in, state const& s, adapt_state& a)
       node_in_element_index const node_in_element        = node_elements_to_node_in_element[node_element];
       c.shell_elements_to_node_in_element[shell_element] = hpc::weaken(node_in_element);
     }
-    hpc::adimensional<double> best_swap_improvement   = 0.0;
-    int                       best_swap_edge_node     = -1;
-    hpc::adimensional<double> longest_split_edge      = 0.0;
-    int                       best_split_edge_node    = -1;
-    hpc::adimensional<double> shortest_collapse_edge  = 1.0;
-    int                       best_collapse_edge_node = -1;
-    for (int edge_node = 0; edge_node < c.num_shell_nodes; ++edge_node) {
-      if (edge_node == center_node) continue;
-      if (c.shell_nodes[center_node] < c.shell_nodes[edge_node]) {
-        // swaps and splits are non-directional, they only need to be
-        // examined by one of the nodes
-        evaluate_triangle_swap(center_node, edge_node, c, best_swap_improvement, best_swap_edge_node);
-        evaluate_triangle_split(center_node, edge_node, c, longest_split_edge, best_split_edge_node);
-      }
-      evaluate_triangle_collapse(
-          center_node, edge_node, c, boundary_materials, shortest_collapse_edge, best_collapse_edge_node);
-    }
-    if (best_collapse_edge_node != -1) {
-      nodes_to_criteria[node]    = double(1.0 / shortest_collapse_edge);
-      nodes_to_other_nodes[node] = c.shell_nodes[best_collapse_edge_node];
+    cavity_choice choice;
+    evaluate_cavity_edges(c, center_node, boundary_materials, choice);
+    if (choice.best_collapse_edge_node != -1) {
+      nodes_to_criteria[node]    = double(1.0 / choice.shortest_collapse_edge);
+      nodes_to_other_nodes[node] = c.shell_nodes[choice.best_collapse_edge_node];
       nodes_to_op[node]          = cavity_op::COLLAPSE;
-    } else if (best_split_edge_node != -1) {
-      nodes_to_criteria[node]    = double(longest_split_edge);
-      nodes_to_other_nodes[node] = c.shell_nodes[best_split_edge_node];
+    } else if (choice.best_split_edge_node != -1) {
+      nodes_to_criteria[node]    = double(choice.longest_split_edge);
+      nodes_to_other_nodes[node] = c.shell_nodes[choice.best_split_edge_node];
       nodes_to_op[node]          = cavity_op::SPLIT;
-    } else if (best_swap_edge_node != -1) {
-      nodes_to_criteria[node]    = double(best_swap_improvement);
-      nodes_to_other_nodes[node] = c.shell_nodes[best_swap_edge_node];
+    } else if (choice.best_swap_edge_node != -1) {
+      nodes_to_criteria[node]    = double(choice.best_swap_improvement);
+      nodes_to_other_nodes[node] = c.shell_nodes[choice.best_swap_edge_node];
       nodes_to_op[node]          = cavity_op::SWAP;
-    } else {
-      nodes_to_other_nodes[node] = node_index(-1);
-      nodes_to_op[node]          = cavity_op::NONE;
     }
   };
   hpc::for_each(hpc::device_policy(), s.nodes, functor);
 }
 
+// whether the cavity of a node takes precedence over the one of an adjacent node
+HPC_HOST_DEVICE inline bool
+is_preferred(
+    cavity_op const  op,
+    double const     criteria,
+    node_index const node,
+    cavity_op const  adj_op,
+    double const     adj_criteria,
+    node_index const adj_node)
+{
+  if (op != adj_op) return op > adj_op;
+  if (criteria != adj_criteria) return criteria > adj_criteria;
+  return node < adj_node;
+}
+
+/* One round of the independent set selection: an undecided cavity wins if it
+   is preferred over all of its undecided neighbors. Winners are chosen, and
+   the undecided neighbors of winners drop out. */
 HPC_NOINLINE inline void
-choose_triangle_adapt(state const& s, adapt_state& a)
+choose_round_winners(state const& s, adapt_state& a)
 {
   auto const nodes_to_node_elements    = s.nodes_to_node_elements.cbegin();
   auto const node_elements_to_elements = s.node_elements_to_elements.cbegin();
   auto const elements_to_element_nodes = s.elements * s.nodes_in_element;
   auto const element_nodes_to_nodes    = s.elements_to_nodes.cbegin();
   auto const nodes_to_criteria         = a.criteria.cbegin();
+  auto const nodes_in_element          = s.nodes_in_element;
+  auto const nodes_to_op               = a.op.begin();
+  auto const nodes_are_chosen          = a.is_chosen.begin();
+  auto const nodes_are_round_winners   = a.is_round_winner.begin();
+  auto       winners_functor           = [=] HPC_DEVICE(node_index const node) {
+    cavity_op const op        = nodes_to_op[node];
+    bool            is_winner = (op != cavity_op::NONE) && !nodes_are_chosen[node];
+    if (is_winner) {
+      double const criteria = nodes_to_criteria[node];
+      for (auto const node_element : nodes_to_node_elements[node]) {
+        element_index const element       = node_elements_to_elements[node_element];
+        auto const          element_nodes = elements_to_element_nodes[element];
+        for (auto const node_in_element : nodes_in_element) {
+          node_index const adj_node = element_nodes_to_nodes[element_nodes[node_in_element]];
+          if (adj_node == node || nodes_are_chosen[adj_node]) continue;
+          cavity_op const adj_op = nodes_to_op[adj_node];
+          if (adj_op == cavity_op::NONE) continue;
+          if (is_preferred(adj_op, nodes_to_criteria[adj_node], adj_node, op, criteria, node)) is_winner = false;
+        }
+      }
+    }
+    nodes_are_round_winners[node] = is_winner;
+  };
+  hpc::for_each(hpc::device_policy(), s.nodes, winners_functor);
+  auto losers_functor = [=] HPC_DEVICE(node_index const node) {
+    if (nodes_to_op[node] == cavity_op::NONE || nodes_are_chosen[node]) return;
+    if (nodes_are_round_winners[node]) {
+      nodes_are_chosen[node] = true;
+      return;
+    }
+    for (auto const node_element : nodes_to_node_elements[node]) {
+      element_index const element       = node_elements_to_elements[node_element];
+      auto const          element_nodes = elements_to_element_nodes[element];
+      for (auto const node_in_element : nodes_in_element) {
+        node_index const adj_node = element_nodes_to_nodes[element_nodes[node_in_element]];
+        if (nodes_are_round_winners[adj_node]) {
+          nodes_to_op[node] = cavity_op::NONE;
+          return;
+        }
+      }
+    }
+  };
+  hpc::for_each(hpc::device_policy(), s.nodes, losers_functor);
+}
+
+/* Picks a maximal set of non-adjacent cavities, Luby style: cavities that
+   lose a round compete again in the next one, once the neighborhoods of the
+   winners are excluded. Only the chosen cavities keep their op. */
+HPC_NOINLINE inline void
+choose_independent_cavities(state const& s, adapt_state& a)
+{
+  hpc::fill(hpc::device_policy(), a.is_chosen, false);
+  auto const nodes_to_op      = a.op.cbegin();
+  auto const nodes_are_chosen = a.is_chosen.cbegin();
+  auto       is_undecided     = [=] HPC_DEVICE(node_index const node) {
+    return (nodes_to_op[node] != cavity_op::NONE && !nodes_are_chosen[node]) ? 1 : 0;
+  };
+  while (hpc::transform_reduce(hpc::device_policy(), s.nodes, int(0), hpc::plus<int>(), is_undecided) > 0) {
+    choose_round_winners(s, a);
+  }
+}
+
+HPC_NOINLINE inline void
+choose_adapt(state const& s, adapt_state& a)
+{
+  choose_independent_cavities(s, a);
+  auto const nodes_to_node_elements    = s.nodes_to_node_elements.cbegin();
+  auto const node_elements_to_elements = s.node_elements_to_elements.cbegin();
+  auto const elements_to_element_nodes = s.elements * s.nodes_in_element;
+  auto const element_nodes_to_nodes    = s.elements_to_nodes.cbegin();
   auto const nodes_to_other_nodes      = a.other_node.cbegin();
   auto const nodes_in_element          = s.nodes_in_element;
   hpc::fill(hpc::device_policy(), a.element_counts, element_index(1));
   hpc::fill(hpc::device_policy(), a.node_counts, node_index(1));
   auto const elements_to_new_counts = a.element_counts.begin();
   auto const nodes_to_new_counts    = a.node_counts.begin();
-  auto const nodes_to_op            = a.op.begin();
+  auto const nodes_to_op            = a.op.cbegin();
   auto       functor                = [=] HPC_DEVICE(node_index const node) {
     cavity_op const op = nodes_to_op[node];
     if (op == cavity_op::NONE) { return; }
-    double const criteria = nodes_to_criteria[node];
-    for (auto const node_element : nodes_to_node_elements[node]) {
-      element_index const element       = node_elements_to_elements[node_element];
-      auto const          element_nodes = elements_to_element_nodes[element];
-      for (auto const node_in_element : nodes_in_element) {
-        element_node_index const element_node = element_nodes[node_in_element];
-        node_index const         adj_node     = element_nodes_to_nodes[element_node];
-        if (adj_node != node) {
-          cavity_op const adj_op       = nodes_to_op[adj_node];
-          double const    adj_criteria = nodes_to_criteria[adj_node];
-          if (op < adj_op) {
-            nodes_to_op[node] = cavity_op::NONE;
-            return;
-          }
-          if (op > adj_op) continue;
-          if (criteria < adj_criteria) {
-            nodes_to_op[node] = cavity_op::NONE;
-            return;
-          }
-          if (criteria > adj_criteria) continue;
-          if (adj_node < node) {
-            nodes_to_op[node] = cavity_op::NONE;
-            return;
-          }
-        }
-      }
-    }
     element_index edge_element_count(-100);
     if (op == cavity_op::SWAP) {
       edge_element_count = element_index(1);
@@ -537,6 +872,8 @@ choose_triangle_adapt(state const& s, adapt_state& a)
       edge_element_count = element_index(0);
     }
     node_index const target_node = nodes_to_other_nodes[node];
+    // the 3-2 tetrahedron swap drops the edge element with the highest index
+    element_index dropped_element(-1);
     for (auto const node_element : nodes_to_node_elements[node]) {
       element_index const element       = node_elements_to_elements[node_element];
       auto const          element_nodes = elements_to_element_nodes[element];
@@ -545,9 +882,13 @@ choose_triangle_adapt(state const& s, adapt_state& a)
         node_index const         adj_node     = element_nodes_to_nodes[element_node];
         if (adj_node == target_node) {  // element is adjacent to the edge
           elements_to_new_counts[element] = edge_element_count;
+          dropped_element                 = hpc::max(dropped_element, element);
         }
       }
     }
+    if (op == cavity_op::SWAP && nodes_in_element.size() == node_in_element_index(4)) {
+      elements_to_new_counts[dropped_element] = element_index(0);
+    }
     node_index node_count(-100);
     if (op == cavity_op::SWAP) {
       node_count = node_index(1);
@@ -577,6 +918,7 @@ struct apply_cavity
   hpc::counting_range<node_in_element_index>                                      nodes_in_element;
   hpc::pointer_iterator<bool, node_index>                                         new_nodes_are_same;
   hpc::array_vector_iterator<hpc::array<node_index, 2, int>, hpc::device_layout, node_index> interpolate_from;
+  decltype(std::declval<state const&>().x.cbegin())                                          nodes_to_x;
   apply_cavity(state const& s, adapt_state& a)
       : nodes_to_node_elements(s.nodes_to_node_elements.cbegin()),
         node_elements_to_elements(s.node_elements_to_elements.cbegin()),
@@ -591,7 +933,8 @@ struct apply_cavity
         nodes_to_other_nodes(a.other_node.cbegin()),
         nodes_in_element(s.nodes_in_element),
         new_nodes_are_same(a.new_nodes_are_same.begin()),
-        interpolate_from(a.interpolate_from.begin())
+        interpolate_from(a.interpolate_from.begin()),
+        nodes_to_x(s.x.cbegin())
   {
   }
 };
@@ -637,8 +980,9 @@ apply_triangle_swap(apply_cavity const c, node_index const node, node_index cons
   c.new_elements_are_same[new_element2]                   = false;
 }
 
+template <int nodes_per_element>
 inline HPC_DEVICE void
-apply_triangle_split(apply_cavity const c, node_index const center_node, node_index const target_node)
+apply_edge_split(apply_cavity const c, node_index const center_node, node_index const target_node)
 {
   node_index const new_center_node = c.old_nodes_to_new_nodes[center_node];
   auto const       split_node      = new_center_node + node_index(1);
@@ -646,7 +990,7 @@ apply_triangle_split(apply_cavity const c, node_index const center_node, node_in
     element_index const                              element           = c.node_elements_to_elements[node_element];
     auto const                                       old_element_nodes = c.elements_to_element_nodes[element];
     node_in_element_index                            target_node_in_element(-1);
-    hpc::array<node_index, 3, node_in_element_index> new_nodes;
+    hpc::array<node_index, nodes_per_element, node_in_element_index> new_nodes;
     for (auto const node_in_element : c.nodes_in_element) {
       auto const       old_element_node = old_element_nodes[node_in_element];
       node_index const old_node         = c.old_element_nodes_to_nodes[old_element_node];
@@ -681,15 +1025,16 @@ apply_triangle_split(apply_cavity const c, node_index const center_node, node_in
   c.interpolate_from[split_node] = interpolate_from;
 }
 
+template <int nodes_per_element>
 inline HPC_DEVICE void
-apply_triangle_collapse(apply_cavity const c, node_index const center_node, node_index const target_node)
+apply_edge_collapse(apply_cavity const c, node_index const center_node, node_index const target_node)
 {
   node_index const new_target_node = c.old_nodes_to_new_nodes[target_node];
   for (auto const node_element : c.nodes_to_node_elements[center_node]) {
     element_index const                              element           = c.node_elements_to_elements[node_element];
     auto const                                       old_element_nodes = c.elements_to_element_nodes[element];
     node_in_element_index                            target_node_in_element(-1);
-    hpc::array<node_index, 3, node_in_element_index> new_nodes;
+    hpc::array<node_index, nodes_per_element, node_in_element_index> new_nodes;
     for (auto const node_in_element : c.nodes_in_element) {
       auto const       old_element_node = old_element_nodes[node_in_element];
       node_index const old_node         = c.old_element_nodes_to_nodes[old_element_node];
@@ -710,8 +1055,57 @@ apply_triangle_collapse(apply_cavity const c, node_index const center_node, node
   }
 }
 
-HPC_NOINLINE inline void
-apply_triangle_adapt(state const& s, adapt_state& a)
+inline HPC_DEVICE void
+apply_tetrahedron_swap(apply_cavity const c, node_index const node, node_index const target_node)
+{
+  hpc::array<element_index, 3> edge_elements;
+  int                          num_edge_elements = 0;
+  hpc::array<node_index, 3>    ring_nodes;
+  int                          num_ring_nodes = 0;
+  for (auto const node_element : c.nodes_to_node_elements[node]) {
+    element_index const element       = c.node_elements_to_elements[node_element];
+    auto const          element_nodes = c.elements_to_element_nodes[element];
+    bool                has_target    = false;
+    for (auto const node_in_element : c.nodes_in_element) {
+      has_target = has_target || (c.old_element_nodes_to_nodes[element_nodes[node_in_element]] == target_node);
+    }
+    if (!has_target) continue;
+    edge_elements[num_edge_elements++] = element;
+    for (auto const node_in_element : c.nodes_in_element) {
+      node_index const other = c.old_element_nodes_to_nodes[element_nodes[node_in_element]];
+      if (other != node && other != target_node) find_or_append(num_ring_nodes, ring_nodes, other);
+    }
+  }
+  assert(num_edge_elements == 3 && num_ring_nodes == 3);
+  // the edge element with the highest index was given no new elements
+  element_index kept[2];
+  int           num_kept = 0;
+  element_index dropped  = hpc::max(edge_elements[0], hpc::max(edge_elements[1], edge_elements[2]));
+  for (int i = 0; i < 3; ++i) {
+    if (edge_elements[i] != dropped) kept[num_kept++] = edge_elements[i];
+  }
+  hpc::array<hpc::position<double>, 4> x;
+  for (int i = 0; i < 3; ++i) x[i] = c.nodes_to_x[ring_nodes[i]].load();
+  x[3] = c.nodes_to_x[node].load();
+  if (tetrahedron_volume(x) < 0.0) hpc::swap(ring_nodes[1], ring_nodes[2]);
+  using l_t                                               = node_in_element_index;
+  auto new_element_nodes                                  = c.new_elements_to_element_nodes[c.old_elements_to_new_elements[kept[0]]];
+  c.new_element_nodes_to_nodes[new_element_nodes[l_t(0)]] = c.old_nodes_to_new_nodes[ring_nodes[0]];
+  c.new_element_nodes_to_nodes[new_element_nodes[l_t(1)]] = c.old_nodes_to_new_nodes[ring_nodes[1]];
+  c.new_element_nodes_to_nodes[new_element_nodes[l_t(2)]] = c.old_nodes_to_new_nodes[ring_nodes[2]];
+  c.new_element_nodes_to_nodes[new_element_nodes[l_t(3)]] = c.old_nodes_to_new_nodes[node];
+  new_element_nodes                                       = c.new_elements_to_element_nodes[c.old_elements_to_new_elements[kept[1]]];
+  c.new_element_nodes_to_nodes[new_element_nodes[l_t(0)]] = c.old_nodes_to_new_nodes[ring_nodes[0]];
+  c.new_element_nodes_to_nodes[new_element_nodes[l_t(1)]] = c.old_nodes_to_new_nodes[ring_nodes[2]];
+  c.new_element_nodes_to_nodes[new_element_nodes[l_t(2)]] = c.old_nodes_to_new_nodes[ring_nodes[1]];
+  c.new_element_nodes_to_nodes[new_element_nodes[l_t(3)]] = c.old_nodes_to_new_nodes[target_node];
+  c.new_elements_are_same[c.old_elements_to_new_elements[kept[0]]] = false;
+  c.new_elements_are_same[c.old_elements_to_new_elements[kept[1]]] = false;
+}
+
+template <int nodes_per_element>
+HPC_NOINLINE void
+apply_adapt(state const& s, adapt_state& a)
 {
   apply_cavity c(s, a);
   hpc::fill(hpc::device_policy(), a.new_elements_are_same, true);
@@ -723,12 +1117,17 @@ apply_triangle_adapt(state const& s, adapt_state& a)
     cavity_op const op = nodes_to_op[node];
     if (cavity_op::NONE == op) return;
     node_index const target_node = nodes_to_other_nodes[node];
-    if (cavity_op::SWAP == op)
-      apply_triangle_swap(c, node, target_node);
-    else if (cavity_op::SPLIT == op)
-      apply_triangle_split(c, node, target_node);
-    else if (cavity_op::COLLAPSE == op)
-      apply_triangle_collapse(c, node, target_node);
+    if (cavity_op::SWAP == op) {
+      if (nodes_per_element == 3) {
+        apply_triangle_swap(c, node, target_node);
+      } else {
+        apply_tetrahedron_swap(c, node, target_node);
+      }
+    } else if (cavity_op::SPLIT == op) {
+      apply_edge_split<nodes_per_element>(c, node, target_node);
+    } else if (cavity_op::COLLAPSE == op) {
+      apply_edge_collapse<nodes_per_element>(c, node, target_node);
+    }
   };
   hpc::for_each(hpc::device_policy(), s.nodes, functor);
 }
@@ -761,85 +1160,351 @@ transfer_same_connectivity(state const& s, adapt_state& a)
   hpc::for_each(hpc::device_policy(), a.new_elements, functor);
 }
 
+/* Moves the registered fields stored on elements, their points and their
+   point-nodes in one pass. New elements copy the element they were cut from,
+   which for derived data is only a stand-in until collect_adapted_sets()
+   has them recomputed. */
 HPC_NOINLINE inline void
-transfer_element_materials(adapt_state& a, hpc::device_vector<material_index, element_index>& data)
+transfer_element_fields(state& s, adapt_state const& a)
 {
-  hpc::device_vector<material_index, element_index> new_data(a.new_elements.size());
+  auto const num_new_points               = a.new_elements.size() * s.points_in_element.size();
+  auto const num_new_point_nodes          = num_new_points * s.nodes_in_element.size();
+  auto       element_transfer             = make_batched_transfer(adapt_element_fields(s), a.new_elements.size());
+  auto       point_transfer               = make_batched_transfer(adapt_point_fields(s), num_new_points);
+  auto       point_node_transfer          = make_batched_transfer(adapt_point_node_fields(s), num_new_point_nodes);
+  auto const element_views                = element_transfer.views();
+  auto const point_views                  = point_transfer.views();
+  auto const point_node_views             = point_node_transfer.views();
   auto const new_elements_to_old_elements = a.new_elements_to_old_elements.cbegin();
-  auto const old_elements_to_T            = data.cbegin();
-  auto const new_elements_to_T            = new_data.begin();
+  auto const old_elements_to_points       = s.elements * s.points_in_element;
+  auto const new_elements_to_points       = a.new_elements * s.points_in_element;
+  auto const points_to_point_nodes        = s.points * s.nodes_in_element;
+  auto const points_in_element            = s.points_in_element;
+  auto const nodes_in_element             = s.nodes_in_element;
   auto       functor                      = [=] HPC_DEVICE(element_index const new_element) {
     element_index const old_element = new_elements_to_old_elements[new_element];
-    new_elements_to_T[new_element]  = material_index(old_elements_to_T[old_element]);
+    element_views.copy(new_element, old_element);
+    auto const new_element_points = new_elements_to_points[new_element];
+    auto const old_element_points = old_elements_to_points[old_element];
+    for (auto const point_in_element : points_in_element) {
+      auto const new_point = new_element_points[point_in_element];
+      auto const old_point = old_element_points[point_in_element];
+      point_views.copy(new_point, old_point);
+      auto const new_point_nodes = points_to_point_nodes[new_point];
+      auto const old_point_nodes = points_to_point_nodes[old_point];
+      for (auto const node_in_element : nodes_in_element) {
+        point_node_views.copy(new_point_nodes[node_in_element], old_point_nodes[node_in_element]);
+      }
+    }
   };
   hpc::for_each(hpc::device_policy(), a.new_elements, functor);
-  data = std::move(new_data);
+  element_transfer.finish();
+  point_transfer.finish();
+  point_node_transfer.finish();
 }
 
+template <class Range>
+using node_range_type = hpc::device_vector<typename Range::value_type, node_index>;
+
 template <class Range>
 HPC_NOINLINE void
-transfer_point_data(state const& s, adapt_state const& a, Range& data)
+spread_over_nodes(
+    entity_sets<node_index> const& node_sets,
+    material_index const           material,
+    node_index const               node_count,
+    Range const&                   material_vector,
+    node_range_type<Range>&        node_vector)
 {
-  auto const points_in_element = s.points_in_element;
-  using value_type             = typename Range::value_type;
-  Range      new_data(a.new_elements.size() * points_in_element.size());
-  auto const new_elements_to_old_elements = a.new_elements_to_old_elements.cbegin();
-  auto const old_points_to_T              = data.cbegin();
-  auto const new_points_to_T              = new_data.begin();
-  auto const old_elements_to_points       = s.elements * points_in_element;
-  auto const new_elements_to_points       = a.new_elements * points_in_element;
-  auto       functor                      = [=] HPC_DEVICE(element_index const new_element) {
-    element_index const old_element        = new_elements_to_old_elements[new_element];
-    auto const          new_element_points = new_elements_to_points[new_element];
-    auto const          old_element_points = old_elements_to_points[old_element];
-    for (auto const point_in_element : points_in_element) {
-      auto const new_point       = new_element_points[point_in_element];
-      auto const old_point       = old_element_points[point_in_element];
-      auto const old_value       = value_type(old_points_to_T[old_point]);
-      new_points_to_T[new_point] = old_value;
-    }
+  using value_type = typename Range::value_type;
+  node_vector.resize(node_count);
+  hpc::fill(hpc::device_policy(), node_vector, value_type(0.0));
+  auto const material_nodes_to_nodes = node_sets[material].begin();
+  auto const material_nodes_to_value = material_vector.cbegin();
+  auto const nodes_to_value          = node_vector.begin();
+  auto       functor                 = [=] HPC_DEVICE(material_node_index const material_node) {
+    node_index const node = material_nodes_to_nodes[hpc::weaken(material_node)];
+    nodes_to_value[node]  = material_nodes_to_value[material_node];
   };
-  hpc::for_each(hpc::device_policy(), a.new_elements, functor);
-  data = std::move(new_data);
+  hpc::for_each(hpc::device_policy(), hpc::counting_range<material_node_index>(material_vector.size()), functor);
+}
+
+template <class Range>
+HPC_NOINLINE void
+gather_from_nodes(node_list const material_nodes, node_range_type<Range> const& node_vector, Range& material_vector)
+{
+  material_vector.resize(material_node_index(material_nodes.size()));
+  auto const material_nodes_to_nodes = material_nodes.begin();
+  auto const nodes_to_value          = node_vector.cbegin();
+  auto const material_nodes_to_value = material_vector.begin();
+  auto       functor                 = [=] HPC_DEVICE(material_node_index const material_node) {
+    node_index const node                  = material_nodes_to_nodes[hpc::weaken(material_node)];
+    material_nodes_to_value[material_node] = nodes_to_value[node];
+  };
+  hpc::for_each(hpc::device_policy(), hpc::counting_range<material_node_index>(material_vector.size()), functor);
 }
 
+/* The per-material nodal fields are stored over the node set of their
+   material, which adapt() rebuilds. They cross it spread over all nodes,
+   like the other nodal fields, and are gathered onto the new set after. */
+template <class FieldTuple>
+class spread_nodal_fields;
+
+template <class... Fields>
+class spread_nodal_fields<std::tuple<Fields...>>
+{
+ public:
+  void
+  spread(
+      std::tuple<Fields...> const&   fields_in,
+      entity_sets<node_index> const& node_sets,
+      material_index const           material,
+      node_index const               node_count)
+  {
+    fields = fields_in;
+    spread(node_sets, material, node_count, std::index_sequence_for<Fields...>());
+  }
+  std::tuple<transferable_field<Fields::rule, node_range_type<typename Fields::range_type>>...>
+  node_fields()
+  {
+    return node_fields(std::index_sequence_for<Fields...>());
+  }
+  void
+  gather(node_list const material_nodes)
+  {
+    gather(material_nodes, std::index_sequence_for<Fields...>());
+  }
+
+ private:
+  template <std::size_t... I>
+  void
+  spread(
+      entity_sets<node_index> const& node_sets,
+      material_index const           material,
+      node_index const               node_count,
+      std::index_sequence<I...>)
+  {
+    int const expand[] = {
+        0,
+        (std::get<I>(fields).data->empty()
+             ? 0
+             : (spread_over_nodes(
+                    node_sets, material, node_count, *(std::get<I>(fields).data), std::get<I>(node_data)),
+                0))...};
+    (void)expand;
+  }
+  template <std::size_t... I>
+  std::tuple<transferable_field<Fields::rule, node_range_type<typename Fields::range_type>>...>
+  node_fields(std::index_sequence<I...>)
+  {
+    return std::make_tuple(transferable<Fields::rule>(std::get<I>(node_data))...);
+  }
+  template <std::size_t... I>
+  void
+  gather(node_list const material_nodes, std::index_sequence<I...>)
+  {
+    int const expand[] = {
+        0,
+        (std::get<I>(node_data).empty()
+             ? 0
+             : (gather_from_nodes(material_nodes, std::get<I>(node_data), *(std::get<I>(fields).data)), 0))...};
+    (void)expand;
+  }
+  std::tuple<Fields...>                                      fields;
+  std::tuple<node_range_type<typename Fields::range_type>...> node_data;
+};
+
+using material_nodal_fields =
+    spread_nodal_fields<decltype(adapt_material_node_fields(std::declval<state&>(), material_index()))>;
+
+// the per-material nodal fields take one more pass per material
 HPC_NOINLINE inline void
-transfer_nodal_energy(input const& in, adapt_state const& a, state& s)
+transfer_nodal_fields(
+    input const&                                             in,
+    state&                                                   s,
+    adapt_state const&                                       a,
+    hpc::host_vector<material_nodal_fields, material_index>& material_fields)
 {
-  auto const new_nodes_to_old_nodes = a.new_nodes_to_old_nodes.cbegin();
+  transfer_fields(
+      a.new_nodes, a.new_nodes_to_old_nodes, a.new_nodes_are_same, a.interpolate_from, adapt_node_fields(s));
   for (auto const material : in.materials) {
-    if (!in.enable_nodal_energy[material]) continue;
-    hpc::device_vector<hpc::specific_energy<double>, node_index>& old_data = s.e_h[material];
-    hpc::device_vector<hpc::specific_energy<double>, node_index>  new_data(a.new_nodes.size());
-    auto const                                                    old_nodes_to_T = old_data.cbegin();
-    auto const                                                    new_nodes_to_T = new_data.begin();
-    auto                                                          functor = [=] HPC_DEVICE(node_index const new_node) {
-      auto const old_node  = new_nodes_to_old_nodes[new_node];
-      auto const old_value = old_nodes_to_T[old_node];
-      assert(old_value > 0.0);
-      new_nodes_to_T[new_node] = old_value;
-    };
-    // FIXME: this could be run over just the new nodes touching this material,
-    // but we can't do that right now because we don't compute that set of nodes
-    // until after all the transfers
-    hpc::for_each(hpc::device_policy(), a.new_nodes, functor);
-    old_data = std::move(new_data);
+    material_fields[material].spread(adapt_material_node_fields(s, material), s.node_sets, material, s.nodes.size());
+    transfer_fields(
+        a.new_nodes,
+        a.new_nodes_to_old_nodes,
+        a.new_nodes_are_same,
+        a.interpolate_from,
+        material_fields[material].node_fields());
   }
 }
 
-template <class Range>
-HPC_NOINLINE void
-interpolate_nodal_data(adapt_state const& a, Range& data)
+// whether an old element went into the new mesh untouched, as exactly one element that is the same
+template <class OldToNew, class AreSame>
+HPC_HOST_DEVICE inline bool
+is_carried_over(
+    OldToNew const      old_elements_to_new_elements,
+    AreSame const       new_elements_are_same,
+    element_index const old_element)
+{
+  element_index const new_element = old_elements_to_new_elements[old_element];
+  return (old_elements_to_new_elements[old_element + 1] - new_element == element_index(1)) &&
+         new_elements_are_same[new_element];
+}
+
+/* Like propagate_connectivity, but starts from the old node-to-element
+   adjacency: a node whose elements all carried over keeps its old list with
+   the element indices renumbered, which preserves their order. Only the
+   nodes around cavities count, append and sort the elements adapt() made. */
+HPC_NOINLINE inline void
+propagate_adapted_connectivity(state& s, adapt_state const& a)
 {
-  interpolate_data(a.new_nodes, a.new_nodes_to_old_nodes, a.new_nodes_are_same, a.interpolate_from, data);
+  node_element_index const node_element_count(hpc::weaken(a.new_elements.size() * s.nodes_in_element.size()));
+  hpc::device_range_sum<node_element_index, node_index>         nodes_to_node_elements;
+  hpc::device_vector<element_index, node_element_index>         node_elements_to_elements(node_element_count);
+  hpc::device_vector<node_in_element_index, node_element_index> node_elements_to_nodes_in_element(node_element_count);
+  hpc::device_vector<int, node_index>                           counts_vector(a.new_nodes.size());
+  hpc::device_vector<bool, node_index>                          is_clean_vector(a.new_nodes.size());
+  auto const old_nodes_to_node_elements            = s.nodes_to_node_elements.cbegin();
+  auto const old_node_elements_to_elements         = s.node_elements_to_elements.cbegin();
+  auto const old_node_elements_to_nodes_in_element = s.node_elements_to_nodes_in_element.cbegin();
+  auto const old_elements_to_new_elements          = a.old_elements_to_new_elements.cbegin();
+  auto const new_nodes_to_old_nodes                = a.new_nodes_to_old_nodes.cbegin();
+  auto const new_elements_are_same                 = a.new_elements_are_same.cbegin();
+  auto const new_nodes_are_same                    = a.new_nodes_are_same.cbegin();
+  auto const new_elements_to_element_nodes         = a.new_elements * s.nodes_in_element;
+  auto const new_element_nodes_to_nodes            = s.elements_to_nodes.cbegin();
+  auto const nodes_in_element                      = s.nodes_in_element;
+  auto const nodes_to_count                        = counts_vector.begin();
+  auto const nodes_are_clean                       = is_clean_vector.begin();
+  auto       count_carried_functor                 = [=] HPC_DEVICE(node_index const new_node) {
+    int  count    = 0;
+    bool is_clean = new_nodes_are_same[new_node];
+    if (is_clean) {
+      node_index const old_node = new_nodes_to_old_nodes[new_node];
+      for (auto const node_element : old_nodes_to_node_elements[old_node]) {
+        element_index const old_element = old_node_elements_to_elements[node_element];
+        if (is_carried_over(old_elements_to_new_elements, new_elements_are_same, old_element)) {
+          ++count;
+        } else {
+          is_clean = false;
+        }
+      }
+    }
+    nodes_to_count[new_node]  = count;
+    nodes_are_clean[new_node] = is_clean;
+  };
+  hpc::for_each(hpc::device_policy(), a.new_nodes, count_carried_functor);
+  auto count_made_functor = [=] HPC_DEVICE(element_index const new_element) {
+    if (new_elements_are_same[new_element]) return;
+    for (auto const element_node : new_elements_to_element_nodes[new_element]) {
+      node_index const new_node = new_element_nodes_to_nodes[element_node];
+      assert(!nodes_are_clean[new_node]);
+      hpc::atomic_ref<int> count(nodes_to_count[new_node]);
+      count++;
+    }
+  };
+  hpc::for_each(hpc::device_policy(), a.new_elements, count_made_functor);
+  nodes_to_node_elements.assign_sizes(counts_vector);
+  auto const new_nodes_to_node_elements            = nodes_to_node_elements.cbegin();
+  auto const new_node_elements_to_elements         = node_elements_to_elements.begin();
+  auto const new_node_elements_to_nodes_in_element = node_elements_to_nodes_in_element.begin();
+  auto       fill_carried_functor                  = [=] HPC_DEVICE(node_index const new_node) {
+    int        count             = 0;
+    auto const new_node_elements = new_nodes_to_node_elements[new_node];
+    if (new_nodes_are_same[new_node]) {
+      node_index const old_node = new_nodes_to_old_nodes[new_node];
+      for (auto const old_node_element : old_nodes_to_node_elements[old_node]) {
+        element_index const old_element = old_node_elements_to_elements[old_node_element];
+        if (!is_carried_over(old_elements_to_new_elements, new_elements_are_same, old_element)) continue;
+        auto const new_node_element                     = new_node_elements[node_element_index(count++)];
+        new_node_elements_to_elements[new_node_element] = old_elements_to_new_elements[old_element];
+        new_node_elements_to_nodes_in_element[new_node_element] =
+            old_node_elements_to_nodes_in_element[old_node_element];
+      }
+    }
+    nodes_to_count[new_node] = count;
+  };
+  hpc::for_each(hpc::device_policy(), a.new_nodes, fill_carried_functor);
+  auto fill_made_functor = [=] HPC_DEVICE(element_index const new_element) {
+    if (new_elements_are_same[new_element]) return;
+    auto const new_element_nodes = new_elements_to_element_nodes[new_element];
+    for (auto const node_in_element : nodes_in_element) {
+      node_index const     new_node = new_element_nodes_to_nodes[new_element_nodes[node_in_element]];
+      hpc::atomic_ref<int> count(nodes_to_count[new_node]);
+      int const            offset                             = count++;
+      auto const           new_node_elements                  = new_nodes_to_node_elements[new_node];
+      auto const           new_node_element                   = new_node_elements[node_element_index(offset)];
+      new_node_elements_to_elements[new_node_element]         = new_element;
+      new_node_elements_to_nodes_in_element[new_node_element] = node_in_element;
+    }
+  };
+  hpc::for_each(hpc::device_policy(), a.new_elements, fill_made_functor);
+  auto sort_functor = [=] HPC_DEVICE(node_index const new_node) {
+    if (nodes_are_clean[new_node]) return;
+    sort_node_elements(
+        new_nodes_to_node_elements[new_node], new_node_elements_to_elements, new_node_elements_to_nodes_in_element);
+  };
+  hpc::for_each(hpc::device_policy(), a.new_nodes, sort_functor);
+  s.nodes_to_node_elements            = std::move(nodes_to_node_elements);
+  s.node_elements_to_elements         = std::move(node_elements_to_elements);
+  s.node_elements_to_nodes_in_element = std::move(node_elements_to_nodes_in_element);
+  s.points.resize(a.new_elements.size() * s.points_in_element.size());
+}
+
+// the elements adapt() created and the nodes whose surrounding elements changed
+HPC_NOINLINE inline void
+collect_adapted_sets(input const& in, state& s, adapt_state const& a)
+{
+  auto const elements_are_same     = a.new_elements_are_same.cbegin();
+  auto const elements_to_material  = s.material.cbegin();
+  auto       element_sets_functor  = [=] HPC_DEVICE(element_index const element) {
+    if (elements_are_same[element]) return material_set::none();
+    return material_set(material_index(elements_to_material[element]));
+  };
+  bucket_sets(s.elements, in.materials.size(), element_sets_functor, s.adapted_element_sets);
+  auto const nodes_are_same            = a.new_nodes_are_same.cbegin();
+  auto const nodes_to_node_elements    = s.nodes_to_node_elements.cbegin();
+  auto const node_elements_to_elements = s.node_elements_to_elements.cbegin();
+  auto const nodes_to_materials        = s.nodal_materials.cbegin();
+  auto       node_sets_functor         = [=] HPC_DEVICE(node_index const node) {
+    bool is_same = nodes_are_same[node];
+    for (auto const node_element : nodes_to_node_elements[node]) {
+      is_same = is_same && elements_are_same[node_elements_to_elements[node_element]];
+    }
+    return is_same ? material_set::none() : material_set(nodes_to_materials[node]);
+  };
+  bucket_sets(s.nodes, in.materials.size(), node_sets_functor, s.adapted_node_sets);
+}
+
+void
+choose_independent_cavities(
+    state const&                                  s,
+    hpc::device_vector<double, node_index> const& criteria,
+    hpc::device_vector<bool, node_index>&         is_chosen)
+{
+  adapt_state a(s);
+  hpc::copy(criteria, a.criteria);
+  auto const nodes_to_criteria = a.criteria.cbegin();
+  auto const nodes_to_op       = a.op.begin();
+  auto       functor           = [=] HPC_DEVICE(node_index const node) {
+    nodes_to_op[node] = nodes_to_criteria[node] > 0.0 ? cavity_op::SPLIT : cavity_op::NONE;
+  };
+  hpc::for_each(hpc::device_policy(), s.nodes, functor);
+  choose_independent_cavities(s, a);
+  is_chosen.resize(s.nodes.size());
+  hpc::copy(a.is_chosen, is_chosen);
 }
 
 bool
 adapt(input const& in, state& s)
 {
+  if (in.element != TRIANGLE && in.element != TETRAHEDRON) return false;
   adapt_state a(s);
-  evaluate_triangle_adapt(in, s, a);
-  choose_triangle_adapt(s, a);
+  if (in.element == TRIANGLE) {
+    evaluate_adapt<3, 32, 32>(in, s, a);
+  } else {
+    evaluate_adapt<4, 64, 48>(in, s, a);
+  }
+  choose_adapt(s, a);
   auto const num_chosen =
       hpc::transform_reduce(hpc::device_policy(), a.op, int(0), hpc::plus<int>(), [] HPC_DEVICE(cavity_op const op) {
         return op == cavity_op::NONE ? 0 : 1;
@@ -860,24 +1525,24 @@ adapt(input const& in, state& s)
   a.interpolate_from.resize(num_new_nodes);
   project(s.elements, a.old_elements_to_new_elements, a.new_elements_to_old_elements);
   project(s.nodes, a.old_nodes_to_new_nodes, a.new_nodes_to_old_nodes);
-  apply_triangle_adapt(s, a);
-  transfer_same_connectivity(s, a);
-  transfer_element_materials(a, s.material);
-  transfer_point_data(s, a, s.rho);
-  if (!hpc::all_of(hpc::serial_policy(), in.enable_nodal_energy)) {
-    transfer_point_data(s, a, s.e);
+  if (in.element == TRIANGLE) {
+    apply_adapt<3>(s, a);
   } else {
-    transfer_nodal_energy(in, a, s);
+    apply_adapt<4>(s, a);
   }
-  transfer_point_data(s, a, s.F_total);
-  interpolate_nodal_data(a, s.x);
-  interpolate_nodal_data(a, s.v);
-  interpolate_nodal_data(a, s.h_adapt);
+  transfer_same_connectivity(s, a);
+  transfer_element_fields(s, a);
+  hpc::host_vector<material_nodal_fields, material_index> material_fields(in.materials.size());
+  transfer_nodal_fields(in, s, a, material_fields);
   s.elements          = a.new_elements;
   s.nodes             = a.new_nodes;
   s.elements_to_nodes = std::move(a.new_element_nodes_to_nodes);
-  propagate_connectivity(s);
+  propagate_adapted_connectivity(s, a);
   compute_nodal_materials(in, s);
+  collect_node_sets(in, s);
+  collect_material_nodes(in, s);
+  for (auto const material : in.materials) { material_fields[material].gather(s.node_sets[material]); }
+  collect_adapted_sets(in, s, a);
   return true;
 }
 
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <lgr_entity_sets.hpp>
+
 namespace lgr {
 
 class input;
@@ -8,9 +10,18 @@ class state;
 void
 update_quality(input const& in, state& s);
 void
+update_quality(input const& in, state& s, element_list elements);
+void
 update_min_quality(state& s);
 bool
 adapt(input const& in, state& s);
+// the cavity selection of adapt() on its own: marks a maximal set of nodes of
+// positive criteria whose cavities share no element, preferring larger criteria
+void
+choose_independent_cavities(
+    state const&                                  s,
+    hpc::device_vector<double, node_index> const& criteria,
+    hpc::device_vector<bool, node_index>&         is_chosen);
 void
 initialize_h_adapt(state& s);
 
@@ -4,9 +4,13 @@
 #include <hpc_array_vector.hpp>
 #include <hpc_execution.hpp>
 #include <hpc_macros.hpp>
+#include <hpc_numeric.hpp>
 #include <hpc_quaternion.hpp>
 #include <hpc_range.hpp>
 #include <hpc_vector.hpp>
+#include <lgr_state.hpp>
+#include <tuple>
+#include <utility>
 
 namespace lgr {
 
@@ -27,127 +31,250 @@ project(
   hpc::for_each(hpc::device_policy(), old_things, functor);
 }
 
-template <class Index, class Range>
-HPC_NOINLINE void
-interpolate_data(
-    const hpc::counting_range<Index>&                                 new_entities,
-    const hpc::device_vector<Index, Index>&                           new_to_old,
-    const hpc::device_vector<bool, Index>&                            new_entities_are_same,
-    const hpc::device_array_vector<hpc::array<Index, 2, int>, Index>& interpolate_from_entities,
-    Range&                                                            data)
+template <class T>
+HPC_HOST_DEVICE inline T
+lie_average(T const& F0, T const& F1)
 {
-  static_assert(std::is_same<Index, typename Range::size_type>::value, "data range incompatible with Index");
-  using value_type = typename Range::value_type;
-  Range      new_data(new_entities.size());
-  auto const old_nodes_to_data      = data.cbegin();
-  auto const new_nodes_to_data      = new_data.begin();
-  auto const new_nodes_to_old_nodes = new_to_old.cbegin();
-  auto const new_nodes_are_same     = new_entities_are_same.cbegin();
-  auto const interpolate_from       = interpolate_from_entities.cbegin();
-  auto       functor                = [=] HPC_DEVICE(Index const i) {
-    if (new_nodes_are_same[i]) {
-      Index const old_node = new_nodes_to_old_nodes[i];
-      new_nodes_to_data[i] = value_type(old_nodes_to_data[old_node]);
-    } else {
-      auto const  pair     = interpolate_from[i].load();
-      Index const left     = pair[0];
-      Index const right    = pair[1];
-      new_nodes_to_data[i] = 0.5 * (value_type(old_nodes_to_data[left]) + value_type(old_nodes_to_data[right]));
-    }
-  };
-  hpc::for_each(hpc::device_policy(), new_entities, functor);
-  data = std::move(new_data);
+  auto const alpha = 0.8;
+  auto const pi    = hpc::pi<double>();
+  auto const R0    = hpc::polar_rotation(F0);
+  auto const U0    = hpc::symm(hpc::transpose(R0) * F0);
+  auto       r0    = hpc::rotation_vector_from_rotation_tensor(R0);
+  auto const n0    = hpc::norm(r0);
+  auto const u0    = hpc::log(U0);
+  auto const R1    = hpc::polar_rotation(F1);
+  auto const U1    = hpc::symm(hpc::transpose(R1) * F1);
+  auto       r1    = hpc::rotation_vector_from_rotation_tensor(R1);
+  auto const n1    = hpc::norm(r1);
+  auto const u1    = hpc::log(U1);
+  auto const dot   = hpc::inner_product(r0, r1);
+  if (dot <= -alpha * pi * pi) { r1 = (1.0 - 2.0 * pi / n1) * r1; }
+  if (n0 + n1 > 2.0 * pi) {
+    r0 = (1.0 - 2.0 * pi / n0) * r0;
+    r1 = (1.0 - 2.0 * pi / n1) * r1;
+  }
+  auto const ri = 0.5 * (r0 + r1);
+  auto const ui = 0.5 * (u0 + u1);
+  auto const Ri = hpc::rotation_tensor_from_rotation_vector(ri);
+  auto const Ui = hpc::exp(ui);
+  return Ri * Ui;
 }
 
-template <class Index, class Range>
-HPC_NOINLINE void
-lie_interpolate_data(
-    const hpc::counting_range<Index>&                                 new_entities,
-    const hpc::device_vector<Index, Index>&                           new_to_old,
-    const hpc::device_vector<bool, Index>&                            new_entities_are_same,
-    const hpc::device_array_vector<hpc::array<Index, 2, int>, Index>& interpolate_from_entities,
-    Range&                                                            data)
+// one field's old and new values, as seen from inside a transfer kernel
+template <transfer_rule Rule, class Range>
+class transfer_view
 {
-  static_assert(std::is_same<Index, typename Range::size_type>::value, "data range incompatible with Index");
+ public:
   using value_type = typename Range::value_type;
-  Range      new_data(new_entities.size());
-  auto const old_nodes_to_data      = data.cbegin();
-  auto const new_nodes_to_data      = new_data.begin();
-  auto const new_nodes_to_old_nodes = new_to_old.cbegin();
-  auto const new_nodes_are_same     = new_entities_are_same.cbegin();
-  auto const interpolate_from       = interpolate_from_entities.cbegin();
-  auto const alpha                  = 0.8;
-  auto const pi                     = std::acos(-1.0);
-  auto       functor                = [=] HPC_DEVICE(Index const i) {
-    if (new_nodes_are_same[i]) {
-      Index const old_node = new_nodes_to_old_nodes[i];
-      new_nodes_to_data[i] = value_type(old_nodes_to_data[old_node]);
-    } else {
-      auto const  pair  = interpolate_from[i].load();
-      Index const left  = pair[0];
-      Index const right = pair[1];
-      auto const  F0    = old_nodes_to_data[left].load();
-      auto const  R0    = hpc::polar_rotation(F0);
-      auto const  U0    = hpc::symm(hpc::transpose(R0) * F0);
-      auto        r0    = hpc::rotation_vector_from_rotation_tensor(R0);
-      auto const  n0    = hpc::norm(r0);
-      auto const  u0    = hpc::log(U0);
-      auto const  F1    = old_nodes_to_data[right].load();
-      auto const  R1    = hpc::polar_rotation(F1);
-      auto const  U1    = hpc::symm(hpc::transpose(R1) * F1);
-      auto        r1    = hpc::rotation_vector_from_rotation_tensor(R1);
-      auto const  n1    = hpc::norm(r1);
-      auto const  u1    = hpc::log(U1);
-      auto const  dot   = hpc::inner_product(r0, r1);
-      if (dot <= -alpha * pi * pi) { r1 = (1.0 - 2.0 * pi / n1) * r1; }
-      if (n0 + n1 > 2.0 * pi) {
-        r0 = (1.0 - 2.0 * pi / n0) * r0;
-        r1 = (1.0 - 2.0 * pi / n1) * r1;
-      }
-      auto const ri        = 0.5 * (r0 + r1);
-      auto const ui        = 0.5 * (u0 + u1);
-      auto const Ri        = hpc::rotation_tensor_from_rotation_vector(ri);
-      auto const Ui        = hpc::exp(ui);
-      auto const Fi        = Ri * Ui;
-      new_nodes_to_data[i] = Fi;
-    }
-  };
-  hpc::for_each(hpc::device_policy(), new_entities, functor);
-  data = std::move(new_data);
+  using index_type = typename Range::size_type;
+  transfer_view(Range const& old_data, Range& new_data)
+      : old_to_data(old_data.cbegin()), new_to_data(new_data.begin()), is_active(!old_data.empty())
+  {
+  }
+  HPC_HOST_DEVICE void
+  copy(index_type const new_entity, index_type const old_entity) const
+  {
+    if (is_active) new_to_data[new_entity] = value_type(old_to_data[old_entity]);
+  }
+  HPC_HOST_DEVICE void
+  interpolate(
+      index_type const new_entity,
+      index_type const old_entity,
+      index_type const left,
+      index_type const right) const
+  {
+    if (is_active) interpolate(std::integral_constant<transfer_rule, Rule>(), new_entity, old_entity, left, right);
+  }
+
+ private:
+  HPC_HOST_DEVICE void
+  interpolate(
+      std::integral_constant<transfer_rule, transfer_rule::COPY>,
+      index_type const new_entity,
+      index_type const old_entity,
+      index_type,
+      index_type) const
+  {
+    new_to_data[new_entity] = value_type(old_to_data[old_entity]);
+  }
+  HPC_HOST_DEVICE void
+  interpolate(
+      std::integral_constant<transfer_rule, transfer_rule::AVERAGE>,
+      index_type const new_entity,
+      index_type,
+      index_type const left,
+      index_type const right) const
+  {
+    new_to_data[new_entity] = 0.5 * (value_type(old_to_data[left]) + value_type(old_to_data[right]));
+  }
+  HPC_HOST_DEVICE void
+  interpolate(
+      std::integral_constant<transfer_rule, transfer_rule::LIE_AVERAGE>,
+      index_type const new_entity,
+      index_type,
+      index_type const left,
+      index_type const right) const
+  {
+    new_to_data[new_entity] = lie_average(old_to_data[left].load(), old_to_data[right].load());
+  }
+  HPC_HOST_DEVICE void
+  interpolate(
+      std::integral_constant<transfer_rule, transfer_rule::DISTRIBUTE>,
+      index_type const new_entity,
+      index_type,
+      index_type const left,
+      index_type const right) const
+  {
+    new_to_data[new_entity] = (1.0 / 3.0) * (value_type(old_to_data[left]) + value_type(old_to_data[right]));
+    new_to_data[left]       = (2.0 / 3.0) * value_type(old_to_data[left]);
+    new_to_data[right]      = (2.0 / 3.0) * value_type(old_to_data[right]);
+  }
+  typename Range::const_iterator old_to_data;
+  typename Range::iterator       new_to_data;
+  bool                           is_active;
+};
+
+// applies every view of a batch in turn, so one kernel moves all of its fields
+template <class... Views>
+class transfer_views;
+
+template <>
+class transfer_views<>
+{
+ public:
+  template <class... Indices>
+  HPC_HOST_DEVICE void
+  copy(Indices...) const
+  {
+  }
+  template <class... Indices>
+  HPC_HOST_DEVICE void
+  interpolate(Indices...) const
+  {
+  }
+};
+
+template <class View, class... Views>
+class transfer_views<View, Views...>
+{
+ public:
+  transfer_views(View const& first_in, Views const&... rest_in) : first(first_in), rest(rest_in...) {}
+  template <class Index>
+  HPC_HOST_DEVICE void
+  copy(Index const new_entity, Index const old_entity) const
+  {
+    first.copy(new_entity, old_entity);
+    rest.copy(new_entity, old_entity);
+  }
+  template <class Index>
+  HPC_HOST_DEVICE void
+  interpolate(Index const new_entity, Index const old_entity, Index const left, Index const right) const
+  {
+    first.interpolate(new_entity, old_entity, left, right);
+    rest.interpolate(new_entity, old_entity, left, right);
+  }
+
+ private:
+  View                     first;
+  transfer_views<Views...> rest;
+};
+
+template <class Field>
+using transfer_view_type = transfer_view<Field::rule, typename Field::range_type>;
+
+// allocates the new values of a batch of registered fields and moves them in once its kernel ran
+template <class... Fields>
+class batched_transfer
+{
+ public:
+  template <class Size>
+  batched_transfer(std::tuple<Fields...> const& fields_in, Size const new_size)
+      : fields(fields_in), new_data(allocate(fields_in, new_size, std::index_sequence_for<Fields...>()))
+  {
+  }
+  transfer_views<transfer_view_type<Fields>...>
+  views()
+  {
+    return views(std::index_sequence_for<Fields...>());
+  }
+  void
+  finish()
+  {
+    finish(std::index_sequence_for<Fields...>());
+  }
+
+ private:
+  template <class Field, class Size>
+  static typename Field::range_type
+  allocate(Field const field, Size const new_size)
+  {
+    using range_type = typename Field::range_type;
+    return field.data->empty() ? range_type() : range_type(new_size);
+  }
+  template <class Size, std::size_t... I>
+  static std::tuple<typename Fields::range_type...>
+  allocate(std::tuple<Fields...> const& fields_in, Size const new_size, std::index_sequence<I...>)
+  {
+    return std::tuple<typename Fields::range_type...>(allocate(std::get<I>(fields_in), new_size)...);
+  }
+  template <std::size_t... I>
+  transfer_views<transfer_view_type<Fields>...>
+  views(std::index_sequence<I...>)
+  {
+    return transfer_views<transfer_view_type<Fields>...>(
+        transfer_view_type<Fields>(*(std::get<I>(fields).data), std::get<I>(new_data))...);
+  }
+  template <std::size_t... I>
+  void
+  finish(std::index_sequence<I...>)
+  {
+    int const expand[] = {0, (finish(std::get<I>(fields), std::get<I>(new_data)), 0)...};
+    (void)expand;
+  }
+  template <class Field>
+  static void
+  finish(Field const field, typename Field::range_type& data)
+  {
+    if (!field.data->empty()) *(field.data) = std::move(data);
+  }
+  std::tuple<Fields...>                     fields;
+  std::tuple<typename Fields::range_type...> new_data;
+};
+
+template <class Size, class... Fields>
+inline batched_transfer<Fields...>
+make_batched_transfer(std::tuple<Fields...> const& fields, Size const new_size)
+{
+  return batched_transfer<Fields...>(fields, new_size);
 }
 
-template <class Index, class Range>
+/* Moves a batch of fields stored on the same entities in one pass: surviving
+   entities keep their value, new ones get what each field's rule prescribes. */
+template <class Index, class... Fields>
 HPC_NOINLINE void
-distribute_data(
+transfer_fields(
     const hpc::counting_range<Index>&                                 new_entities,
     const hpc::device_vector<Index, Index>&                           new_to_old,
     const hpc::device_vector<bool, Index>&                            new_entities_are_same,
     const hpc::device_array_vector<hpc::array<Index, 2, int>, Index>& interpolate_from_entities,
-    Range&                                                            data)
+    std::tuple<Fields...> const&                                      fields)
 {
-  static_assert(std::is_same<Index, typename Range::size_type>::value, "data range incompatible with Index");
-  using value_type = typename Range::value_type;
-  Range      new_data(new_entities.size());
-  auto const old_nodes_to_data      = data.cbegin();
-  auto const new_nodes_to_data      = new_data.begin();
-  auto const new_nodes_to_old_nodes = new_to_old.cbegin();
-  auto const new_nodes_are_same     = new_entities_are_same.cbegin();
-  auto const interpolate_from       = interpolate_from_entities.cbegin();
-  auto       functor                = [=] HPC_DEVICE(Index const i) {
-    if (new_nodes_are_same[i]) {
-      Index const old_node = new_nodes_to_old_nodes[i];
-      new_nodes_to_data[i] = value_type(old_nodes_to_data[old_node]);
+  auto       transfer            = make_batched_transfer(fields, new_entities.size());
+  auto const views               = transfer.views();
+  auto const new_to_old_entities = new_to_old.cbegin();
+  auto const new_are_same        = new_entities_are_same.cbegin();
+  auto const interpolate_from    = interpolate_from_entities.cbegin();
+  auto       functor             = [=] HPC_DEVICE(Index const i) {
+    Index const old_entity = new_to_old_entities[i];
+    if (new_are_same[i]) {
+      views.copy(i, old_entity);
     } else {
-      auto const  pair  = interpolate_from[i].load();
-      Index const left  = pair[0];
-      Index const right = pair[1];
-      new_nodes_to_data[i] = (1.0 / 3.0) * (value_type(old_nodes_to_data[left]) + value_type(old_nodes_to_data[right]));
-      new_nodes_to_data[left]  = (2.0 / 3.0) * value_type(old_nodes_to_data[left]);
-      new_nodes_to_data[right] = (2.0 / 3.0) * value_type(old_nodes_to_data[right]);
+      auto const pair = interpolate_from[i].load();
+      views.interpolate(i, old_entity, pair[0], pair[1]);
     }
   };
   hpc::for_each(hpc::device_policy(), new_entities, functor);
-  data = std::move(new_data);
+  transfer.finish();
 }
 
 }  // namespace lgr
@@ -0,0 +1,455 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <hpc_array_vector.hpp>
+#include <hpc_range_sum.hpp>
+#include <hpc_vector.hpp>
+#include <lgr_checkpoint.hpp>
+#include <lgr_state.hpp>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace lgr {
+
+namespace {
+
+// Bump whenever the list of fields in for_each_checkpoint_field or the
+// on-disk layout changes.
+constexpr std::uint32_t checkpoint_version = 8;
+constexpr std::uint64_t checkpoint_alignment = 4096;
+constexpr char          checkpoint_magic[8] = {'L', 'G', 'R', 'C', 'K', 'P', 'T', '\0'};
+#ifdef HPC_CUDA
+constexpr std::uint32_t checkpoint_flags = 1;
+#else
+constexpr std::uint32_t checkpoint_flags = 0;
+#endif
+
+struct checkpoint_header
+{
+  char          magic[8];
+  std::uint32_t version;
+  std::uint32_t flags;
+  std::uint64_t block_count;
+  std::uint64_t directory_offset;
+};
+
+struct checkpoint_block
+{
+  char          name[48];
+  std::uint64_t element_size;
+  std::uint64_t count;
+  std::uint64_t offset;
+};
+
+template <class State, class Visitor>
+void
+for_each_checkpoint_field(State& s, Visitor& v)
+{
+  v("n", s.n);
+  v("time", s.time);
+  v("elements", s.elements);
+  v("nodes_in_element", s.nodes_in_element);
+  v("nodes", s.nodes);
+  v("points", s.points);
+  v("points_in_element", s.points_in_element);
+  v("elements_to_nodes", s.elements_to_nodes);
+  v("nodes_to_node_elements", s.nodes_to_node_elements);
+  v("node_elements_to_elements", s.node_elements_to_elements);
+  v("node_elements_to_nodes_in_element", s.node_elements_to_nodes_in_element);
+  v("x", s.x);
+  v("u", s.u);
+  v("v", s.v);
+  v("V", s.V);
+  v("N", s.N);
+  v("grad_N", s.grad_N);
+  v("F_total", s.F_total);
+  v("sigma_full", s.sigma_full);
+  v("sigma", s.sigma);
+  v("symm_grad_v", s.symm_grad_v);
+  v("p", s.p);
+  v("v_prime", s.v_prime);
+  v("p_prime", s.p_prime);
+  v("q", s.q);
+  v("W", s.W);
+  v("p_h_dot", s.p_h_dot);
+  v("p_h", s.p_h);
+  v("K", s.K);
+  v("K_h", s.K_h);
+  v("G", s.G);
+  v("c", s.c);
+  v("element_f", s.element_f);
+  v("f", s.f);
+  v("rho", s.rho);
+  v("e", s.e);
+  v("rho_e_dot", s.rho_e_dot);
+  v("mass", s.mass);
+  v("material_mass", s.material_mass);
+  v("a", s.a);
+  v("h_min", s.h_min);
+  v("h_art", s.h_art);
+  v("nu_art", s.nu_art);
+  v("element_dt", s.element_dt);
+  v("e_h", s.e_h);
+  v("e_h_dot", s.e_h_dot);
+  v("rho_h", s.rho_h);
+  v("dp_de_h", s.dp_de_h);
+  v("material", s.material);
+  v("nodal_materials", s.nodal_materials);
+  v("quality", s.quality);
+  v("h_adapt", s.h_adapt);
+  v("node_set_offsets", s.node_sets.offsets);
+  v("node_set_items", s.node_sets.items);
+  v("element_nodes_to_material_nodes", s.element_nodes_to_material_nodes);
+  v("element_set_offsets", s.element_sets.offsets);
+  v("element_set_items", s.element_sets.items);
+  v("next_file_output_time", s.next_file_output_time);
+  v("adapt_epoch", s.adapt_epoch);
+  v("dt", s.dt);
+  v("dt_old", s.dt_old);
+  v("max_stable_dt", s.max_stable_dt);
+  v("min_quality", s.min_quality);
+  v("use_comptet_stabilization", s.use_comptet_stabilization);
+  v("JavgJ", s.JavgJ);
+  v("num_time_steps", s.num_time_steps);
+  v("points_to_point_nodes", s.points_to_point_nodes);
+  v("nodes_to_node_points", s.nodes_to_node_points);
+  v("point_nodes_to_nodes", s.point_nodes_to_nodes);
+  v("node_points_to_points", s.node_points_to_points);
+  v("node_points_to_point_nodes", s.node_points_to_point_nodes);
+  v("lm", s.lm);
+  v("xp", s.xp);
+  v("b", s.b);
+  v("h_otm", s.h_otm);
+  v("mu", s.mu);
+  v("maxent_r", s.maxent_r);
+  v("nearest_point_neighbor", s.nearest_point_neighbor);
+  v("nearest_point_neighbor_dist", s.nearest_point_neighbor_dist);
+  v("nearest_node_neighbor", s.nearest_node_neighbor);
+  v("nearest_node_neighbor_dist", s.nearest_node_neighbor_dist);
+  v("potential_density", s.potential_density);
+  v("prescribed_v", s.prescribed_v);
+  v("prescribed_dof", s.prescribed_dof);
+  v("boundaries", s.boundaries);
+  v("maxent_desired_tolerance", s.maxent_desired_tolerance);
+  v("maxent_acceptable_tolerance", s.maxent_acceptable_tolerance);
+  v("maxent_update_tolerance", s.maxent_update_tolerance);
+  v("contact_penalty_coeff", s.contact_penalty_coeff);
+  v("use_displacement_contact", s.use_displacement_contact);
+  v("use_penalty_contact", s.use_penalty_contact);
+  v("min_point_neighbor_dist", s.min_point_neighbor_dist);
+  v("min_node_neighbor_dist", s.min_node_neighbor_dist);
+  v("otm_beta", s.otm_beta);
+  v("otm_gamma", s.otm_gamma);
+  v("use_maxent_log_objective", s.use_maxent_log_objective);
+  v("use_maxent_line_search", s.use_maxent_line_search);
+  v("Fp_total", s.Fp_total);
+  v("temp", s.temp);
+  v("ep", s.ep);
+  v("ep_dot", s.ep_dot);
+}
+
+inline std::string
+subfield_name(std::string const& name, std::ptrdiff_t const i)
+{
+  return name + "_" + std::to_string(i);
+}
+
+class checkpoint_writer
+{
+  std::ofstream                 stream;
+  std::vector<checkpoint_block> blocks;
+  std::uint64_t                 offset{0};
+
+  void
+  write_bytes(void const* data, std::uint64_t const size)
+  {
+    stream.write(static_cast<char const*>(data), std::streamsize(size));
+    offset += size;
+  }
+  void
+  write_block(std::string const& name, void const* data, std::uint64_t const element_size, std::uint64_t const count)
+  {
+    if (name.size() >= sizeof(checkpoint_block::name)) {
+      throw std::runtime_error("checkpoint field name too long: " + name);
+    }
+    auto const padding = (checkpoint_alignment - (offset % checkpoint_alignment)) % checkpoint_alignment;
+    if (padding != 0) {
+      char const zeros[checkpoint_alignment] = {};
+      write_bytes(zeros, padding);
+    }
+    checkpoint_block block;
+    std::memset(&block, 0, sizeof(block));
+    std::strncpy(block.name, name.c_str(), sizeof(block.name) - 1);
+    block.element_size = element_size;
+    block.count        = count;
+    block.offset       = offset;
+    blocks.push_back(block);
+    if (count != 0) write_bytes(data, element_size * count);
+  }
+
+ public:
+  checkpoint_writer(std::string const& filename) : stream(filename, std::ios::binary | std::ios::trunc)
+  {
+    if (!stream) throw std::runtime_error("could not open checkpoint file " + filename + " for writing");
+    checkpoint_header header;
+    std::memset(&header, 0, sizeof(header));
+    write_bytes(&header, sizeof(header));
+  }
+  void
+  finish()
+  {
+    checkpoint_header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, checkpoint_magic, sizeof(header.magic));
+    header.version          = checkpoint_version;
+    header.flags            = checkpoint_flags;
+    header.block_count      = blocks.size();
+    header.directory_offset = offset;
+    write_bytes(blocks.data(), blocks.size() * sizeof(checkpoint_block));
+    stream.seekp(0);
+    stream.write(reinterpret_cast<char const*>(&header), sizeof(header));
+    stream.close();
+    if (!stream) throw std::runtime_error("error while writing checkpoint file");
+  }
+  template <class T>
+  void
+  operator()(std::string const& name, T const& value)
+  {
+    static_assert(std::is_trivially_copyable<T>::value, "checkpoint scalars must be trivially copyable");
+    write_block(name, &value, sizeof(T), 1);
+  }
+  template <class T, class A, class I>
+  void
+  operator()(std::string const& name, hpc::vector<T, A, hpc::serial_policy, I> const& vec)
+  {
+    static_assert(std::is_trivially_copyable<T>::value, "checkpoint vectors must hold trivially copyable types");
+    write_block(name, vec.data(), sizeof(T), std::uint64_t(hpc::weaken(vec.size())));
+  }
+  template <class T, hpc::layout L, class A, class I>
+  void
+  operator()(std::string const& name, hpc::array_vector<T, L, A, hpc::serial_policy, I> const& vec)
+  {
+    using array_value_type = typename hpc::array_vector<T, L, A, hpc::serial_policy, I>::array_value_type;
+    auto const count       = std::uint64_t(hpc::weaken(vec.size())) * std::uint64_t(vec.array_size());
+    write_block(name, vec.data(), sizeof(array_value_type), count);
+  }
+  template <class T, class A, class I>
+  void
+  operator()(std::string const& name, hpc::range_sum<T, A, hpc::serial_policy, I> const& ranges)
+  {
+    auto const count = ranges.data() ? std::uint64_t(hpc::weaken(ranges.size())) + 1 : 0;
+    write_block(name, ranges.data(), sizeof(T), count);
+  }
+#ifdef HPC_CUDA
+  template <class T, class I>
+  void
+  operator()(std::string const& name, hpc::device_vector<T, I> const& vec)
+  {
+    hpc::pinned_vector<T, I> staged(vec.size());
+    hpc::copy(vec, staged);
+    (*this)(name, staged);
+  }
+  template <class T, class I>
+  void
+  operator()(std::string const& name, hpc::device_array_vector<T, I> const& vec)
+  {
+    hpc::pinned_array_vector<T, I> staged(vec.size());
+    hpc::copy(vec, staged);
+    (*this)(name, staged);
+  }
+  template <class T, class I>
+  void
+  operator()(std::string const& name, hpc::device_range_sum<T, I> const& ranges)
+  {
+    auto const count = ranges.data() ? ranges.size() + 1 : I(0);
+    hpc::pinned_vector<T, I> staged(count);
+    auto err = cudaMemcpy(staged.data(), ranges.data(), std::size_t(count) * sizeof(T), cudaMemcpyDeviceToHost);
+    if (err != cudaSuccess) throw std::runtime_error("could not stage " + name + " for checkpoint");
+    (*this)(name, staged);
+  }
+#endif
+  template <class T, class A, class P, class I2, class I>
+  void
+  operator()(std::string const& name, hpc::host_vector<hpc::vector<T, A, P, I2>, I> const& per_material)
+  {
+    write_block(name, nullptr, 0, std::uint64_t(hpc::weaken(per_material.size())));
+    for (I i(0); i < per_material.size(); ++i) { (*this)(subfield_name(name, hpc::weaken(i)), per_material[i]); }
+  }
+};
+
+class checkpoint_reader
+{
+  int                                     file{-1};
+  void*                                   mapping{nullptr};
+  std::size_t                             mapping_size{0};
+  std::map<std::string, checkpoint_block> blocks;
+
+  checkpoint_block const&
+  find_block(std::string const& name, std::uint64_t const element_size) const
+  {
+    auto const it = blocks.find(name);
+    if (it == blocks.end()) throw std::runtime_error("checkpoint is missing field " + name);
+    if (it->second.element_size != element_size) {
+      throw std::runtime_error("checkpoint field " + name + " has an unexpected element size");
+    }
+    return it->second;
+  }
+  void
+  release()
+  {
+    if (mapping && mapping != MAP_FAILED) ::munmap(mapping, mapping_size);
+    if (file >= 0) ::close(file);
+    mapping = nullptr;
+    file    = -1;
+  }
+  char const*
+  block_data(checkpoint_block const& block) const
+  {
+    return static_cast<char const*>(mapping) + block.offset;
+  }
+
+ public:
+  checkpoint_reader(std::string const& filename)
+  {
+    file = ::open(filename.c_str(), O_RDONLY);
+    if (file < 0) throw std::runtime_error("could not open checkpoint file " + filename);
+    struct stat file_stat;
+    if (::fstat(file, &file_stat) != 0 || std::size_t(file_stat.st_size) < sizeof(checkpoint_header)) {
+      ::close(file);
+      throw std::runtime_error("checkpoint file " + filename + " is truncated");
+    }
+    mapping_size = std::size_t(file_stat.st_size);
+    mapping      = ::mmap(nullptr, mapping_size, PROT_READ, MAP_PRIVATE, file, 0);
+    if (mapping == MAP_FAILED) {
+      ::close(file);
+      throw std::runtime_error("could not map checkpoint file " + filename);
+    }
+    checkpoint_header header;
+    std::memcpy(&header, mapping, sizeof(header));
+    auto const directory_end = header.directory_offset + header.block_count * sizeof(checkpoint_block);
+    if (std::memcmp(header.magic, checkpoint_magic, sizeof(header.magic)) != 0 ||
+        header.version != checkpoint_version || header.flags != checkpoint_flags || directory_end > mapping_size) {
+      release();
+      throw std::runtime_error("checkpoint file " + filename + " is not compatible with this build");
+    }
+    auto const directory = reinterpret_cast<checkpoint_block const*>(static_cast<char const*>(mapping) + header.directory_offset);
+    for (std::uint64_t i = 0; i < header.block_count; ++i) {
+      auto const& block = directory[i];
+      if (block.offset + block.element_size * block.count > mapping_size) {
+        release();
+        throw std::runtime_error("checkpoint file " + filename + " is truncated");
+      }
+      blocks[std::string(block.name)] = block;
+    }
+    ::madvise(mapping, mapping_size, MADV_SEQUENTIAL);
+  }
+  checkpoint_reader(checkpoint_reader const&) = delete;
+  checkpoint_reader&
+  operator=(checkpoint_reader const&) = delete;
+  ~checkpoint_reader() { release(); }
+  template <class T>
+  void
+  operator()(std::string const& name, T& value)
+  {
+    static_assert(std::is_trivially_copyable<T>::value, "checkpoint scalars must be trivially copyable");
+    auto const& block = find_block(name, sizeof(T));
+    std::memcpy(&value, block_data(block), sizeof(T));
+  }
+  template <class T, class A, class I>
+  void
+  operator()(std::string const& name, hpc::vector<T, A, hpc::serial_policy, I>& vec)
+  {
+    auto const& block = find_block(name, sizeof(T));
+    vec.resize(I(std::ptrdiff_t(block.count)));
+    if (block.count != 0) std::memcpy(vec.data(), block_data(block), block.count * sizeof(T));
+  }
+  template <class T, hpc::layout L, class A, class I>
+  void
+  operator()(std::string const& name, hpc::array_vector<T, L, A, hpc::serial_policy, I>& vec)
+  {
+    using array_value_type = typename hpc::array_vector<T, L, A, hpc::serial_policy, I>::array_value_type;
+    auto const& block      = find_block(name, sizeof(array_value_type));
+    vec.resize(I(std::ptrdiff_t(block.count / std::uint64_t(vec.array_size()))));
+    if (block.count != 0) std::memcpy(vec.data(), block_data(block), block.count * sizeof(array_value_type));
+  }
+  template <class T, class A, class I>
+  void
+  operator()(std::string const& name, hpc::range_sum<T, A, hpc::serial_policy, I>& ranges)
+  {
+    auto const& block = find_block(name, sizeof(T));
+    if (block.count == 0) {
+      ranges.clear();
+      return;
+    }
+    ranges.resize(I(std::ptrdiff_t(block.count - 1)));
+    std::memcpy(ranges.data(), block_data(block), block.count * sizeof(T));
+  }
+#ifdef HPC_CUDA
+  template <class T, class I>
+  void
+  operator()(std::string const& name, hpc::device_vector<T, I>& vec)
+  {
+    hpc::pinned_vector<T, I> staged;
+    (*this)(name, staged);
+    vec.resize(staged.size());
+    hpc::copy(staged, vec);
+  }
+  template <class T, class I>
+  void
+  operator()(std::string const& name, hpc::device_array_vector<T, I>& vec)
+  {
+    hpc::pinned_array_vector<T, I> staged;
+    (*this)(name, staged);
+    vec.resize(staged.size());
+    hpc::copy(staged, vec);
+  }
+  template <class T, class I>
+  void
+  operator()(std::string const& name, hpc::device_range_sum<T, I>& ranges)
+  {
+    auto const& block = find_block(name, sizeof(T));
+    if (block.count == 0) {
+      ranges.clear();
+      return;
+    }
+    ranges.resize(I(std::ptrdiff_t(block.count - 1)));
+    auto err = cudaMemcpy(ranges.data(), block_data(block), block.count * sizeof(T), cudaMemcpyHostToDevice);
+    if (err != cudaSuccess) throw std::runtime_error("could not restore " + name + " from checkpoint");
+  }
+#endif
+  template <class T, class A, class P, class I2, class I>
+  void
+  operator()(std::string const& name, hpc::host_vector<hpc::vector<T, A, P, I2>, I>& per_material)
+  {
+    auto const& block = find_block(name, 0);
+    per_material.resize(I(std::ptrdiff_t(block.count)));
+    for (I i(0); i < per_material.size(); ++i) { (*this)(subfield_name(name, hpc::weaken(i)), per_material[i]); }
+  }
+};
+
+}  // namespace
+
+void
+write_checkpoint(std::string const& filename, state const& s)
+{
+  checkpoint_writer writer(filename);
+  for_each_checkpoint_field(s, writer);
+  writer.finish();
+}
+
+void
+read_checkpoint(std::string const& filename, state& s)
+{
+  checkpoint_reader reader(filename);
+  for_each_checkpoint_field(s, reader);
+}
+
+}  // namespace lgr
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <string>
+
+namespace lgr {
+
+class state;
+
+// Binary checkpoint of the full simulation state (mesh, connectivity, fields and
+// the OTM data structures). Every vector is stored as a raw page-aligned block,
+// so reading a checkpoint back maps the file and copies the blocks into place.
+void
+write_checkpoint(std::string const& filename, state const& s);
+void
+read_checkpoint(std::string const& filename, state& s);
+
+}  // namespace lgr
@@ -12,9 +12,10 @@ get_O_inv(O_t const& O, O_t& O_inv) noexcept
   for (int tet = 0; tet < 12; ++tet) { O_inv[tet] = inverse(O[tet]); }
 }
 
-HPC_NOINLINE HPC_HOST_DEVICE inline void
-get_subtet_proj_M(subtet_proj_t& sub_tet_int_proj_M) noexcept
+HPC_HOST_DEVICE constexpr inline subtet_proj_t
+get_subtet_proj_M() noexcept
 {
+  subtet_proj_t sub_tet_int_proj_M{};
   sub_tet_int_proj_M[0](0, 0)  = 0.008333333333333333;
   sub_tet_int_proj_M[0](0, 1)  = 0.0015625;
   sub_tet_int_proj_M[0](0, 2)  = 0.0015625;
@@ -207,14 +208,14 @@ get_subtet_proj_M(subtet_proj_t& sub_tet_int_proj_M) noexcept
   sub_tet_int_proj_M[11](3, 1) = 0.0003255208333333333;
   sub_tet_int_proj_M[11](3, 2) = 0.0003255208333333333;
   sub_tet_int_proj_M[11](3, 3) = 0.0004557291666666667;
+  return sub_tet_int_proj_M;
 }
 
 HPC_NOINLINE HPC_HOST_DEVICE inline void
 get_M_inv(hpc::array<double, 12> const& O_det, matrix4x4<double>& M_inv) noexcept
 {
-  auto          M = matrix4x4<double>::zero();
-  subtet_proj_t sub_tet_int_proj_M;
-  get_subtet_proj_M(sub_tet_int_proj_M);
+  constexpr auto sub_tet_int_proj_M = get_subtet_proj_M();
+  auto           M                  = matrix4x4<double>::zero();
   for (int tet = 0; tet < 12; ++tet) {
     for (int i = 0; i < 4; ++i) {
       for (int j = 0; j < 4; ++j) { M(i, j) += O_det[tet] * sub_tet_int_proj_M[tet](i, j); }
@@ -254,13 +255,10 @@ get_basis_gradients(
   for (auto& a : grad_N) {
     for (auto& b : a) { b = hpc::vector3<double>::zero(); }
   }
-  hpc::array<hpc::vector3<double>, 4> ref_points;
-  get_ref_points(ref_points);
-  subtet_int_t subtet_int;
-  get_subtet_int(subtet_int);
-  S_t S;
-  get_S(S);
-  O_t O;
+  constexpr auto lambda     = get_ref_barycentric();
+  constexpr auto subtet_int = get_subtet_int();
+  constexpr auto S          = get_S();
+  O_t            O;
   get_O(node_coords, S, O);
   O_t O_inv;
   get_O_inv(O, O_inv);
@@ -272,10 +270,9 @@ get_basis_gradients(
   get_SOL(O_det, O_inv, subtet_int, S, SOL);
   for (int node = 0; node < 10; ++node) {
     for (int pt = 0; pt < 4; ++pt) {
-      auto const lambda = get_barycentric(ref_points[pt]);
       for (int d = 0; d < 3; ++d) {
         for (int l1 = 0; l1 < 4; ++l1) {
-          for (int l2 = 0; l2 < 4; ++l2) { grad_N[pt][node](d) += lambda[l1] * M_inv(l1, l2) * SOL[l2][node](d); }
+          for (int l2 = 0; l2 < 4; ++l2) { grad_N[pt][node](d) += lambda[pt][l1] * M_inv(l1, l2) * SOL[l2][node](d); }
         }
       }
     }
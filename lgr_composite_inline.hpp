@@ -9,19 +9,38 @@
 namespace lgr {
 namespace composite_tetrahedron {
 
-using S_t           = hpc::array<hpc::array<hpc::vector3<double>, 10>, 12>;
-using gamma_t       = hpc::array<hpc::array<hpc::array<double, 10>, 10>, 12>;
-using subtet_proj_t = hpc::array<matrix4x4<double>, 12>;
-using subtet_int_t  = hpc::array<hpc::array<double, 4>, 12>;
-using O_t           = hpc::array<hpc::matrix3x3<double>, 12>;
-using SOL_t         = hpc::array<hpc::array<hpc::vector3<double>, 10>, 4>;
-
-HPC_NOINLINE HPC_HOST_DEVICE inline void
-get_S(S_t& S) noexcept
+// reference-element data is built at compile time, so it lives in aggregate tables
+// (hpc::array is not a literal type in C++14)
+template <class T, int N>
+struct table
 {
-  for (auto& a : S) {
-    for (auto& b : a) { b = hpc::vector3<double>::zero(); }
+  T values[N];
+  HPC_ALWAYS_INLINE HPC_HOST_DEVICE constexpr T&
+                                              operator[](int const i) noexcept
+  {
+    return values[i];
+  }
+  HPC_ALWAYS_INLINE HPC_HOST_DEVICE constexpr T const&
+                                              operator[](int const i) const noexcept
+  {
+    return values[i];
   }
+};
+
+using S_t            = table<table<hpc::vector3<double>, 10>, 12>;
+using gamma_t        = table<table<table<double, 10>, 10>, 12>;
+using subtet_proj_t  = table<matrix4x4<double>, 12>;
+using subtet_int_t   = table<table<double, 4>, 12>;
+using ref_points_t   = table<hpc::vector3<double>, 4>;
+using barycentric_t  = table<table<double, 4>, 4>;
+using lumped_gamma_t = table<table<double, 10>, 12>;
+using O_t            = hpc::array<hpc::matrix3x3<double>, 12>;
+using SOL_t          = hpc::array<hpc::array<hpc::vector3<double>, 10>, 4>;
+
+HPC_HOST_DEVICE constexpr inline S_t
+get_S() noexcept
+{
+  S_t S{};
   S[0][0](0)  = -2;
   S[0][0](1)  = -2;
   S[0][0](2)  = -2;
@@ -142,16 +161,13 @@ get_S(S_t& S) noexcept
   S[11][9](0) = 0.6666666666666666;
   S[11][9](1) = 0.6666666666666666;
   S[11][9](2) = 0.6666666666666666;
+  return S;
 }
 
-HPC_NOINLINE HPC_HOST_DEVICE inline void
-get_gamma(gamma_t& gamma) noexcept
+HPC_HOST_DEVICE constexpr inline gamma_t
+get_gamma() noexcept
 {
-  for (auto& a : gamma) {
-    for (auto& b : a) {
-      for (auto& c : b) { c = 0.0; }
-    }
-  }
+  gamma_t gamma{};
   gamma[0][0][0]  = 0.0020833333333333333;
   gamma[0][0][4]  = 0.0010416666666666667;
   gamma[0][0][6]  = 0.0010416666666666667;
@@ -504,6 +520,21 @@ get_gamma(gamma_t& gamma) noexcept
   gamma[11][9][7] = 0.00011574074074074075;
   gamma[11][9][8] = 0.000028935185185185186;
   gamma[11][9][9] = 0.000028935185185185186;
+  return gamma;
+}
+
+// row sums of gamma: the lumped mass of each subtet needs nothing else
+HPC_HOST_DEVICE constexpr inline lumped_gamma_t
+get_lumped_gamma() noexcept
+{
+  constexpr auto gamma = get_gamma();
+  lumped_gamma_t lumped{};
+  for (int tet = 0; tet < 12; ++tet) {
+    for (int i = 0; i < 10; ++i) {
+      for (int j = 0; j < 10; ++j) { lumped[tet][i] += gamma[tet][i][j]; }
+    }
+  }
+  return lumped;
 }
 
 HPC_NOINLINE HPC_HOST_DEVICE inline void
@@ -525,20 +556,10 @@ get_O_det(O_t const& O, hpc::array<double, 12>& det_O) noexcept
   for (int tet = 0; tet < 12; ++tet) { det_O[tet] = determinant(O[tet]); }
 }
 
-static HPC_ALWAYS_INLINE HPC_HOST_DEVICE hpc::array<double, 4>
-                                         get_barycentric(hpc::vector3<double> const x) noexcept
-{
-  hpc::array<double, 4> xi;
-  xi[0] = 1.0 - x(0) - x(1) - x(2);
-  xi[1] = x(0);
-  xi[2] = x(1);
-  xi[3] = x(2);
-  return xi;
-}
-
-HPC_NOINLINE HPC_HOST_DEVICE inline void
-get_ref_points(hpc::array<hpc::vector3<double>, 4>& pts) noexcept
+HPC_HOST_DEVICE constexpr inline ref_points_t
+get_ref_points() noexcept
 {
+  ref_points_t pts{};
   pts[0](0) = 0.1381966011250105151795413165634361882280;
   pts[0](1) = 0.1381966011250105151795413165634361882280;
   pts[0](2) = 0.1381966011250105151795413165634361882280;
@@ -551,13 +572,28 @@ get_ref_points(hpc::array<hpc::vector3<double>, 4>& pts) noexcept
   pts[3](0) = 0.1381966011250105151795413165634361882280;
   pts[3](1) = 0.1381966011250105151795413165634361882280;
   pts[3](2) = 0.5854101966249684544613760503096914353161;
+  return pts;
 }
 
-HPC_NOINLINE HPC_HOST_DEVICE inline void
-get_subtet_int(subtet_int_t& subtet_int) noexcept
+// barycentric coordinates of the reference integration points
+HPC_HOST_DEVICE constexpr inline barycentric_t
+get_ref_barycentric() noexcept
+{
+  constexpr auto pts = get_ref_points();
+  barycentric_t  lambda{};
+  for (int pt = 0; pt < 4; ++pt) {
+    lambda[pt][0] = 1.0 - pts[pt](0) - pts[pt](1) - pts[pt](2);
+    lambda[pt][1] = pts[pt](0);
+    lambda[pt][2] = pts[pt](1);
+    lambda[pt][3] = pts[pt](2);
+  }
+  return lambda;
+}
+
+HPC_HOST_DEVICE constexpr inline subtet_int_t
+get_subtet_int() noexcept
 {
-  assert(subtet_int.size() == 12);
-  assert(subtet_int[0].size() == 4);
+  subtet_int_t subtet_int{};
   subtet_int[0][0]  = 0.013020833333333334;
   subtet_int[0][1]  = 0.0026041666666666665;
   subtet_int[0][2]  = 0.0026041666666666665;
@@ -606,6 +642,7 @@ get_subtet_int(subtet_int_t& subtet_int) noexcept
   subtet_int[11][1] = 0.001953125;
   subtet_int[11][2] = 0.001953125;
   subtet_int[11][3] = 0.001953125;
+  return subtet_int;
 }
 
 }  // namespace composite_tetrahedron
@@ -15,7 +15,7 @@ get_parent_M_inv() noexcept
 }
 
 HPC_HOST_DEVICE inline hpc::array<double, 4>
-get_DOL(hpc::array<double, 12> O_det, subtet_int_t subtet_int) noexcept
+get_DOL(hpc::array<double, 12> const& O_det, subtet_int_t const& subtet_int) noexcept
 {
   hpc::array<double, 4> DOL;
   for (auto& a : DOL) a = 0.0;
@@ -32,22 +32,18 @@ get_volumes(hpc::array<hpc::vector3<double>, 10> const node_coords) noexcept
   constexpr double      ip_weight = 1.0 / 24.0;
   hpc::array<double, 4> volumes;
   for (auto& a : volumes) a = 0.0;
-  hpc::array<hpc::vector3<double>, 4> ref_points;
-  get_ref_points(ref_points);
-  subtet_int_t sub_tet_int;
-  get_subtet_int(sub_tet_int);
-  S_t S;
-  get_S(S);
-  O_t O;
+  constexpr auto lambda      = get_ref_barycentric();
+  constexpr auto sub_tet_int = get_subtet_int();
+  constexpr auto S           = get_S();
+  O_t            O;
   get_O(node_coords, S, O);
   hpc::array<double, 12> O_det;
   get_O_det(O, O_det);
   auto const DOL          = get_DOL(O_det, sub_tet_int);
   auto const parent_M_inv = get_parent_M_inv();
   for (int pt = 0; pt < 4; ++pt) {
-    auto const lambda = get_barycentric(ref_points[pt]);
     for (int l1 = 0; l1 < 4; ++l1) {
-      for (int l2 = 0; l2 < 4; ++l2) { volumes[pt] += lambda[l1] * parent_M_inv(l1, l2) * DOL[l2]; }
+      for (int l2 = 0; l2 < 4; ++l2) { volumes[pt] += lambda[pt][l1] * parent_M_inv(l1, l2) * DOL[l2]; }
     }
     volumes[pt] *= ip_weight;
   }
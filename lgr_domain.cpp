@@ -1,11 +1,21 @@
+#include <algorithm>
+#include <cmath>
+#include <hpc_atomic.hpp>
 #include <lgr_domain.hpp>
 #include <lgr_input.hpp>
 #include <lgr_state.hpp>
+#include <numeric>
 
 namespace lgr {
 
 domain::~domain() {}
 
+bool
+domain::flatten(material_index const, std::vector<domain_shape>&, std::vector<plane>&) const
+{
+  return false;
+}
+
 void
 union_domain::add(std::unique_ptr<domain>&& uptr)
 {
@@ -41,34 +51,273 @@ union_domain::mark(
   for (auto const& uptr : m_domains) { uptr->mark(points, marker, markers); }
 }
 
-template <class Index, class IsInFunctor>
-HPC_NOINLINE void
-collect_set(
-    hpc::counting_range<Index> const range,
-    IsInFunctor                      is_in_functor,
-    hpc::device_vector<Index, int>&  set_items);
-template <class Index, class IsInFunctor>
+bool
+union_domain::flatten(material_index const marker, std::vector<domain_shape>& shapes, std::vector<plane>& clips) const
+{
+  for (auto const& uptr : m_domains) {
+    if (!uptr->flatten(marker, shapes, clips)) return false;
+  }
+  return true;
+}
+
+namespace {
+
+template <class ClipIterator>
+HPC_ALWAYS_INLINE HPC_HOST_DEVICE bool
+is_in_shape(domain_shape const& shape, ClipIterator const clips, hpc::position<double> const pt) noexcept
+{
+  bool is_in = true;
+  switch (shape.kind) {
+    case domain_shape::ALL_SPACE: break;
+    case domain_shape::SPHERE: is_in = (distance(shape.sphere_source, pt) >= 0.0); break;
+    case domain_shape::CYLINDER: is_in = (distance(shape.cylinder_source, pt) >= 0.0); break;
+  }
+  for (int i = 0; i < shape.clip_count; ++i) { is_in &= (distance(clips[shape.first_clip + i], pt) >= 0.0); }
+  return is_in;
+}
+
+struct bounding_box_union
+{
+  HPC_ALWAYS_INLINE HPC_HOST_DEVICE bounding_box
+  operator()(bounding_box const& a, bounding_box const& b) const noexcept
+  {
+    bounding_box c;
+    for (int i = 0; i < 3; ++i) {
+      c.lower(i) = hpc::min(a.lower(i), b.lower(i));
+      c.upper(i) = hpc::max(a.upper(i), b.upper(i));
+    }
+    return c;
+  }
+};
+
+// uniform grid over the bounding box of the points, about 8 points per cell
+class domain_grid
+{
+ public:
+  hpc::position<double> lower;
+  hpc::position<double> cell_size;
+  int                   dims[3];
+
+  template <class Index>
+  explicit domain_grid(hpc::device_array_vector<hpc::position<double>, Index> const& points)
+  {
+    auto const   points_begin = points.cbegin();
+    double const big          = hpc::numeric_limits<double>::max();
+    bounding_box const empty{hpc::position<double>(big, big, big), hpc::position<double>(-big, -big, -big)};
+    auto functor = [=] HPC_DEVICE(Index const i) -> bounding_box {
+      auto const pt = points_begin[i].load();
+      return {pt, pt};
+    };
+    hpc::counting_range<Index> const range(points.size());
+    auto const box = hpc::transform_reduce(hpc::device_policy(), range, empty, bounding_box_union(), functor);
+    lower          = box.lower;
+    double const target_cells = std::min(double(1 << 18), std::max(1.0, double(hpc::weaken(points.size())) / 8.0));
+    double       volume       = 1.0;
+    int          spanned      = 0;
+    for (int i = 0; i < 3; ++i) {
+      double const extent = double(box.upper(i) - box.lower(i));
+      if (extent > 0.0) {
+        volume *= extent;
+        ++spanned;
+      }
+    }
+    double const h = spanned == 0 ? 1.0 : std::pow(volume / target_cells, 1.0 / spanned);
+    for (int i = 0; i < 3; ++i) {
+      double const extent = double(box.upper(i) - box.lower(i));
+      dims[i]             = extent > 0.0 ? std::max(1, std::min(1024, int(std::ceil(extent / h)))) : 1;
+      cell_size(i)        = extent > 0.0 ? hpc::length<double>(extent / dims[i]) : hpc::length<double>(1.0);
+    }
+  }
+  int
+  size() const noexcept
+  {
+    return dims[0] * dims[1] * dims[2];
+  }
+  HPC_ALWAYS_INLINE HPC_HOST_DEVICE int
+  axis_cell(int const i, hpc::length<double> const x) const noexcept
+  {
+    double const c = double(x - lower(i)) / double(cell_size(i));
+    return c <= 0.0 ? 0 : c >= double(dims[i] - 1) ? dims[i] - 1 : int(c);
+  }
+  HPC_ALWAYS_INLINE HPC_HOST_DEVICE int
+  cell(hpc::position<double> const pt) const noexcept
+  {
+    return (axis_cell(2, pt(2)) * dims[1] + axis_cell(1, pt(1))) * dims[0] + axis_cell(0, pt(0));
+  }
+  // bounds of a cell, padded so points binned by round-off into a neighbor still count
+  bounding_box
+  cell_box(int const ix, int const iy, int const iz) const noexcept
+  {
+    int const    index[3] = {ix, iy, iz};
+    bounding_box box;
+    for (int i = 0; i < 3; ++i) {
+      auto const pad = 1.0e-3 * cell_size(i);
+      box.lower(i)   = lower(i) + double(index[i]) * cell_size(i) - pad;
+      box.upper(i)   = lower(i) + double(index[i] + 1) * cell_size(i) + pad;
+    }
+    return box;
+  }
+};
+
+// conservative: false only if no point of the box can be inside the shape
+bool
+may_intersect(domain_shape const& shape, std::vector<plane> const& clips, bounding_box const& box)
+{
+  for (int i = 0; i < 3; ++i) {
+    if (box.upper(i) < shape.bounds.lower(i) || shape.bounds.upper(i) < box.lower(i)) return false;
+  }
+  if (shape.kind == domain_shape::SPHERE) {
+    auto const& s      = shape.sphere_source;
+    double      dist_2 = 0.0;
+    for (int i = 0; i < 3; ++i) {
+      auto const nearest = hpc::max(box.lower(i), hpc::min(s.origin(i), box.upper(i)));
+      auto const d       = double(nearest - s.origin(i));
+      dist_2 += d * d;
+    }
+    if (dist_2 > double(s.radius) * double(s.radius)) return false;
+  }
+  for (int c = 0; c < shape.clip_count; ++c) {
+    auto const&         p        = clips[std::size_t(shape.first_clip + c)];
+    hpc::length<double> farthest = 0.0;
+    for (int i = 0; i < 3; ++i) { farthest += p.normal(i) * (p.normal(i) > 0.0 ? box.upper(i) : box.lower(i)); }
+    if (farthest < p.origin) return false;
+  }
+  return true;
+}
+
+template <class Index, class Marker, class Apply>
 void
-collect_set(
-    hpc::counting_range<Index> const range,
-    IsInFunctor                      is_in_functor,
-    hpc::device_vector<Index, int>&  set_items)
-{
-  hpc::device_vector<int, Index> offsets(range.size());
-  hpc::transform_inclusive_scan(hpc::device_policy(), range, offsets, hpc::plus<int>(), is_in_functor);
-  int const set_size = hpc::transform_reduce(hpc::device_policy(), range, int(0), hpc::plus<int>(), is_in_functor);
-  set_items.resize(set_size);
-  auto const set_items_to_items = set_items.begin();
-  auto const items_to_offsets   = offsets.cbegin();
-  auto       functor            = [=] HPC_DEVICE(Index const item) {
-    if (is_in_functor(item) != 0) { set_items_to_items[items_to_offsets[item] - 1] = item; }
+mark_domains_tmpl(
+    hpc::host_vector<std::unique_ptr<domain>, material_index> const& domains,
+    std::vector<material_index> const&                             markers,
+    hpc::device_array_vector<hpc::position<double>, Index> const&  points,
+    hpc::device_vector<Marker, Index>*                             out,
+    Apply const                                                    apply)
+{
+  std::vector<domain_shape> host_shapes;
+  std::vector<plane>        host_clips;
+  bool                      flat = true;
+  for (auto const marker : markers) {
+    auto const& d = domains[marker];
+    if (d) flat = flat && d->flatten(marker, host_shapes, host_clips);
+  }
+  if (!flat) {
+    for (auto const marker : markers) {
+      auto const& d = domains[marker];
+      if (d) d->mark(points, marker, out);
+    }
+    return;
+  }
+  if (host_shapes.empty() || points.size() == 0) return;
+  domain_grid const grid(points);
+  // candidate shapes of each cell as a CSR list, in marking order
+  std::vector<int> host_offsets(std::size_t(grid.size()) + 1, 0);
+  std::vector<int> host_cells;
+  std::vector<int> host_cell_shapes;
+  for (int shape = 0; shape < int(host_shapes.size()); ++shape) {
+    auto const& bounds = host_shapes[std::size_t(shape)].bounds;
+    int         first[3], last[3];
+    for (int i = 0; i < 3; ++i) {
+      auto const pad = 1.0e-3 * grid.cell_size(i);
+      first[i]       = bounds.lower(i) - pad <= grid.lower(i) ? 0 : grid.axis_cell(i, bounds.lower(i) - pad);
+      last[i] = bounds.upper(i) + pad >= grid.lower(i) + double(grid.dims[i]) * grid.cell_size(i)
+                    ? grid.dims[i] - 1
+                    : grid.axis_cell(i, bounds.upper(i) + pad);
+    }
+    for (int iz = first[2]; iz <= last[2]; ++iz) {
+      for (int iy = first[1]; iy <= last[1]; ++iy) {
+        for (int ix = first[0]; ix <= last[0]; ++ix) {
+          if (!may_intersect(host_shapes[std::size_t(shape)], host_clips, grid.cell_box(ix, iy, iz))) continue;
+          int const cell = (iz * grid.dims[1] + iy) * grid.dims[0] + ix;
+          ++host_offsets[std::size_t(cell) + 1];
+          host_cells.push_back(cell);
+        }
+      }
+    }
+    host_cell_shapes.resize(host_cells.size(), shape);
+  }
+  std::partial_sum(host_offsets.begin(), host_offsets.end(), host_offsets.begin());
+  // counting sort by cell, stable so shapes keep their order within a cell
+  auto fill   = std::vector<int>(host_offsets.begin(), host_offsets.end() - 1);
+  auto sorted = std::vector<int>(host_cells.size());
+  for (std::size_t i = 0; i < host_cells.size(); ++i) {
+    sorted[std::size_t(fill[std::size_t(host_cells[i])]++)] = host_cell_shapes[i];
+  }
+  hpc::pinned_vector<domain_shape, int> pinned_shapes(int(host_shapes.size()));
+  hpc::copy(hpc::serial_policy(), host_shapes, pinned_shapes);
+  hpc::device_vector<domain_shape, int> device_shapes(int(host_shapes.size()));
+  hpc::copy(pinned_shapes, device_shapes);
+  hpc::pinned_vector<plane, int> pinned_clips(int(host_clips.size()));
+  hpc::copy(hpc::serial_policy(), host_clips, pinned_clips);
+  hpc::device_vector<plane, int> device_clips(int(host_clips.size()));
+  hpc::copy(pinned_clips, device_clips);
+  hpc::pinned_vector<int, int> pinned_offsets(int(host_offsets.size()));
+  hpc::copy(hpc::serial_policy(), host_offsets, pinned_offsets);
+  hpc::device_vector<int, int> device_offsets(int(host_offsets.size()));
+  hpc::copy(pinned_offsets, device_offsets);
+  hpc::pinned_vector<int, int> pinned_cell_shapes(int(sorted.size()));
+  hpc::copy(hpc::serial_policy(), sorted, pinned_cell_shapes);
+  hpc::device_vector<int, int> device_cell_shapes(int(sorted.size()));
+  hpc::copy(pinned_cell_shapes, device_cell_shapes);
+  auto const points_begin      = points.cbegin();
+  auto const shapes_begin      = device_shapes.cbegin();
+  auto const clips_begin       = device_clips.cbegin();
+  auto const cells_to_offsets  = device_offsets.cbegin();
+  auto const cell_shapes_begin = device_cell_shapes.cbegin();
+  auto       functor           = [=] HPC_DEVICE(Index const i) {
+    auto const pt   = points_begin[i].load();
+    int const  cell = grid.cell(pt);
+    for (int j = cells_to_offsets[cell]; j < cells_to_offsets[cell + 1]; ++j) {
+      domain_shape const shape = shapes_begin[cell_shapes_begin[j]];
+      if (is_in_shape(shape, clips_begin, pt)) apply(i, shape.marker);
+    }
   };
+  hpc::counting_range<Index> const range(points.size());
   hpc::for_each(hpc::device_policy(), range, functor);
 }
 
+}  // namespace
+
+void
+mark_domains(
+    hpc::host_vector<std::unique_ptr<domain>, material_index> const& domains,
+    std::vector<material_index> const&                             markers,
+    hpc::device_array_vector<hpc::position<double>, element_index> const& points,
+    hpc::device_vector<material_index, element_index>*                    out)
+{
+  auto const out_begin = out->begin();
+  auto       apply     = [=] HPC_DEVICE(element_index const i, material_index const marker) { out_begin[i] = marker; };
+  mark_domains_tmpl(domains, markers, points, out, apply);
+}
+
+void
+mark_domains(
+    hpc::host_vector<std::unique_ptr<domain>, material_index> const& domains,
+    std::vector<material_index> const&                             markers,
+    hpc::device_array_vector<hpc::position<double>, node_index> const& points,
+    hpc::device_vector<material_set, node_index>*                      out)
+{
+  auto const out_begin = out->begin();
+  auto       apply     = [=] HPC_DEVICE(node_index const i, material_index const marker) {
+    material_set set = out_begin[i];
+    set              = set | material_set(marker);
+    out_begin[i]     = set;
+  };
+  mark_domains_tmpl(domains, markers, points, out, apply);
+}
+
+bool
+has_exodus_node_set(input const& in, material_index const boundary)
+{
+  return in.exodus_node_set_ids[boundary] != 0 || in.exodus_side_set_ids[boundary] != 0;
+}
+
 void
 assign_element_materials(input const& in, state& s)
 {
+  // read_exodus_file already assigned materials from the element blocks
+  auto const from_blocks = [](int const block_id) { return block_id != 0; };
+  if (hpc::any_of(hpc::serial_policy(), in.exodus_block_ids, from_blocks)) return;
   hpc::fill(hpc::device_policy(), s.material, material_index(0));
   hpc::device_array_vector<hpc::position<double>, element_index> centroid_vector(s.elements.size());
   auto const   elements_to_element_nodes = s.elements * s.nodes_in_element;
@@ -87,10 +336,28 @@ assign_element_materials(input const& in, state& s)
     elements_to_centroids[element] = centroid;
   };
   hpc::for_each(hpc::device_policy(), s.elements, centroid_functor);
-  for (auto const material : in.materials) {
-    auto const& domain = in.domains[material];
-    if (domain) { domain->mark(centroid_vector, material, &s.material); }
+  std::vector<material_index> materials;
+  for (auto const material : in.materials) materials.push_back(material);
+  mark_domains(in.domains, materials, centroid_vector, &s.material);
+}
+
+void
+mark_boundary_nodes(input const& in, state& s)
+{
+  std::vector<material_index> from_domains;
+  for (auto const boundary : in.boundaries) {
+    if (!has_exodus_node_set(in, boundary)) {
+      from_domains.push_back(boundary);
+      continue;
+    }
+    auto const nodes_to_materials = s.nodal_materials.begin();
+    auto const boundary_set       = material_set(boundary);
+    auto       functor            = [=] HPC_DEVICE(node_index const node) {
+      nodes_to_materials[node] = nodes_to_materials[node] | boundary_set;
+    };
+    hpc::for_each(hpc::device_policy(), s.node_sets[boundary], functor);
   }
+  mark_domains(in.domains, from_domains, s.x, &s.nodal_materials);
 }
 
 void
@@ -112,40 +379,57 @@ compute_nodal_materials(input const& in, state& s)
     nodes_to_materials[node] = node_materials;
   };
   hpc::for_each(hpc::device_policy(), s.nodes, functor);
-  for (auto const boundary : in.boundaries) {
-    auto const& domain = in.domains[boundary];
-    domain->mark(s.x, boundary, &s.nodal_materials);
-  }
+  mark_boundary_nodes(in, s);
 }
 
 void
 collect_node_sets(input const& in, state& s)
 {
-  hpc::counting_range<material_index> const all_materials(in.materials.size() + in.boundaries.size());
-  s.node_sets.resize(all_materials.size());
   assert(s.nodal_materials.size() == s.nodes.size());
   auto const nodes_to_materials = s.nodal_materials.cbegin();
-  for (auto const material : all_materials) {
-    auto is_in_functor = [=] HPC_DEVICE(node_index const node) -> int {
-      material_set const materials = nodes_to_materials[node];
-      return (materials.contains(material_set(material))) ? 1 : 0;
+  auto       sets_functor       = [=] HPC_DEVICE(node_index const node) -> material_set {
+    return nodes_to_materials[node];
+  };
+  bucket_sets(s.nodes, in.materials.size() + in.boundaries.size(), sets_functor, s.node_sets);
+}
+
+void
+collect_material_nodes(input const& in, state& s)
+{
+  s.element_nodes_to_material_nodes.resize(s.elements.size() * s.nodes_in_element.size());
+  auto const nodes_to_node_elements            = s.nodes_to_node_elements.cbegin();
+  auto const node_elements_to_elements         = s.node_elements_to_elements.cbegin();
+  auto const node_elements_to_nodes_in_element = s.node_elements_to_nodes_in_element.cbegin();
+  auto const elements_to_element_nodes         = s.elements * s.nodes_in_element;
+  auto const elements_to_materials             = s.material.cbegin();
+  auto const element_nodes_to_material_nodes   = s.element_nodes_to_material_nodes.begin();
+  for (auto const material : in.materials) {
+    auto const material_nodes          = s.node_sets[material];
+    auto const material_nodes_to_nodes = material_nodes.begin();
+    auto       functor                 = [=] HPC_DEVICE(material_node_index const material_node) {
+      node_index const node = material_nodes_to_nodes[hpc::weaken(material_node)];
+      for (auto const node_element : nodes_to_node_elements[node]) {
+        element_index const element = node_elements_to_elements[node_element];
+        if (elements_to_materials[element] != material) continue;
+        node_in_element_index const node_in_element = node_elements_to_nodes_in_element[node_element];
+        element_nodes_to_material_nodes[elements_to_element_nodes[element][node_in_element]] = material_node;
+      }
     };
-    collect_set(s.nodes, is_in_functor, s.node_sets[material]);
+    hpc::for_each(
+        hpc::device_policy(),
+        hpc::counting_range<material_node_index>(material_node_index(material_nodes.size())),
+        functor);
   }
 }
 
 void
 collect_element_sets(input const& in, state& s)
 {
-  s.element_sets.resize(in.materials.size());
   auto const elements_to_material = s.material.cbegin();
-  for (auto const material : in.materials) {
-    auto is_in_functor = [=] HPC_DEVICE(element_index const element) -> int {
-      material_index const element_material = elements_to_material[element];
-      return (element_material == material) ? 1 : 0;
-    };
-    collect_set(s.elements, is_in_functor, s.element_sets[material]);
-  }
+  auto       sets_functor         = [=] HPC_DEVICE(element_index const element) {
+    return material_set(material_index(elements_to_material[element]));
+  };
+  bucket_sets(s.elements, in.materials.size(), sets_functor, s.element_sets);
 }
 
 std::unique_ptr<domain>
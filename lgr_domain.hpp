@@ -2,10 +2,12 @@
 
 #include <hpc_array_vector.hpp>
 #include <hpc_dimensional.hpp>
+#include <hpc_functional.hpp>
 #include <hpc_numeric.hpp>
 #include <hpc_vector3.hpp>
 #include <lgr_material_set.hpp>
 #include <lgr_mesh_indices.hpp>
+#include <limits>
 #include <memory>
 #include <vector>
 
@@ -82,6 +84,98 @@ distance(extruded_sine_wave const w, hpc::vector3<double> const pt) noexcept
   return z_zero - z;
 }
 
+// conservative axis-aligned bounds of a domain, infinite along unbounded axes
+struct bounding_box
+{
+  hpc::position<double> lower;
+  hpc::position<double> upper;
+};
+
+inline bounding_box
+unbounded_box() noexcept
+{
+  auto const inf = std::numeric_limits<double>::infinity();
+  return {hpc::position<double>(-inf, -inf, -inf), hpc::position<double>(inf, inf, inf)};
+}
+
+// A domain reduced to plain data: one source shape intersected with the clip
+// planes clips[first_clip, first_clip + clip_count). Lets a single kernel test
+// every domain of a problem without virtual calls.
+struct domain_shape
+{
+  enum kind_type
+  {
+    ALL_SPACE,
+    SPHERE,
+    CYLINDER,
+  };
+  kind_type      kind;
+  lgr::sphere    sphere_source;
+  lgr::cylinder  cylinder_source;
+  bounding_box   bounds;
+  int            first_clip;
+  int            clip_count;
+  material_index marker;
+};
+
+inline bool
+make_domain_shape(all_space const, domain_shape& shape)
+{
+  shape.kind   = domain_shape::ALL_SPACE;
+  shape.bounds = unbounded_box();
+  return true;
+}
+
+inline bool
+make_domain_shape(sphere const& s, domain_shape& shape)
+{
+  shape.kind          = domain_shape::SPHERE;
+  shape.sphere_source = s;
+  auto const r        = hpc::position<double>(s.radius, s.radius, s.radius);
+  shape.bounds        = {s.origin - r, s.origin + r};
+  return true;
+}
+
+// only bounded across axes perpendicular to the cylinder axis
+inline bool
+make_domain_shape(cylinder const& c, domain_shape& shape)
+{
+  shape.kind            = domain_shape::CYLINDER;
+  shape.cylinder_source = c;
+  shape.bounds          = unbounded_box();
+  for (int i = 0; i < 3; ++i) {
+    if (c.axis(i) != 0.0) continue;
+    shape.bounds.lower(i) = c.origin(i) - c.radius;
+    shape.bounds.upper(i) = c.origin(i) + c.radius;
+  }
+  return true;
+}
+
+// sources without a plain-data form fall back to domain::mark
+template <class SourceDomain>
+bool
+make_domain_shape(SourceDomain const&, domain_shape&)
+{
+  return false;
+}
+
+// tightens the bounds by the clip planes that are normal to a coordinate axis
+inline void
+clip_bounds(plane const& p, bounding_box& bounds)
+{
+  for (int i = 0; i < 3; ++i) {
+    auto const j = (i + 1) % 3;
+    auto const k = (i + 2) % 3;
+    if (p.normal(i) == 0.0 || p.normal(j) != 0.0 || p.normal(k) != 0.0) continue;
+    hpc::length<double> const at = p.origin / p.normal(i);
+    if (p.normal(i) > 0.0) {
+      bounds.lower(i) = hpc::max(bounds.lower(i), at);
+    } else {
+      bounds.upper(i) = hpc::min(bounds.upper(i), at);
+    }
+  }
+}
+
 class domain
 {
  public:
@@ -105,6 +199,9 @@ class domain
       hpc::device_array_vector<hpc::position<double>, node_index> const& points,
       material_index const                                               marker,
       hpc::device_vector<material_set, node_index>*                      markers) const = 0;
+  // appends the plain-data form of this domain, false if it has none
+  virtual bool
+  flatten(material_index const marker, std::vector<domain_shape>& shapes, std::vector<plane>& clips) const;
 };
 
 template <class SourceDomain>
@@ -189,6 +286,21 @@ class clipped_domain : public domain
     };
     hpc::for_each(hpc::device_policy(), range, functor);
   }
+  bool
+  flatten(material_index const marker, std::vector<domain_shape>& shapes, std::vector<plane>& clips) const override
+  {
+    domain_shape shape;
+    if (!make_domain_shape(m_source, shape)) return false;
+    shape.first_clip = int(clips.size());
+    shape.clip_count = int(m_host_clips.size());
+    shape.marker     = marker;
+    for (auto const& p : m_host_clips) {
+      clips.push_back(p);
+      clip_bounds(p, shape.bounds);
+    }
+    shapes.push_back(shape);
+    return true;
+  }
 };
 
 class union_domain : public domain
@@ -215,6 +327,8 @@ class union_domain : public domain
       hpc::device_array_vector<hpc::position<double>, node_index> const& points,
       material_index const                                               marker,
       hpc::device_vector<material_set, node_index>*                      markers) const override;
+  bool
+  flatten(material_index const marker, std::vector<domain_shape>& shapes, std::vector<plane>& clips) const override;
 };
 
 std::unique_ptr<domain>
@@ -226,6 +340,23 @@ half_space_domain(plane const& p);
 std::unique_ptr<domain>
 box_domain(hpc::position<double> const lower_left, hpc::position<double> const upper_right);
 
+// Marks the points inside domains[m] for each m in markers, in that order, as
+// if by domains[m]->mark(points, m, out). Points are binned in a uniform grid
+// and each grid cell only tests the domains whose bounds reach it, all in one
+// pass over the points.
+void
+mark_domains(
+    hpc::host_vector<std::unique_ptr<domain>, material_index> const& domains,
+    std::vector<material_index> const&                             markers,
+    hpc::device_array_vector<hpc::position<double>, element_index> const& points,
+    hpc::device_vector<material_index, element_index>*                    out);
+void
+mark_domains(
+    hpc::host_vector<std::unique_ptr<domain>, material_index> const& domains,
+    std::vector<material_index> const&                             markers,
+    hpc::device_array_vector<hpc::position<double>, node_index> const& points,
+    hpc::device_vector<material_set, node_index>*                      out);
+
 class input;
 class state;
 
@@ -237,5 +368,14 @@ void
 collect_element_sets(input const& in, state& s);
 void
 collect_node_sets(input const& in, state& s);
+// fills s.element_nodes_to_material_nodes from the material node sets
+void
+collect_material_nodes(input const& in, state& s);
+// true if the nodes of this boundary come from an Exodus node set or side set
+bool
+has_exodus_node_set(input const& in, material_index const boundary);
+// adds the boundaries to s.nodal_materials, from their Exodus sets or else their domains
+void
+mark_boundary_nodes(input const& in, state& s);
 
 }  // namespace lgr
@@ -19,6 +19,17 @@ initialize_V(input const& in, state& s)
   }
 }
 
+void
+initialize_V(input const& in, state& s, element_list const elements)
+{
+  switch (in.element) {
+    case TRIANGLE: initialize_triangle_V(s, elements); break;
+    case TETRAHEDRON: initialize_tetrahedron_V(s, elements); break;
+    case BAR:
+    case COMPOSITE_TETRAHEDRON: assert(0); break;
+  }
+}
+
 void
 initialize_grad_N(input const& in, state& s)
 {
@@ -30,8 +41,20 @@ initialize_grad_N(input const& in, state& s)
   }
 }
 
-HPC_NOINLINE inline void
-update_h_min_height(input const&, state& s)
+void
+initialize_grad_N(input const& in, state& s, element_list const elements)
+{
+  switch (in.element) {
+    case TRIANGLE: initialize_triangle_grad_N(s, elements); break;
+    case TETRAHEDRON: initialize_tetrahedron_grad_N(s, elements); break;
+    case BAR:
+    case COMPOSITE_TETRAHEDRON: assert(0); break;
+  }
+}
+
+template <class Elements>
+HPC_NOINLINE void
+update_h_min_height(input const&, state& s, Elements const& elements)
 {
   auto const point_nodes_to_grad_N = s.grad_N.cbegin();
   auto const elements_to_h_min     = s.h_min.begin();
@@ -49,27 +72,45 @@ update_h_min_height(input const&, state& s)
     }
     elements_to_h_min[element] = min_height;
   };
-  hpc::for_each(hpc::device_policy(), s.elements, functor);
+  hpc::for_each(hpc::device_policy(), elements, functor);
 }
 
 HPC_NOINLINE inline void
 update_triangle_h_min(input const& in, state& s)
 {
   switch (in.h_min) {
-    case MINIMUM_HEIGHT: update_h_min_height(in, s); break;
+    case MINIMUM_HEIGHT: update_h_min_height(in, s, s.elements); break;
     case INBALL_DIAMETER: update_triangle_h_min_inball(in, s); break;
   }
 }
 
+HPC_NOINLINE inline void
+update_triangle_h_min(input const& in, state& s, element_list const elements)
+{
+  switch (in.h_min) {
+    case MINIMUM_HEIGHT: update_h_min_height(in, s, elements); break;
+    case INBALL_DIAMETER: update_triangle_h_min_inball(in, s, elements); break;
+  }
+}
+
 HPC_NOINLINE inline void
 update_tetrahedron_h_min(input const& in, state& s)
 {
   switch (in.h_min) {
-    case MINIMUM_HEIGHT: update_h_min_height(in, s); break;
+    case MINIMUM_HEIGHT: update_h_min_height(in, s, s.elements); break;
     case INBALL_DIAMETER: update_tetrahedron_h_min_inball(in, s); break;
   }
 }
 
+HPC_NOINLINE inline void
+update_tetrahedron_h_min(input const& in, state& s, element_list const elements)
+{
+  switch (in.h_min) {
+    case MINIMUM_HEIGHT: update_h_min_height(in, s, elements); break;
+    case INBALL_DIAMETER: update_tetrahedron_h_min_inball(in, s, elements); break;
+  }
+}
+
 HPC_NOINLINE inline void
 update_meshless_h_min(input const&, state&)
 {
@@ -86,6 +127,17 @@ update_h_min(input const& in, state& s)
   }
 }
 
+void
+update_h_min(input const& in, state& s, element_list const elements)
+{
+  switch (in.element) {
+    case TRIANGLE: update_triangle_h_min(in, s, elements); break;
+    case TETRAHEDRON: update_tetrahedron_h_min(in, s, elements); break;
+    case BAR:
+    case COMPOSITE_TETRAHEDRON: assert(0); break;
+  }
+}
+
 void
 update_h_art(input const& in, state& s)
 {
@@ -97,15 +149,59 @@ update_h_art(input const& in, state& s)
   }
 }
 
+void
+update_h_art(input const& in, state& s, element_list const elements)
+{
+  switch (in.element) {
+    case TRIANGLE: update_triangle_h_art(s, elements); break;
+    case TETRAHEDRON: update_tetrahedron_h_art(s, elements); break;
+    case BAR:
+    case COMPOSITE_TETRAHEDRON: assert(0); break;
+  }
+}
+
+// where a node sits in the node set of a material, found through one of its elements of that material
+struct material_node_lookup
+{
+  hpc::range_sum_iterator<node_element_index, node_index>                         nodes_to_node_elements;
+  hpc::pointer_iterator<element_index const, node_element_index>                  node_elements_to_elements;
+  hpc::pointer_iterator<node_in_element_index const, node_element_index>          node_elements_to_nodes_in_element;
+  hpc::pointer_iterator<material_index const, element_index>                      elements_to_material;
+  hpc::counting_product<hpc::device_layout, element_index, node_in_element_index> elements_to_element_nodes;
+  hpc::pointer_iterator<material_node_index const, element_node_index>            element_nodes_to_material_nodes;
+  explicit material_node_lookup(state const& s)
+      : nodes_to_node_elements(s.nodes_to_node_elements.cbegin()),
+        node_elements_to_elements(s.node_elements_to_elements.cbegin()),
+        node_elements_to_nodes_in_element(s.node_elements_to_nodes_in_element.cbegin()),
+        elements_to_material(s.material.cbegin()),
+        elements_to_element_nodes(s.elements * s.nodes_in_element),
+        element_nodes_to_material_nodes(s.element_nodes_to_material_nodes.cbegin())
+  {
+  }
+  HPC_DEVICE material_node_index
+  operator()(node_index const node, material_index const material) const
+  {
+    for (auto const node_element : nodes_to_node_elements[node]) {
+      element_index const element = node_elements_to_elements[node_element];
+      if (elements_to_material[element] != material) continue;
+      node_in_element_index const node_in_element = node_elements_to_nodes_in_element[node_element];
+      return element_nodes_to_material_nodes[elements_to_element_nodes[element][node_in_element]];
+    }
+    assert(0);
+    return material_node_index(-1);
+  }
+};
+
 HPC_NOINLINE inline void
-update_nodal_mass_uniform(state& s, material_index const material)
+update_nodal_mass_uniform(state& s, material_index const material, entity_sets<node_index> const& nodes)
 {
   auto const nodes_to_node_elements    = s.nodes_to_node_elements.cbegin();
   auto const node_elements_to_elements = s.node_elements_to_elements.cbegin();
   auto const points_to_rho             = s.rho.cbegin();
   auto const points_to_V               = s.V.cbegin();
-  assert(s.material_mass[material].size() == s.nodes.size());
-  auto const nodes_to_m           = s.material_mass[material].begin();
+  assert(s.material_mass[material].size() == material_node_index(s.node_sets[material].size()));
+  auto const material_nodes_to_m  = s.material_mass[material].begin();
+  auto const to_material_node     = material_node_lookup(s);
   auto const N                    = 1.0 / double(hpc::weaken(s.nodes_in_element.size()));
   auto const elements_to_points   = s.elements * s.points_in_element;
   auto const elements_to_material = s.material.cbegin();
@@ -122,9 +218,27 @@ update_nodal_mass_uniform(state& s, material_index const material)
         m              = m + (rho * V) * N;
       }
     }
-    nodes_to_m[node] = m;
+    material_nodes_to_m[to_material_node(node, material)] = m;
   };
-  hpc::for_each(hpc::device_policy(), s.node_sets[material], functor);
+  hpc::for_each(hpc::device_policy(), nodes[material], functor);
+}
+
+// adds each material's partial nodal mass into the total mass
+HPC_NOINLINE inline void
+sum_material_masses(input const& in, state& s, entity_sets<node_index> const& nodes)
+{
+  for (auto const material : in.materials) {
+    auto const nodes_to_total            = s.mass.begin();
+    auto const material_nodes_to_partial = s.material_mass[material].cbegin();
+    auto const to_material_node          = material_node_lookup(s);
+    auto       functor                   = [=] HPC_DEVICE(node_index const node) {
+      auto       m_total   = nodes_to_total[node];
+      auto const m_partial = material_nodes_to_partial[to_material_node(node, material)];
+      m_total              = m_total + m_partial;
+      nodes_to_total[node] = m_total;
+    };
+    hpc::for_each(hpc::device_policy(), nodes[material], functor);
+  }
 }
 
 void
@@ -134,22 +248,23 @@ update_nodal_mass(input const& in, state& s)
     switch (in.element) {
       case BAR:
       case TRIANGLE:
-      case TETRAHEDRON: update_nodal_mass_uniform(s, material); break;
+      case TETRAHEDRON: update_nodal_mass_uniform(s, material, s.node_sets); break;
       case COMPOSITE_TETRAHEDRON: update_nodal_mass_composite_tetrahedron(s, material); break;
     }
   }
   hpc::fill(hpc::device_policy(), s.mass, hpc::mass<double>(0.0));
-  for (auto const material : in.materials) {
-    auto const nodes_to_total   = s.mass.begin();
-    auto const nodes_to_partial = s.material_mass[material].cbegin();
-    auto       functor          = [=] HPC_DEVICE(node_index const node) {
-      auto       m_total   = nodes_to_total[node];
-      auto const m_partial = nodes_to_partial[node];
-      m_total              = m_total + m_partial;
-      nodes_to_total[node] = m_total;
-    };
-    hpc::for_each(hpc::device_policy(), s.node_sets[material], functor);
-  }
+  sum_material_masses(in, s, s.node_sets);
+}
+
+void
+update_nodal_mass(input const& in, state& s, entity_sets<node_index> const& nodes)
+{
+  assert(in.element != COMPOSITE_TETRAHEDRON);
+  for (auto const material : in.materials) { update_nodal_mass_uniform(s, material, nodes); }
+  auto const nodes_to_total = s.mass.begin();
+  auto       zero_functor   = [=] HPC_DEVICE(node_index const node) { nodes_to_total[node] = hpc::mass<double>(0.0); };
+  hpc::for_each(hpc::device_policy(), nodes.all(), zero_functor);
+  sum_material_masses(in, s, nodes);
 }
 
 }  // namespace lgr
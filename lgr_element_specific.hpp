@@ -1,5 +1,7 @@
 #pragma once
 
+#include <lgr_entity_sets.hpp>
+
 namespace lgr {
 
 class input;
@@ -8,12 +10,22 @@ class state;
 void
 initialize_V(input const& in, state& s);
 void
+initialize_V(input const& in, state& s, element_list elements);
+void
 initialize_grad_N(input const& in, state& s);
 void
+initialize_grad_N(input const& in, state& s, element_list elements);
+void
 update_h_min(input const& in, state& s);
 void
+update_h_min(input const& in, state& s, element_list elements);
+void
 update_h_art(input const& in, state& s);
 void
+update_h_art(input const& in, state& s, element_list elements);
+void
 update_nodal_mass(input const& in, state& s);
+void
+update_nodal_mass(input const& in, state& s, entity_sets<node_index> const& nodes);
 
 }  // namespace lgr
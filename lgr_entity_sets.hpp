@@ -0,0 +1,100 @@
+#pragma once
+
+#include <hpc_algorithm.hpp>
+#include <hpc_atomic.hpp>
+#include <hpc_execution.hpp>
+#include <hpc_numeric.hpp>
+#include <hpc_range.hpp>
+#include <hpc_vector.hpp>
+#include <lgr_material_set.hpp>
+#include <lgr_mesh_indices.hpp>
+
+namespace lgr {
+
+// Possibly overlapping sets of mesh entities, one per material or boundary,
+// stored back to back: set m holds items[offsets[m]] .. items[offsets[m + 1] - 1].
+// Offsets stay on the host, where sets are indexed to launch kernels over them.
+template <class Index>
+class entity_sets
+{
+ public:
+  using items_type = hpc::device_vector<Index, int>;
+  using range_type = hpc::iterator_range<typename items_type::const_iterator>;
+  hpc::host_vector<int, material_index> offsets;
+  items_type                            items;
+
+  material_index
+  size() const noexcept
+  {
+    return offsets.size() == material_index(0) ? material_index(0) : offsets.size() - material_index(1);
+  }
+  range_type
+  operator[](material_index const set) const noexcept
+  {
+    auto const first = items.cbegin();
+    return range_type(first + offsets[set], first + offsets[set + material_index(1)]);
+  }
+  // every item of every set, once per set it belongs to
+  range_type
+  all() const noexcept
+  {
+    return range_type(items.cbegin(), items.cend());
+  }
+};
+
+using element_list = entity_sets<element_index>::range_type;
+using node_list    = entity_sets<node_index>::range_type;
+
+// Stable counting sort of items into every set of their material_set: one pass
+// evaluates the sets of each item and counts the members of each set, then an
+// inclusive scan per set over its membership flags gives each member its slot,
+// so every set lists its items in increasing order whatever the device.
+template <class Index, class SetsFunctor>
+void
+bucket_sets(
+    hpc::counting_range<Index> const range,
+    material_index const             set_count,
+    SetsFunctor                      sets_functor,
+    entity_sets<Index>&              sets)
+{
+  hpc::device_vector<int, material_index> counts_vector(set_count);
+  hpc::fill(hpc::device_policy(), counts_vector, int(0));
+  hpc::device_vector<material_set, Index> item_sets_vector(range.size());
+  auto const sets_to_count = counts_vector.begin();
+  auto const items_to_sets = item_sets_vector.begin();
+  auto       count_functor = [=] HPC_DEVICE(Index const item) {
+    material_set const item_sets = sets_functor(item);
+    items_to_sets[item]          = item_sets;
+    for (material_index set(0); set < set_count; ++set) {
+      if (!item_sets.contains(material_set(set))) continue;
+      hpc::atomic_ref<int> count(sets_to_count[set]);
+      count++;
+    }
+  };
+  hpc::for_each(hpc::device_policy(), range, count_functor);
+  hpc::pinned_vector<int, material_index> counts(set_count);
+  hpc::copy(counts_vector, counts);
+  sets.offsets.resize(set_count + material_index(1));
+  sets.offsets[material_index(0)] = 0;
+  for (material_index set(0); set < set_count; ++set) {
+    sets.offsets[set + material_index(1)] = sets.offsets[set] + counts[set];
+  }
+  sets.items.resize(sets.offsets[set_count]);
+  hpc::device_vector<int, Index> slots_vector(range.size());
+  auto const                     items_to_slots = slots_vector.cbegin();
+  auto const                     sets_to_items  = sets.items.begin();
+  for (material_index set(0); set < set_count; ++set) {
+    if (counts[set] == 0) continue;
+    auto is_in_functor = [=] HPC_DEVICE(Index const item) -> int {
+      return items_to_sets[item].contains(material_set(set)) ? 1 : 0;
+    };
+    hpc::transform_inclusive_scan(hpc::device_policy(), range, slots_vector, hpc::plus<int>(), is_in_functor);
+    int const first        = sets.offsets[set];
+    auto      fill_functor = [=] HPC_DEVICE(Index const item) {
+      if (is_in_functor(item) != 0) sets_to_items[first + items_to_slots[item] - 1] = item;
+    };
+    hpc::for_each(hpc::device_policy(), range, fill_functor);
+  }
+}
+
+}  // namespace lgr
@@ -1,7 +1,12 @@
+#include <algorithm>
+#include <iomanip>
+#include <lgr_domain.hpp>
 #include <lgr_exodus.hpp>
 #include <lgr_input.hpp>
 #include <lgr_meshing.hpp>
 #include <lgr_state.hpp>
+#include <sstream>
+#include <stdexcept>
 
 #ifdef LGR_ENABLE_EXODUS
 #ifdef __clang__
@@ -18,6 +23,119 @@ namespace lgr {
 
 #ifdef LGR_ENABLE_EXODUS
 
+static void
+check_exodus(int const error_code, char const* what)
+{
+  if (error_code < 0) throw std::runtime_error(std::string("Exodus error in ") + what);
+}
+
+// Exodus block ids start at 1, so without input::exodus_block_ids block b is material b - 1
+static material_index
+exodus_block_material(input const& in, int const block_id)
+{
+  auto const from_blocks = [](int const id) { return id != 0; };
+  if (!hpc::any_of(hpc::serial_policy(), in.exodus_block_ids, from_blocks)) return material_index(block_id - 1);
+  for (auto const material : in.materials) {
+    if (in.exodus_block_ids[material] == block_id) return material;
+  }
+  throw std::runtime_error("Exodus element block " + std::to_string(block_id) + " is not assigned to a material");
+}
+
+// the inverse of exodus_block_material
+static int
+exodus_material_block(std::vector<int> const& material_block_ids, int const material)
+{
+  auto const from_blocks = std::any_of(
+      material_block_ids.begin(), material_block_ids.end(), [](int const id) { return id != 0; });
+  if (!from_blocks) return material + 1;
+  if (material >= int(material_block_ids.size()) || material_block_ids[std::size_t(material)] == 0) {
+    throw std::runtime_error("Material " + std::to_string(material) + " has no Exodus element block");
+  }
+  return material_block_ids[std::size_t(material)];
+}
+
+// sorted, zero-based nodes of the Exodus node set and side set of a boundary
+static std::vector<int>
+read_exodus_set_nodes(int const exodus_file, input const& in, material_index const boundary)
+{
+  std::vector<int> set_nodes;
+  int const        node_set_id = in.exodus_node_set_ids[boundary];
+  if (node_set_id != 0) {
+    int num_entries = 0;
+    int num_df      = 0;
+    check_exodus(ex_get_set_param(exodus_file, EX_NODE_SET, node_set_id, &num_entries, &num_df), "ex_get_set_param");
+    auto entries = std::vector<int>(std::size_t(num_entries));
+    check_exodus(ex_get_set(exodus_file, EX_NODE_SET, node_set_id, entries.data(), nullptr), "ex_get_set");
+    set_nodes.insert(set_nodes.end(), entries.begin(), entries.end());
+  }
+  int const side_set_id = in.exodus_side_set_ids[boundary];
+  if (side_set_id != 0) {
+    int num_sides = 0;
+    int num_df    = 0;
+    check_exodus(ex_get_set_param(exodus_file, EX_SIDE_SET, side_set_id, &num_sides, &num_df), "ex_get_set_param");
+    int list_length = 0;
+    check_exodus(
+        ex_get_side_set_node_list_len(exodus_file, side_set_id, &list_length), "ex_get_side_set_node_list_len");
+    auto side_node_counts = std::vector<int>(std::size_t(num_sides));
+    auto side_nodes       = std::vector<int>(std::size_t(list_length));
+    check_exodus(
+        ex_get_side_set_node_list(exodus_file, side_set_id, side_node_counts.data(), side_nodes.data()),
+        "ex_get_side_set_node_list");
+    set_nodes.insert(set_nodes.end(), side_nodes.begin(), side_nodes.end());
+  }
+  std::sort(set_nodes.begin(), set_nodes.end());
+  set_nodes.erase(std::unique(set_nodes.begin(), set_nodes.end()), set_nodes.end());
+  for (auto& node : set_nodes) --node;
+  return set_nodes;
+}
+
+// fills s.node_sets with the boundaries given as Exodus node sets or side sets,
+// the other sets are left empty until collect_node_sets
+static void
+read_exodus_boundary_sets(int const exodus_file, input const& in, state& s)
+{
+  hpc::counting_range<material_index> const all_materials(in.materials.size() + in.boundaries.size());
+  s.node_sets.offsets.resize(all_materials.size() + material_index(1));
+  s.node_sets.offsets[material_index(0)] = 0;
+  std::vector<int> all_set_nodes;
+  for (auto const material : all_materials) {
+    if (has_exodus_node_set(in, material)) {
+      auto const set_nodes = read_exodus_set_nodes(exodus_file, in, material);
+      all_set_nodes.insert(all_set_nodes.end(), set_nodes.begin(), set_nodes.end());
+    }
+    s.node_sets.offsets[material + material_index(1)] = int(all_set_nodes.size());
+  }
+  hpc::pinned_vector<node_index, int> pinned_items(int(all_set_nodes.size()));
+  for (std::size_t i = 0; i < all_set_nodes.size(); ++i) pinned_items[int(i)] = node_index(all_set_nodes[i]);
+  s.node_sets.items.resize(pinned_items.size());
+  hpc::copy(pinned_items, s.node_sets.items);
+}
+
+// Reads count items of item_size values each with read(chunk, first, count), a
+// bounded number of items at a time, straight into their final device array.
+// Under CUDA each chunk goes through one reused pinned buffer.
+template <class T, class Read>
+static void
+read_in_chunks(T* destination, std::int64_t const count, int const item_size, Read read)
+{
+  std::int64_t const chunk_items = std::min(count, std::int64_t(1) << 20);
+#ifdef HPC_CUDA
+  hpc::pinned_vector<T> staging(chunk_items * item_size);
+#endif
+  for (std::int64_t first = 0; first < count; first += chunk_items) {
+    auto const items       = std::min(chunk_items, count - first);
+    auto const chunk_begin = destination + first * item_size;
+#ifdef HPC_CUDA
+    read(staging.data(), first, items);
+    auto const bytes = std::size_t(items * item_size) * sizeof(T);
+    auto const err   = cudaMemcpy(chunk_begin, staging.data(), bytes, cudaMemcpyHostToDevice);
+    if (err != cudaSuccess) throw std::runtime_error("could not copy Exodus data to the device");
+#else
+    read(chunk_begin, first, items);
+#endif
+  }
+}
+
 int
 read_exodus_file(std::string const& filepath, input const& in, state& s)
 {
@@ -55,8 +173,11 @@ read_exodus_file(std::string const& filepath, input const& in, state& s)
   s.nodes.resize(int(init_params.num_nodes));
   s.elements.resize(int(init_params.num_elem));
   s.material.resize(s.elements.size());
-  hpc::host_vector<int> host_conn(int(s.elements.size() * s.nodes_in_element.size()));
-  int                   offset = 0;
+  int const nodes_per_element = int(s.nodes_in_element.size());
+  static_assert(sizeof(node_index) == sizeof(int), "Exodus connectivity is read as int");
+  s.elements_to_nodes.resize(s.elements.size() * s.nodes_in_element.size());
+  auto const conn   = reinterpret_cast<int*>(s.elements_to_nodes.data());
+  int        offset = 0;
   for (int i = 0; i < init_params.num_elem_blk; ++i) {
     char elem_type[MAX_STR_LENGTH + 1];
     int  nentries;
@@ -76,54 +197,267 @@ read_exodus_file(std::string const& filepath, input const& in, state& s)
         &nattr_per_entry);
     assert(exodus_error_code == 0);
     if (nentries == 0) continue;
-    assert(nnodes_per_entry == int(s.nodes_in_element.size()));
-    if (nedges_per_entry < 0) nedges_per_entry = 0;
-    if (nfaces_per_entry < 0) nfaces_per_entry = 0;
-    hpc::host_vector<int> edge_conn(nentries * nedges_per_entry);
-    hpc::host_vector<int> face_conn(nentries * nfaces_per_entry);
-    exodus_error_code = ex_get_conn(
-        exodus_file,
-        EX_ELEM_BLOCK,
-        block_ids[i],
-        host_conn.data() + offset * int(s.nodes_in_element.size()),
-        edge_conn.data(),
-        face_conn.data());
-    assert(exodus_error_code == 0);
+    assert(nnodes_per_entry == nodes_per_element);
+    auto read_conn = [&](int* chunk, std::int64_t const first, std::int64_t const count) {
+      check_exodus(
+          ex_get_partial_conn(exodus_file, EX_ELEM_BLOCK, block_ids[i], first + 1, count, chunk, nullptr, nullptr),
+          "ex_get_partial_conn");
+    };
+    read_in_chunks(conn + std::int64_t(offset) * nodes_per_element, nentries, nodes_per_element, read_conn);
     auto                 material_begin = s.material.begin() + element_index(offset);
     auto                 material_end   = material_begin + element_index(nentries);
     auto                 material_range = hpc::make_iterator_range(material_begin, material_end);
-    material_index const material(block_ids[i]);
+    material_index const material       = exodus_block_material(in, block_ids[i]);
     hpc::fill(hpc::device_policy(), material_range, material);
     offset += nentries;
   }
   assert(offset == init_params.num_elem);
-  hpc::pinned_vector<node_index, element_node_index> pinned_conn(s.elements.size() * s.nodes_in_element.size());
-  auto const                                         elements_to_element_nodes = s.elements * s.nodes_in_element;
-  for (auto const element : s.elements) {
-    auto const element_nodes = elements_to_element_nodes[element];
-    for (auto const node_in_element : s.nodes_in_element) {
-      auto const host_index     = int(element * s.nodes_in_element.size()) + int(node_in_element);
-      auto const element_node   = element_nodes[node_in_element];
-      pinned_conn[element_node] = node_index(host_conn[host_index] - 1);
-    }
-  }
-  s.elements_to_nodes.resize(pinned_conn.size());
-  hpc::copy(pinned_conn, s.elements_to_nodes);
-  pinned_conn.clear();
-  hpc::host_vector<double, node_index> host_coords[3];
-  for (int i = 0; i < 3; ++i) host_coords[i].resize(s.nodes.size());
-  exodus_error_code = ex_get_coord(exodus_file, host_coords[0].data(), host_coords[1].data(), host_coords[2].data());
-  assert(exodus_error_code == 0);
-  hpc::pinned_array_vector<hpc::position<double>, node_index> pinned_coords(s.nodes.size());
-  for (auto const node : s.nodes) {
-    pinned_coords[node] = hpc::position<double>(host_coords[0][node], host_coords[1][node], host_coords[2][node]);
-  }
+  // Exodus node numbers are 1-based
+  auto const element_nodes_to_nodes = s.elements_to_nodes.begin();
+  auto       to_zero_based          = [=] HPC_DEVICE(element_node_index const element_node) {
+    element_nodes_to_nodes[element_node] = element_nodes_to_nodes[element_node] - node_index(1);
+  };
+  hpc::for_each(
+      hpc::device_policy(), hpc::counting_range<element_node_index>(s.elements_to_nodes.size()), to_zero_based);
   s.x.resize(s.nodes.size());
-  hpc::copy(pinned_coords, s.x);
+  auto read_coords = [&](double* chunk, std::int64_t const first, std::int64_t const count) {
+    std::vector<double> components[3];
+    for (auto& component : components) component.resize(std::size_t(count));
+    check_exodus(
+        ex_get_partial_coord(
+            exodus_file, first + 1, count, components[0].data(), components[1].data(), components[2].data()),
+        "ex_get_partial_coord");
+    for (std::int64_t n = 0; n < count; ++n) {
+      for (int d = 0; d < 3; ++d) chunk[3 * n + d] = components[d][std::size_t(n)];
+    }
+  };
+  read_in_chunks(reinterpret_cast<double*>(s.x.data()), std::int64_t(init_params.num_nodes), 3, read_coords);
+  read_exodus_boundary_sets(exodus_file, in, s);
+  ex_close(exodus_file);
   propagate_connectivity(s);
   return exodus_error_code;
 }
 
+static char const*
+exodus_element_type(std::uint8_t const cell_type)
+{
+  switch (cell_type) {
+    case 3: return "BAR2";
+    case 5: return "TRI3";
+    case 10: return "TETRA4";
+    case 24: return "TETRA10";
+  }
+  return "UNKNOWN";
+}
+
+static std::vector<std::string>
+component_names(std::string const& name, int const components)
+{
+  static char const* const vector_suffixes[] = {"_x", "_y", "_z"};
+  static char const* const tensor_suffixes[] = {"_xx", "_xy", "_xz", "_yx", "_yy", "_yz", "_zx", "_zy", "_zz"};
+  std::vector<std::string> names;
+  for (int c = 0; c < components; ++c) {
+    if (components == 1) {
+      names.push_back(name);
+    } else if (components == 3) {
+      names.push_back(name + vector_suffixes[c]);
+    } else if (components == 9) {
+      names.push_back(name + tensor_suffixes[c]);
+    } else {
+      names.push_back(name + "_" + std::to_string(c));
+    }
+  }
+  return names;
+}
+
+static void
+put_variable_names(int const file, ex_entity_type const type, std::vector<std::string> const& names)
+{
+  if (names.empty()) return;
+  check_exodus(ex_put_variable_param(file, type, int(names.size())), "ex_put_variable_param");
+  std::vector<char*> c_names;
+  for (auto const& name : names) c_names.push_back(const_cast<char*>(name.c_str()));
+  check_exodus(ex_put_variable_names(file, type, int(names.size()), c_names.data()), "ex_put_variable_names");
+}
+
+exodus_writer::~exodus_writer() { close_file(); }
+
+void
+exodus_writer::close_file()
+{
+  if (file >= 0) ex_close(file);
+  file = -1;
+}
+
+std::string
+exodus_writer::sequence_file_name(int const sequence) const
+{
+  if (sequence == 1) return filename;
+  std::ostringstream name_stream;
+  name_stream << filename << "-s" << std::setw(4) << std::setfill('0') << sequence;
+  return name_stream.str();
+}
+
+// elements of each material are written as one contiguous block
+void
+exodus_writer::assign_blocks()
+{
+  int max_material = -1;
+  for (std::int64_t e = 0; e < number_of_cells; ++e) max_material = std::max(max_material, materials[e]);
+  std::vector<std::vector<int>> material_elements(std::size_t(max_material + 1));
+  for (std::int64_t e = 0; e < number_of_cells; ++e) material_elements[std::size_t(materials[e])].push_back(int(e));
+  block_ids.clear();
+  block_elements.clear();
+  for (int material = 0; material <= max_material; ++material) {
+    if (material_elements[std::size_t(material)].empty()) continue;
+    block_ids.push_back(exodus_material_block(material_block_ids, material));
+    block_elements.push_back(std::move(material_elements[std::size_t(material)]));
+  }
+}
+
+void
+exodus_writer::resume(double const time_in, int const adapt_epoch_in)
+{
+  close_file();
+  epoch = 0;
+  // files of the sequence start at increasing times, the step belongs to the last one started by then
+  for (int sequence = 1;; ++sequence) {
+    int   comp_ws   = int(sizeof(double));
+    int   io_ws     = 0;
+    float version   = 0.0;
+    int   candidate = ex_open(sequence_file_name(sequence).c_str(), EX_READ, &comp_ws, &io_ws, &version);
+    if (candidate < 0) break;
+    std::vector<double> times(std::size_t(ex_inquire_int(candidate, EX_INQ_TIME)));
+    if (!times.empty()) check_exodus(ex_get_all_times(candidate, times.data()), "ex_get_all_times");
+    ex_close(candidate);
+    if (times.empty() || times.front() > time_in) break;
+    epoch = sequence;
+    step  = int(std::upper_bound(times.begin(), times.end(), time_in) - times.begin());
+  }
+  if (epoch == 0) return;
+  auto const name    = sequence_file_name(epoch);
+  int        comp_ws = int(sizeof(double));
+  int        io_ws   = 0;
+  float      version = 0.0;
+  file               = ex_open(name.c_str(), EX_WRITE, &comp_ws, &io_ws, &version);
+  if (file < 0) throw std::runtime_error("Could not reopen Exodus file " + name);
+  ex_init_params init_params;
+  check_exodus(ex_get_init_ext(file, &init_params), "ex_get_init_ext");
+  auto const          points_in_file = std::int64_t(init_params.num_nodes);
+  std::vector<double> coords[3];
+  for (auto& component : coords) component.resize(std::size_t(points_in_file));
+  check_exodus(ex_get_coord(file, coords[0].data(), coords[1].data(), coords[2].data()), "ex_get_coord");
+  initial_points.resize(std::size_t(3 * points_in_file));
+  for (std::int64_t n = 0; n < points_in_file; ++n) {
+    for (int d = 0; d < 3; ++d) initial_points[std::size_t(3 * n + d)] = coords[d][std::size_t(n)];
+  }
+  adapt_epoch = adapt_epoch_in;
+  // recomputed from the materials of the first resumed step
+  block_ids.clear();
+  block_elements.clear();
+}
+
+void
+exodus_writer::create_file()
+{
+  ++epoch;
+  auto const name    = sequence_file_name(epoch);
+  int        comp_ws = int(sizeof(double));
+  int        io_ws   = int(sizeof(double));
+  file               = ex_create(name.c_str(), EX_CLOBBER, &comp_ws, &io_ws);
+  if (file < 0) throw std::runtime_error("Could not create Exodus file " + name);
+  assign_blocks();
+  check_exodus(
+      ex_put_init(file, "lgr", 3, number_of_points, number_of_cells, std::int64_t(block_ids.size()), 0, 0),
+      "ex_put_init");
+  initial_points.assign(points, points + 3 * number_of_points);
+  std::vector<double> coords[3];
+  for (int d = 0; d < 3; ++d) {
+    coords[d].resize(std::size_t(number_of_points));
+    for (std::int64_t n = 0; n < number_of_points; ++n) coords[d][std::size_t(n)] = points[3 * n + d];
+  }
+  check_exodus(ex_put_coord(file, coords[0].data(), coords[1].data(), coords[2].data()), "ex_put_coord");
+  char const* coord_names[] = {"x", "y", "z"};
+  check_exodus(ex_put_coord_names(file, const_cast<char**>(coord_names)), "ex_put_coord_names");
+  for (std::size_t b = 0; b < block_ids.size(); ++b) {
+    auto const& elements = block_elements[b];
+    check_exodus(
+        ex_put_block(
+            file,
+            EX_ELEM_BLOCK,
+            block_ids[b],
+            exodus_element_type(cell_type),
+            std::int64_t(elements.size()),
+            nodes_per_cell,
+            0,
+            0,
+            0),
+        "ex_put_block");
+    std::vector<int> block_conn;
+    block_conn.reserve(elements.size() * std::size_t(nodes_per_cell));
+    for (auto const e : elements) {
+      for (int k = 0; k < nodes_per_cell; ++k) block_conn.push_back(connectivity[e * nodes_per_cell + k] + 1);
+    }
+    check_exodus(ex_put_conn(file, EX_ELEM_BLOCK, block_ids[b], block_conn.data(), nullptr, nullptr), "ex_put_conn");
+  }
+  auto nodal_names = component_names("displacement", 3);
+  std::vector<std::string> element_names;
+  for (auto const& f : fields) {
+    auto const names = component_names(f.name, f.components);
+    auto&      list  = f.on_nodes ? nodal_names : element_names;
+    list.insert(list.end(), names.begin(), names.end());
+  }
+  put_variable_names(file, EX_NODAL, nodal_names);
+  put_variable_names(file, EX_ELEM_BLOCK, element_names);
+  step = 0;
+}
+
+void
+exodus_writer::end_step()
+{
+  auto const same_topology = file >= 0 && step_adapt_epoch == adapt_epoch &&
+                             initial_points.size() == std::size_t(3 * number_of_points);
+  if (!same_topology) {
+    close_file();
+    adapt_epoch = step_adapt_epoch;
+    create_file();
+  } else if (block_ids.empty()) {
+    assign_blocks();
+  }
+  ++step;
+  check_exodus(ex_put_time(file, step, &time), "ex_put_time");
+  std::vector<double> values(std::size_t(std::max(number_of_points, number_of_cells)));
+  for (int d = 0; d < 3; ++d) {
+    for (std::int64_t n = 0; n < number_of_points; ++n) {
+      values[std::size_t(n)] = points[3 * n + d] - initial_points[std::size_t(3 * n + d)];
+    }
+    check_exodus(ex_put_var(file, step, EX_NODAL, d + 1, 1, number_of_points, values.data()), "ex_put_var");
+  }
+  int nodal_variable   = 3;
+  int element_variable = 0;
+  for (auto const& f : fields) {
+    auto const data = f.owned.empty() ? f.data : f.owned.data();
+    for (int c = 0; c < f.components; ++c) {
+      if (f.on_nodes) {
+        for (std::int64_t n = 0; n < number_of_points; ++n) values[std::size_t(n)] = data[n * f.components + c];
+        check_exodus(
+            ex_put_var(file, step, EX_NODAL, ++nodal_variable, 1, number_of_points, values.data()), "ex_put_var");
+        continue;
+      }
+      ++element_variable;
+      for (std::size_t b = 0; b < block_ids.size(); ++b) {
+        auto const& elements = block_elements[b];
+        for (std::size_t i = 0; i < elements.size(); ++i) values[i] = data[elements[i] * f.components + c];
+        check_exodus(
+            ex_put_var(
+                file, step, EX_ELEM_BLOCK, element_variable, block_ids[b], std::int64_t(elements.size()), values.data()),
+            "ex_put_var");
+      }
+    }
+  }
+  check_exodus(ex_update(file), "ex_update");
+}
+
 #else
 
 int
@@ -133,6 +467,20 @@ read_exodus_file(std::string const&, input const&, state&)
   return -1;
 }
 
+exodus_writer::~exodus_writer() {}
+
+void
+exodus_writer::resume(double const, int const)
+{
+  throw std::runtime_error("Exodus not enabled! Rebuild with LGR_ENABLE_EXODUS=ON");
+}
+
+void
+exodus_writer::end_step()
+{
+  throw std::runtime_error("Exodus not enabled! Rebuild with LGR_ENABLE_EXODUS=ON");
+}
+
 #endif
 
 }  // namespace lgr
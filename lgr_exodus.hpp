@@ -1,6 +1,13 @@
 #pragma once
 
+#include <cstdint>
+#include <hpc_array_vector.hpp>
+#include <hpc_vector.hpp>
+#include <hpc_vector3.hpp>
+#include <lgr_vtk_util.hpp>
 #include <string>
+#include <utility>
+#include <vector>
 
 namespace lgr {
 
@@ -10,4 +17,156 @@ class state;
 int
 read_exodus_file(std::string const& filepath, input const& in, state& s);
 
+// Writes every output step of a run into one Exodus II file that stays open
+// between steps. Coordinates, connectivity and one element block per material
+// are written when the file is created; each step then only adds its time and
+// one ex_put_var per field component. A new adapt epoch starts the next file
+// of the sequence, <name>-s0002, <name>-s0003, ... A restarted run resume()s
+// the sequence file its checkpoint was written to instead of recreating it.
+// Fields are described through the same interface as vtu_file.
+class exodus_writer
+{
+  struct field
+  {
+    std::string         name;
+    bool                on_nodes;
+    int                 components;
+    double const*       data;
+    std::vector<double> owned;
+  };
+  std::string        filename;
+  int                file{-1};
+  int                epoch{0};
+  int                adapt_epoch{-1};  // of the mesh in the open file
+  int                step_adapt_epoch{0};
+  int                step{0};
+  double             time{0.0};
+  std::int64_t       number_of_points{0};
+  double const*      points{nullptr};
+  int                nodes_per_cell{0};
+  std::uint8_t       cell_type{0};
+  int const*         connectivity{nullptr};
+  std::int64_t       connectivity_size{0};
+  int const*         materials{nullptr};
+  std::int64_t       number_of_cells{0};
+  std::vector<field> fields;
+  // positions of the nodes when the file was created, to write displacements
+  std::vector<double>           initial_points;
+  std::vector<std::vector<int>> block_elements;
+  std::vector<int>              block_ids;
+  std::vector<int>              material_block_ids;  // as input::exodus_block_ids
+
+  std::string
+  sequence_file_name(int const sequence) const;
+  void
+  assign_blocks();
+  void
+  create_file();
+  void
+  close_file();
+  template <class T>
+  void
+  add(bool const on_nodes, std::string const& name, int const components, T const* data)
+  {
+    static_assert(sizeof(T) == sizeof(double), "Exodus fields must be stored as doubles");
+    fields.push_back({name, on_nodes, components, reinterpret_cast<double const*>(data), {}});
+  }
+  template <class Quantity, class Index>
+  void
+  add(bool const on_nodes, std::string const& name, hpc::pinned_vector<Quantity, Index> const& vec)
+  {
+    add(on_nodes, name, 1, vec.data());
+  }
+  template <class T, class Index>
+  void
+  add(bool const on_nodes, std::string const& name, hpc::pinned_array_vector<T, Index> const& vec)
+  {
+    add(on_nodes, name, int(vec.array_size()), vec.data());
+  }
+  template <class T>
+  void
+  add(bool const on_nodes, std::string const& name, int const components, std::vector<T>&& values)
+  {
+    fields.push_back({name, on_nodes, components, nullptr, std::vector<double>(values.begin(), values.end())});
+  }
+
+ public:
+  explicit exodus_writer(std::string const& filename_in) : filename(filename_in) {}
+  exodus_writer(exodus_writer const&) = delete;
+  exodus_writer&
+  operator=(exodus_writer const&) = delete;
+  ~exodus_writer();
+  // reopens the file holding the step written at time, of the mesh of adapt_epoch_in, to append after that step
+  void
+  resume(double const time_in, int const adapt_epoch_in);
+  void
+  begin_step(double const time_in, std::int64_t const points_in, int const adapt_epoch_in)
+  {
+    time             = time_in;
+    number_of_points = points_in;
+    step_adapt_epoch = adapt_epoch_in;
+    fields.clear();
+  }
+  template <class Quantity, class Index>
+  void
+  set_points(hpc::pinned_array_vector<hpc::vector3<Quantity>, Index> const& x)
+  {
+    points = reinterpret_cast<double const*>(x.data());
+  }
+  template <class NodeIndex, class ElementNodeIndex>
+  void
+  set_cells(
+      hpc::pinned_vector<NodeIndex, ElementNodeIndex> const& connectivity_in,
+      int const                                              nodes_per_cell_in,
+      std::uint8_t const                                     cell_type_in)
+  {
+    static_assert(sizeof(NodeIndex) == sizeof(int), "Exodus connectivity is written as int");
+    connectivity      = reinterpret_cast<int const*>(connectivity_in.data());
+    connectivity_size = std::int64_t(connectivity_in.size());
+    nodes_per_cell    = nodes_per_cell_in;
+    cell_type         = cell_type_in;
+  }
+  // element block id of each material, 0 for none; without any the block id is material + 1
+  template <class MaterialIndex>
+  void
+  set_block_ids(hpc::host_vector<int, MaterialIndex> const& ids)
+  {
+    material_block_ids.assign(ids.data(), ids.data() + hpc::weaken(ids.size()));
+  }
+  template <class MaterialIndex, class ElementIndex>
+  void
+  set_materials(hpc::pinned_vector<MaterialIndex, ElementIndex> const& material)
+  {
+    static_assert(sizeof(MaterialIndex) == sizeof(int), "Exodus block ids are written as int");
+    materials       = reinterpret_cast<int const*>(material.data());
+    number_of_cells = std::int64_t(material.size());
+  }
+  template <class Vector>
+  void
+  add_point_data(std::string const& name, Vector const& vec)
+  {
+    add(true, name, vec);
+  }
+  template <class T>
+  void
+  add_point_data(std::string const& name, int const components, std::vector<T>&& values)
+  {
+    add(true, name, components, std::move(values));
+  }
+  template <class Vector>
+  void
+  add_cell_data(std::string const& name, Vector const& vec)
+  {
+    add(false, name, vec);
+  }
+  template <class T>
+  void
+  add_cell_data(std::string const& name, int const components, std::vector<T>&& values)
+  {
+    add(false, name, components, std::move(values));
+  }
+  void
+  end_step();
+};
+
 }  // namespace lgr
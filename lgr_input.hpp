@@ -31,6 +31,14 @@ enum h_min_kind
   INBALL_DIAMETER,
 };
 
+enum output_format_kind
+{
+  VTK_ASCII,    // legacy .vtk text files, mostly useful for debugging
+  VTU_BINARY,   // XML .vtu files with appended raw binary data
+  XDMF_SERIES,  // one .xdmf index and one raw .bin file for the whole run
+  EXODUS,       // one Exodus II .exo file for the whole run, needs LGR_ENABLE_EXODUS
+};
+
 class zero_acceleration_condition
 {
  public:
@@ -62,6 +70,9 @@ class input
   hpc::length<double>                                            z_domain_size{1.0};
   int                                                            otm_material_points_to_add_per_element{1};
   bool                                                           do_output{true};
+  output_format_kind                                             output_format{VTK_ASCII};
+  bool                                                           write_checkpoints{false};
+  std::string                                                    restart_file;
   bool                                                           output_to_command_line{true};
   bool                                                           debug_output{false};
   hpc::host_vector<hpc::density<double>, material_index>         rho0;
@@ -135,6 +146,11 @@ class input
       hpc::device_array_vector<hpc::position<double>, point_index>&)>
                                                             xp_transform;
   hpc::host_vector<std::unique_ptr<domain>, material_index> domains;
+  // Exodus ids to take materials and boundaries from when reading a mesh file, 0 for none:
+  // element blocks per material, node sets and side sets per boundary (indexed like domains)
+  hpc::host_vector<int, material_index> exodus_block_ids;
+  hpc::host_vector<int, material_index> exodus_node_set_ids;
+  hpc::host_vector<int, material_index> exodus_side_set_ids;
   input() = delete;
   input(material_index const material_count_in, material_index const boundary_count_in)
       : materials(material_count_in),
@@ -174,7 +190,10 @@ class input
         D8(material_count_in),
         DC(material_count_in),
         eps_f_min(material_count_in),
-        domains(material_count_in + boundary_count_in)
+        domains(material_count_in + boundary_count_in),
+        exodus_block_ids(material_count_in, 0),
+        exodus_node_set_ids(material_count_in + boundary_count_in, 0),
+        exodus_side_set_ids(material_count_in + boundary_count_in, 0)
   {
   }
 };
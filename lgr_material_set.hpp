@@ -70,6 +70,17 @@ class material_set
   {
     return material_set(bits & (~other.bits));
   }
+  HPC_ALWAYS_INLINE HPC_HOST_DEVICE constexpr material_set
+  operator&(material_set const other) const noexcept
+  {
+    return material_set(bits & other.bits);
+  }
+  // how many members come before this one, which packs per-member data densely
+  HPC_ALWAYS_INLINE HPC_HOST_DEVICE int
+  rank(material_index const material) const noexcept
+  {
+    return popcount(bits & ((std::uint64_t(1) << hpc::weaken(material)) - 1));
+  }
   HPC_ALWAYS_INLINE HPC_HOST_DEVICE constexpr static material_set
   none() noexcept
   {
@@ -51,8 +51,8 @@ class matrix4x4
   {
     return raw[i][j];
   }
-  HPC_ALWAYS_INLINE HPC_HOST_DEVICE Scalar&
-                                    operator()(int const i, int const j) noexcept
+  HPC_ALWAYS_INLINE HPC_HOST_DEVICE constexpr Scalar&
+                                              operator()(int const i, int const j) noexcept
   {
     return raw[i][j];
   }
@@ -39,5 +39,9 @@ struct material_tag
 {
 };
 using material_index = hpc::index<material_tag, int>;
+struct material_node_tag
+{
+};
+using material_node_index = hpc::index<material_node_tag, int>;  // position in the node set of a material
 
 }  // namespace lgr
@@ -1,5 +1,11 @@
 #pragma once
 
+#include <cassert>
+#include <hpc_algorithm.hpp>
+#include <hpc_macros.hpp>
+#include <hpc_range.hpp>
+#include <lgr_mesh_indices.hpp>
+
 namespace lgr {
 
 class input;
@@ -10,4 +16,32 @@ build_mesh(input const& in, state& s);
 void
 propagate_connectivity(state& s);
 
+// puts the elements around one node in increasing order, carrying their nodes in element along
+template <class ElementIterator, class NodeInElementIterator>
+HPC_HOST_DEVICE inline void
+sort_node_elements(
+    hpc::counting_range<node_element_index> const node_elements,
+    ElementIterator const                         node_elements_to_elements,
+    NodeInElementIterator const                   node_elements_to_nodes_in_element)
+{
+  hpc::counting_range<node_element_index> const except_last(node_elements.begin(), node_elements.end() - 1);
+  for (auto const node_element : except_last) {
+    hpc::counting_range<node_element_index> const remaining(node_element + 1, node_elements.end());
+    element_index                                 min_element(node_elements_to_elements[node_element]);
+    auto                                          min_node_element = node_element;
+    for (auto const node_element2 : remaining) {
+      auto const element = node_elements_to_elements[node_element2];
+      if (element < min_element) {
+        min_element      = element;
+        min_node_element = node_element2;
+      }
+    }
+    hpc::swap(node_elements_to_elements[node_element], node_elements_to_elements[min_node_element]);
+    hpc::swap(node_elements_to_nodes_in_element[node_element], node_elements_to_nodes_in_element[min_node_element]);
+  }
+  for (node_element_index i(*(node_elements.begin())); i < (*(node_elements.end())) - 1; ++i) {
+    assert(node_elements_to_elements[i] < node_elements_to_elements[i + 1]);
+  }
+}
+
 }  // namespace lgr
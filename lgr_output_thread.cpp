@@ -0,0 +1,66 @@
+#include <lgr_output_thread.hpp>
+
+namespace lgr {
+
+output_thread::~output_thread()
+{
+  if (!worker.joinable()) return;
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    job_changed.wait(lock, [this]() { return !busy; });
+    stopping = true;
+  }
+  job_changed.notify_all();
+  worker.join();
+}
+
+void
+output_thread::run()
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true) {
+    job_changed.wait(lock, [this]() { return busy || stopping; });
+    if (!busy) return;
+    auto const current = std::move(job);
+    lock.unlock();
+    std::exception_ptr current_error;
+    try {
+      current();
+    } catch (...) {
+      current_error = std::current_exception();
+    }
+    lock.lock();
+    error = current_error;
+    job   = nullptr;
+    busy  = false;
+    job_changed.notify_all();
+  }
+}
+
+void
+output_thread::submit(std::function<void()> job_in)
+{
+  wait();
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    job  = std::move(job_in);
+    busy = true;
+  }
+  if (!worker.joinable()) worker = std::thread([this]() { run(); });
+  job_changed.notify_all();
+}
+
+void
+output_thread::wait()
+{
+  std::exception_ptr e;
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    job_changed.wait(lock, [this]() { return !busy; });
+    e     = error;
+    error = nullptr;
+  }
+  if (e) std::rethrow_exception(e);
+}
+
+}  // namespace lgr
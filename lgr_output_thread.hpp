@@ -0,0 +1,40 @@
+#pragma once
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace lgr {
+
+// Runs file output jobs off the time-stepping thread. One worker lives as
+// long as the output_thread and takes jobs from a one-slot queue: submit()
+// first waits for the previous job, which bounds the writer to one frame
+// behind the simulation.
+class output_thread
+{
+  std::thread             worker;
+  std::mutex              mutex;
+  std::condition_variable job_changed;
+  std::function<void()>   job;
+  bool                    busy{false};
+  bool                    stopping{false};
+  std::exception_ptr      error;
+  void
+  run();
+
+ public:
+  output_thread() = default;
+  output_thread(output_thread const&) = delete;
+  output_thread&
+  operator=(output_thread const&) = delete;
+  ~output_thread();
+  void
+  submit(std::function<void()> job_in);
+  // blocks until the in-flight job is done and rethrows anything it threw
+  void
+  wait();
+};
+
+}  // namespace lgr
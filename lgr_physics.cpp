@@ -1,10 +1,12 @@
 #include <cassert>
+#include <hpc_array.hpp>
 #include <hpc_macros.hpp>
 #include <hpc_symmetric3x3.hpp>
 #include <iomanip>
 #include <iostream>
 #include <j2/hardening.hpp>
 #include <lgr_adapt.hpp>
+#include <lgr_checkpoint.hpp>
 #include <lgr_element_specific.hpp>
 #include <lgr_exodus.hpp>
 #include <lgr_input.hpp>
@@ -134,7 +136,7 @@ update_x(state& s)
 }
 
 HPC_NOINLINE inline void
-update_p(state& s, material_index const material)
+update_p(state& s, element_list const elements)
 {
   auto const points_to_sigma    = s.sigma.cbegin();
   auto const points_to_p        = s.p.begin();
@@ -146,41 +148,41 @@ update_p(state& s, material_index const material)
       points_to_p[point] = p;
     }
   };
-  hpc::for_each(hpc::device_policy(), s.element_sets[material], functor);
+  hpc::for_each(hpc::device_policy(), elements, functor);
 }
 
-HPC_NOINLINE inline void
+// The element kernels below are instantiated per element kind, so their node and point loops have
+// compile-time trip counts and the nodal quantities of an element are gathered once into registers.
+template <int NodesInElement, int PointsInElement>
+HPC_NOINLINE void
 update_reference(state& s)
 {
-  auto const elements_to_element_nodes  = s.elements * s.nodes_in_element;
-  auto const elements_to_element_points = s.elements * s.points_in_element;
-  auto const points_to_point_nodes      = s.points * s.nodes_in_element;
-  auto const element_nodes_to_nodes     = s.elements_to_nodes.cbegin();
-  auto const nodes_to_u                 = s.u.cbegin();
-  auto const points_to_F_total          = s.F_total.begin();
-  auto const point_nodes_to_grad_N      = s.grad_N.begin();
-  auto const points_to_V                = s.V.begin();
-  auto const points_to_rho              = s.rho.begin();
-  auto const nodes_in_element           = s.nodes_in_element;
-  auto       functor                    = [=] HPC_DEVICE(element_index const element) {
-    auto const element_nodes  = elements_to_element_nodes[element];
-    auto const element_points = elements_to_element_points[element];
-    for (auto const point : element_points) {
-      auto const point_nodes = points_to_point_nodes[point];
-      auto       F_incr      = hpc::deformation_gradient<double>::identity();
-      for (auto const node_in_element : nodes_in_element) {
-        auto const element_node = element_nodes[node_in_element];
-        auto const point_node   = point_nodes[node_in_element];
-        auto const node         = element_nodes_to_nodes[element_node];
-        auto const u            = nodes_to_u[node].load();
-        auto const old_grad_N   = point_nodes_to_grad_N[point_node].load();
-        F_incr                  = F_incr + outer_product(u, old_grad_N);
+  assert(s.nodes_in_element.size() == node_in_element_index(NodesInElement));
+  assert(s.points_in_element.size() == point_in_element_index(PointsInElement));
+  auto const element_nodes_to_nodes = s.elements_to_nodes.cbegin();
+  auto const nodes_to_u             = s.u.cbegin();
+  auto const points_to_F_total      = s.F_total.begin();
+  auto const point_nodes_to_grad_N  = s.grad_N.begin();
+  auto const points_to_V            = s.V.begin();
+  auto const points_to_rho          = s.rho.begin();
+  auto       functor                = [=] HPC_DEVICE(element_index const element) {
+    hpc::array<hpc::displacement<double>, NodesInElement> u;
+    for (int i = 0; i < NodesInElement; ++i) {
+      element_node_index const element_node(hpc::weaken(element) * NodesInElement + i);
+      u[i] = nodes_to_u[element_nodes_to_nodes[element_node]].load();
+    }
+    for (int j = 0; j < PointsInElement; ++j) {
+      point_index const point(hpc::weaken(element) * PointsInElement + j);
+      auto const        first_point_node = hpc::weaken(point) * NodesInElement;
+      hpc::array<hpc::basis_gradient<double>, NodesInElement> old_grad_N;
+      auto F_incr = hpc::deformation_gradient<double>::identity();
+      for (int i = 0; i < NodesInElement; ++i) {
+        old_grad_N[i] = point_nodes_to_grad_N[point_node_index(first_point_node + i)].load();
+        F_incr        = F_incr + outer_product(u[i], old_grad_N[i]);
       }
       auto const F_inverse_transpose = transpose(inverse(F_incr));
-      for (auto const point_node : point_nodes) {
-        auto const old_grad_N             = point_nodes_to_grad_N[point_node].load();
-        auto const new_grad_N             = F_inverse_transpose * old_grad_N;
-        point_nodes_to_grad_N[point_node] = new_grad_N;
+      for (int i = 0; i < NodesInElement; ++i) {
+        point_nodes_to_grad_N[point_node_index(first_point_node + i)] = F_inverse_transpose * old_grad_N[i];
       }
       auto const old_F_total   = points_to_F_total[point].load();
       auto const new_F_total   = F_incr * old_F_total;
@@ -200,7 +202,19 @@ update_reference(state& s)
 }
 
 HPC_NOINLINE inline void
-update_element_dt(state& s)
+update_reference(input const& in, state& s)
+{
+  switch (in.element) {
+    case BAR: update_reference<2, 1>(s); break;
+    case TRIANGLE: update_reference<3, 1>(s); break;
+    case TETRAHEDRON: update_reference<4, 1>(s); break;
+    case COMPOSITE_TETRAHEDRON: update_reference<10, 4>(s); break;
+  }
+}
+
+template <class Elements>
+HPC_NOINLINE void
+update_element_dt(state& s, Elements const& elements)
 {
   auto const points_to_c        = s.c.cbegin();
   auto const elements_to_h_min  = s.h_min.cbegin();
@@ -220,11 +234,17 @@ update_element_dt(state& s)
       points_to_dt[point] = dt;
     }
   };
-  hpc::for_each(hpc::device_policy(), s.elements, functor);
+  hpc::for_each(hpc::device_policy(), elements, functor);
 }
 
 HPC_NOINLINE inline void
-neo_Hookean(input const& in, state& s, material_index const material)
+update_element_dt(state& s)
+{
+  update_element_dt(s, s.elements);
+}
+
+HPC_NOINLINE inline void
+neo_Hookean(input const& in, state& s, material_index const material, element_list const elements)
 {
   auto const points_to_F_total  = s.F_total.cbegin();
   auto const points_to_sigma    = s.sigma.begin();
@@ -251,11 +271,11 @@ neo_Hookean(input const& in, state& s, material_index const material)
       points_to_G[point]     = G0;
     }
   };
-  hpc::for_each(hpc::device_policy(), s.element_sets[material], functor);
+  hpc::for_each(hpc::device_policy(), elements, functor);
 }
 
 HPC_NOINLINE inline void
-variational_J2(input const& in, state& s, material_index const material)
+variational_J2(input const& in, state& s, material_index const material, element_list const elements)
 {
   auto const dt                 = s.dt;
   auto const points_to_F_total  = s.F_total.cbegin();
@@ -290,11 +310,11 @@ variational_J2(input const& in, state& s, material_index const material)
       points_to_G[point]     = Geff;
     }
   };
-  hpc::for_each(hpc::device_policy(), s.element_sets[material], functor);
+  hpc::for_each(hpc::device_policy(), elements, functor);
 }
 
 HPC_NOINLINE inline void
-ideal_gas(input const& in, state& s, material_index const material)
+ideal_gas(input const& in, state& s, material_index const material, element_list const elements)
 {
   auto const points_to_rho      = s.rho.cbegin();
   auto const points_to_e        = s.e.cbegin();
@@ -318,7 +338,7 @@ ideal_gas(input const& in, state& s, material_index const material)
       points_to_K[point] = K;
     }
   };
-  hpc::for_each(hpc::device_policy(), s.element_sets[material], functor);
+  hpc::for_each(hpc::device_policy(), elements, functor);
 }
 
 HPC_NOINLINE inline hpc::pressure<double>
@@ -327,24 +347,25 @@ kappa_prime(hpc::pressure<double> const mu, hpc::adimensional<double> const x)
   return 200.0 * mu * std::log(x) / x;
 }
 
-HPC_NOINLINE inline void
+template <int NodesInElement, bool ComptetStabilize>
+HPC_NOINLINE void
 update_element_force(state& s)
 {
-  auto const comptet_stabilize     = s.use_comptet_stabilization;
+  assert(s.nodes_in_element.size() == node_in_element_index(NodesInElement));
   auto const points_to_K           = s.K.cbegin();
   auto const points_to_JavgJ       = s.JavgJ.cbegin();
   auto const points_to_sigma       = s.sigma.cbegin();
   auto const points_to_V           = s.V.cbegin();
   auto const point_nodes_to_grad_N = s.grad_N.cbegin();
   auto const point_nodes_to_f      = s.element_f.begin();
-  auto const points_to_point_nodes = s.points * s.nodes_in_element;
   auto       functor               = [=] HPC_DEVICE(point_index const point) {
-    auto const sigma       = points_to_sigma[point].load();
-    auto const V           = points_to_V[point];
-    auto const point_nodes = points_to_point_nodes[point];
-    for (auto const point_node : point_nodes) {
-      auto const grad_N = point_nodes_to_grad_N[point_node].load();
-      if (comptet_stabilize == true) {
+    auto const sigma            = points_to_sigma[point].load();
+    auto const V                = points_to_V[point];
+    auto const first_point_node = hpc::weaken(point) * NodesInElement;
+    for (int i = 0; i < NodesInElement; ++i) {
+      point_node_index const point_node(first_point_node + i);
+      auto const             grad_N = point_nodes_to_grad_N[point_node].load();
+      if (ComptetStabilize) {
         auto const JavgJ = points_to_JavgJ[point];
         auto const K     = points_to_K[point];
         auto const f = -((sigma - kappa_prime(K, JavgJ) * hpc::symmetric_stress<double>::identity()) * grad_N) * V;
@@ -358,27 +379,39 @@ update_element_force(state& s)
   hpc::for_each(hpc::device_policy(), s.points, functor);
 }
 
-HPC_NOINLINE inline void
+template <int NodesInElement>
+HPC_NOINLINE void
+update_element_force(state& s)
+{
+  if (s.use_comptet_stabilization) {
+    update_element_force<NodesInElement, true>(s);
+  } else {
+    update_element_force<NodesInElement, false>(s);
+  }
+}
+
+template <int NodesInElement, int PointsInElement>
+HPC_NOINLINE void
 update_nodal_force(state& s)
 {
+  assert(s.nodes_in_element.size() == node_in_element_index(NodesInElement));
+  assert(s.points_in_element.size() == point_in_element_index(PointsInElement));
   auto const nodes_to_node_elements            = s.nodes_to_node_elements.cbegin();
   auto const node_elements_to_elements         = s.node_elements_to_elements.cbegin();
   auto const node_elements_to_nodes_in_element = s.node_elements_to_nodes_in_element.cbegin();
   auto const point_nodes_to_f                  = s.element_f.cbegin();
   auto const nodes_to_f                        = s.f.begin();
-  auto const points_to_point_nodes             = s.points * s.nodes_in_element;
-  auto const elements_to_points                = s.elements * s.points_in_element;
   auto       functor                           = [=] HPC_DEVICE(node_index const node) {
     auto       node_f        = hpc::force<double>::zero();
     auto const node_elements = nodes_to_node_elements[node];
     for (auto const node_element : node_elements) {
       auto const element         = node_elements_to_elements[node_element];
       auto const node_in_element = node_elements_to_nodes_in_element[node_element];
-      for (auto const point : elements_to_points[element]) {
-        auto const point_nodes = points_to_point_nodes[point];
-        auto const point_node  = point_nodes[node_in_element];
-        auto const point_f     = point_nodes_to_f[point_node].load();
-        node_f                 = node_f + point_f;
+      for (int j = 0; j < PointsInElement; ++j) {
+        auto const             point = hpc::weaken(element) * PointsInElement + j;
+        point_node_index const point_node(point * NodesInElement + hpc::weaken(node_in_element));
+        auto const             point_f = point_nodes_to_f[point_node].load();
+        node_f                         = node_f + point_f;
       }
     }
     nodes_to_f[node] = node_f;
@@ -388,7 +421,7 @@ update_nodal_force(state& s)
 
 HPC_NOINLINE inline void
 zero_acceleration(
-    hpc::device_vector<node_index, int> const&                       domain,
+    entity_sets<node_index>::range_type const                        domain,
     hpc::vector3<double> const                                       axis,
     hpc::device_array_vector<hpc::acceleration<double>, node_index>* a_vector)
 {
@@ -401,35 +434,54 @@ zero_acceleration(
   hpc::for_each(hpc::device_policy(), domain, functor);
 }
 
-HPC_NOINLINE inline void
-update_symm_grad_v(state& s)
-{
-  auto const elements_to_element_nodes = s.elements * s.nodes_in_element;
-  auto const elements_to_points        = s.elements * s.points_in_element;
-  auto const points_to_point_nodes     = s.points * s.nodes_in_element;
-  auto const element_nodes_to_nodes    = s.elements_to_nodes.cbegin();
-  auto const point_nodes_to_grad_N     = s.grad_N.cbegin();
-  auto const nodes_to_v                = s.v.cbegin();
-  auto const points_to_symm_grad_v     = s.symm_grad_v.begin();
-  auto const nodes_in_element          = s.nodes_in_element;
-  auto       functor                   = [=] HPC_DEVICE(element_index const element) {
-    for (auto const point : elements_to_points[element]) {
-      auto       grad_v        = hpc::velocity_gradient<double>::zero();
-      auto const element_nodes = elements_to_element_nodes[element];
-      auto const point_nodes   = points_to_point_nodes[point];
-      for (auto const node_in_element : nodes_in_element) {
-        auto const       element_node = element_nodes[node_in_element];
-        auto const       point_node   = point_nodes[node_in_element];
-        node_index const node         = element_nodes_to_nodes[element_node];
-        auto const       v            = nodes_to_v[node].load();
-        auto const       grad_N       = point_nodes_to_grad_N[point_node].load();
-        grad_v                        = grad_v + outer_product(v, grad_N);
+
+template <int NodesInElement, int PointsInElement, class Elements>
+HPC_NOINLINE void
+update_symm_grad_v(state& s, Elements const& elements)
+{
+  assert(s.nodes_in_element.size() == node_in_element_index(NodesInElement));
+  assert(s.points_in_element.size() == point_in_element_index(PointsInElement));
+  auto const element_nodes_to_nodes = s.elements_to_nodes.cbegin();
+  auto const point_nodes_to_grad_N  = s.grad_N.cbegin();
+  auto const nodes_to_v             = s.v.cbegin();
+  auto const points_to_symm_grad_v  = s.symm_grad_v.begin();
+  auto       functor                = [=] HPC_DEVICE(element_index const element) {
+    hpc::array<hpc::velocity<double>, NodesInElement> v;
+    for (int i = 0; i < NodesInElement; ++i) {
+      element_node_index const element_node(hpc::weaken(element) * NodesInElement + i);
+      v[i] = nodes_to_v[element_nodes_to_nodes[element_node]].load();
+    }
+    for (int j = 0; j < PointsInElement; ++j) {
+      point_index const point(hpc::weaken(element) * PointsInElement + j);
+      auto const        first_point_node = hpc::weaken(point) * NodesInElement;
+      auto              grad_v           = hpc::velocity_gradient<double>::zero();
+      for (int i = 0; i < NodesInElement; ++i) {
+        auto const grad_N = point_nodes_to_grad_N[point_node_index(first_point_node + i)].load();
+        grad_v            = grad_v + outer_product(v[i], grad_N);
       }
       hpc::symmetric_velocity_gradient<double> const symm_grad_v(grad_v);
       points_to_symm_grad_v[point] = symm_grad_v;
     }
   };
-  hpc::for_each(hpc::device_policy(), s.elements, functor);
+  hpc::for_each(hpc::device_policy(), elements, functor);
+}
+
+template <class Elements>
+HPC_NOINLINE void
+update_symm_grad_v(input const& in, state& s, Elements const& elements)
+{
+  switch (in.element) {
+    case BAR: update_symm_grad_v<2, 1>(s, elements); break;
+    case TRIANGLE: update_symm_grad_v<3, 1>(s, elements); break;
+    case TETRAHEDRON: update_symm_grad_v<4, 1>(s, elements); break;
+    case COMPOSITE_TETRAHEDRON: update_symm_grad_v<10, 4>(s, elements); break;
+  }
+}
+
+HPC_NOINLINE inline void
+update_symm_grad_v(input const& in, state& s)
+{
+  update_symm_grad_v(in, s, s.elements);
 }
 
 HPC_NOINLINE inline void
@@ -472,8 +524,9 @@ update_e(
   hpc::for_each(hpc::device_policy(), s.element_sets[material], functor);
 }
 
-HPC_NOINLINE inline void
-apply_viscosity(input const& in, state& s)
+template <class Elements>
+HPC_NOINLINE void
+apply_viscosity(input const& in, state& s, Elements const& elements)
 {
   auto const points_to_symm_grad_v = s.symm_grad_v.cbegin();
   auto const elements_to_h_art     = s.h_art.cbegin();
@@ -503,13 +556,19 @@ apply_viscosity(input const& in, state& s)
       }
     }
   };
-  hpc::for_each(hpc::device_policy(), s.elements, functor);
+  hpc::for_each(hpc::device_policy(), elements, functor);
 }
 
 HPC_NOINLINE inline void
+apply_viscosity(input const& in, state& s)
+{
+  apply_viscosity(in, s, s.elements);
+}
+
+template <bool ComptetStabilize>
+HPC_NOINLINE void
 volume_average_J(state& s)
 {
-  auto const comptet_stabilize  = s.use_comptet_stabilization;
   auto const points_to_V        = s.V.cbegin();
   auto const points_to_F        = s.F_total.begin();
   auto const points_to_JavgJ    = s.JavgJ.begin();
@@ -530,13 +589,23 @@ volume_average_J(state& s)
       auto const old_F = points_to_F[point].load();
       auto const old_J = determinant(old_F);
       auto const new_F = cbrt(average_J / old_J) * old_F;
-      if (comptet_stabilize == true) points_to_JavgJ[point] = average_J / old_J;
+      if (ComptetStabilize) points_to_JavgJ[point] = average_J / old_J;
       points_to_F[point] = new_F;
     }
   };
   hpc::for_each(hpc::device_policy(), s.elements, functor);
 }
 
+HPC_NOINLINE inline void
+volume_average_J(state& s)
+{
+  if (s.use_comptet_stabilization) {
+    volume_average_J<true>(s);
+  } else {
+    volume_average_J<false>(s);
+  }
+}
+
 HPC_NOINLINE inline void
 volume_average_rho(state& s)
 {
@@ -581,10 +650,10 @@ volume_average_e(state& s)
   hpc::for_each(hpc::device_policy(), s.elements, functor);
 }
 
-HPC_NOINLINE inline void
+template <bool ComptetStabilize>
+HPC_NOINLINE void
 volume_average_p(state& s)
 {
-  auto const comptet_stabilize  = s.use_comptet_stabilization;
   auto const points_to_K        = s.K.cbegin();
   auto const points_to_JavgJ    = s.JavgJ.cbegin();
   auto const points_to_V        = s.V.cbegin();
@@ -597,7 +666,7 @@ volume_average_p(state& s)
       auto const sigma = points_to_sigma[point].load();
       auto const p     = -(1.0 / 3.0) * trace(sigma);
       auto const V     = points_to_V[point];
-      if (comptet_stabilize == true) {
+      if (ComptetStabilize) {
         auto const JavgJ = points_to_JavgJ[point];
         auto const K     = points_to_K[point];
         p_integral += V * (p - kappa_prime(K, JavgJ));
@@ -616,21 +685,32 @@ volume_average_p(state& s)
   hpc::for_each(hpc::device_policy(), s.elements, functor);
 }
 
+HPC_NOINLINE inline void
+volume_average_p(state& s)
+{
+  if (s.use_comptet_stabilization) {
+    volume_average_p<true>(s);
+  } else {
+    volume_average_p<false>(s);
+  }
+}
+
 HPC_NOINLINE inline void
 update_single_material_state(
-    input const&                                                 in,
-    state&                                                       s,
-    material_index const                                         material,
-    hpc::time<double> const                                      dt,
-    hpc::device_vector<hpc::pressure<double>, node_index> const& old_p_h)
-{
-  if (in.enable_neo_Hookean[material]) { neo_Hookean(in, s, material); }
-  if (in.enable_variational_J2[material]) { variational_J2(in, s, material); }
+    input const&                                                          in,
+    state&                                                                s,
+    material_index const                                                  material,
+    hpc::time<double> const                                               dt,
+    hpc::device_vector<hpc::pressure<double>, material_node_index> const& old_p_h,
+    element_list const                                                    elements)
+{
+  if (in.enable_neo_Hookean[material]) { neo_Hookean(in, s, material, elements); }
+  if (in.enable_variational_J2[material]) { variational_J2(in, s, material, elements); }
   if (in.enable_ideal_gas[material]) {
     if (in.enable_nodal_energy[material]) {
       nodal_ideal_gas(in, s, material);
     } else {
-      ideal_gas(in, s, material);
+      ideal_gas(in, s, material, elements);
     }
   }
   if (in.enable_nodal_pressure[material] || in.enable_nodal_energy[material]) {
@@ -644,21 +724,39 @@ update_single_material_state(
 
 HPC_NOINLINE inline void
 update_material_state(
-    input const&                                                                                   in,
-    state&                                                                                         s,
-    hpc::time<double> const                                                                        dt,
-    hpc::host_vector<hpc::device_vector<hpc::pressure<double>, node_index>, material_index> const& old_p_h)
+    input const&                                                                                            in,
+    state&                                                                                                  s,
+    hpc::time<double> const                                                                                 dt,
+    hpc::host_vector<hpc::device_vector<hpc::pressure<double>, material_node_index>, material_index> const& old_p_h)
 {
   hpc::fill(hpc::device_policy(), s.sigma, hpc::symmetric_stress<double>::zero());
   hpc::fill(hpc::device_policy(), s.G, hpc::pressure<double>(0.0));
-  for (auto const material : in.materials) { update_single_material_state(in, s, material, dt, old_p_h[material]); }
+  for (auto const material : in.materials) {
+    update_single_material_state(in, s, material, dt, old_p_h[material], s.element_sets[material]);
+  }
 }
 
 HPC_NOINLINE inline void
 update_a_from_material_state(input const& in, state& s)
 {
-  update_element_force(s);
-  update_nodal_force(s);
+  switch (in.element) {
+    case BAR:
+      update_element_force<2>(s);
+      update_nodal_force<2, 1>(s);
+      break;
+    case TRIANGLE:
+      update_element_force<3>(s);
+      update_nodal_force<3, 1>(s);
+      break;
+    case TETRAHEDRON:
+      update_element_force<4>(s);
+      update_nodal_force<4, 1>(s);
+      break;
+    case COMPOSITE_TETRAHEDRON:
+      update_element_force<10>(s);
+      update_nodal_force<10, 4>(s);
+      break;
+  }
   update_a(s);
   for (auto const& cond : in.zero_acceleration_conditions) {
     zero_acceleration(s.node_sets[cond.boundary], cond.axis, &s.a);
@@ -688,20 +786,21 @@ midpoint_predictor_corrector_step(input const& in, state& s)
   hpc::copy(hpc::device_policy(), s.v, old_v);
   hpc::device_vector<hpc::specific_energy<double>, point_index> old_e(s.points.size());
   hpc::copy(hpc::device_policy(), s.e, old_e);
-  hpc::host_vector<hpc::device_vector<hpc::pressure<double>, node_index>, material_index> old_p_h(in.materials.size());
-  hpc::host_vector<hpc::device_vector<hpc::specific_energy<double>, node_index>, material_index> old_e_h(
+  hpc::host_vector<hpc::device_vector<hpc::pressure<double>, material_node_index>, material_index> old_p_h(
+      in.materials.size());
+  hpc::host_vector<hpc::device_vector<hpc::specific_energy<double>, material_node_index>, material_index> old_e_h(
       in.materials.size());
   for (auto const material : in.materials) {
     if (in.enable_nodal_pressure[material]) {
-      old_p_h[material].resize(s.nodes.size());
+      old_p_h[material].resize(s.p_h[material].size());
       hpc::copy(hpc::device_policy(), s.p_h[material], old_p_h[material]);
     }
     if (in.enable_nodal_energy[material]) {
       if (in.enable_p_prime[material]) {
-        old_p_h[material].resize(s.nodes.size());
+        old_p_h[material].resize(s.p_h[material].size());
         hpc::copy(hpc::device_policy(), s.p_h[material], old_p_h[material]);
       }
-      old_e_h[material].resize(s.nodes.size());
+      old_e_h[material].resize(s.e_h[material].size());
       hpc::copy(hpc::device_policy(), s.e_h[material], old_e_h[material]);
     }
   }
@@ -709,16 +808,16 @@ midpoint_predictor_corrector_step(input const& in, state& s)
   for (int pc = 0; pc < npc; ++pc) {
     if (pc == 0) advance_time(in, s.max_stable_dt, s.next_file_output_time, &s.time, &s.dt);
     update_v(s, s.dt / 2.0, old_v);
-    update_symm_grad_v(s);
+    update_symm_grad_v(in, s);
     bool const last_pc = (pc == (npc - 1));
     auto const half_dt = last_pc ? s.dt : s.dt / 2.0;
     for (auto const material : in.materials) {
       if (in.enable_nodal_pressure[material]) { update_p_h(s, half_dt, material, old_p_h[material]); }
     }
     stress_power(s);
+    update_e_h_dot_from_a(in, s);
     for (auto const material : in.materials) {
       if (in.enable_nodal_energy[material]) {
-        update_e_h_dot_from_a(in, s, material);
         update_e_h(s, half_dt, material, old_e_h[material]);
       } else {
         update_e(s, half_dt, material, old_e);
@@ -729,35 +828,31 @@ midpoint_predictor_corrector_step(input const& in, state& s)
     if (s.use_displacement_contact == true) { enforce_contact_constraints(s); }
     if (last_pc) { update_v(s, s.dt, old_v); }
     update_x(s);
-    update_reference(s);
+    update_reference(in, s);
     if (in.enable_J_averaging) volume_average_J(s);
     if (in.enable_rho_averaging) volume_average_rho(s);
-    for (auto const material : in.materials) {
-      if (in.enable_nodal_energy[material]) {
-        update_nodal_density(s, material);
-        interpolate_rho(s, material);
-      }
-    }
+    update_nodal_density(in, s);
+    interpolate_rho(in, s);
     if (in.enable_adapt) {
       update_quality(in, s);
       update_min_quality(s);
     }
-    update_symm_grad_v(s);
+    update_symm_grad_v(in, s);
     update_h_min(in, s);
     if (in.enable_viscosity) update_h_art(in, s);
     update_material_state(in, s, half_dt, old_p_h);
-    for (auto const material : in.materials) {
-      if (in.enable_nodal_energy[material]) { interpolate_K(s, material); }
-    }
+    interpolate_K(in, s);
     update_c(s);
     if (in.enable_viscosity) apply_viscosity(in, s);
     if (in.enable_p_averaging) volume_average_p(s);
     if (last_pc) update_element_dt(s);
     if (last_pc) find_max_stable_dt(s);
     update_a_from_material_state(in, s);
+    update_p_h_dot_from_a(in, s);
     for (auto const material : in.materials) {
-      if (in.enable_nodal_pressure[material]) { update_p_h_dot_from_a(in, s, material); }
-      if (!(in.enable_nodal_pressure[material] || in.enable_nodal_energy[material])) { update_p(s, material); }
+      if (!(in.enable_nodal_pressure[material] || in.enable_nodal_energy[material])) {
+        update_p(s, s.element_sets[material]);
+      }
     }
   }
 }
@@ -765,13 +860,14 @@ midpoint_predictor_corrector_step(input const& in, state& s)
 HPC_NOINLINE inline void
 velocity_verlet_step(input const& in, state& s)
 {
-  hpc::host_vector<hpc::device_vector<hpc::pressure<double>, node_index>, material_index> old_p_h(in.materials.size());
+  hpc::host_vector<hpc::device_vector<hpc::pressure<double>, material_node_index>, material_index> old_p_h(
+      in.materials.size());
   advance_time(in, s.max_stable_dt, s.next_file_output_time, &s.time, &s.dt);
   update_v(s, s.dt / 2.0, s.v);
   hpc::fill(hpc::serial_policy(), s.u, hpc::displacement<double>(0.0, 0.0, 0.0));
   update_u(s, s.dt);
   update_x(s);
-  update_reference(s);
+  update_reference(in, s);
   if (in.enable_J_averaging) volume_average_J(s);
   update_h_min(in, s);
   update_material_state(in, s, s.dt, old_p_h);
@@ -779,12 +875,9 @@ velocity_verlet_step(input const& in, state& s)
   update_element_dt(s);
   find_max_stable_dt(s);
   update_a_from_material_state(in, s);
+  update_p_h_dot_from_a(in, s);
   for (auto const material : in.materials) {
-    if (in.enable_nodal_pressure[material]) {
-      update_p_h_dot_from_a(in, s, material);
-    } else {
-      update_p(s, material);
-    }
+    if (!in.enable_nodal_pressure[material]) { update_p(s, s.element_sets[material]); }
   }
   update_v(s, s.dt / 2.0, s.v);
 }
@@ -814,36 +907,33 @@ initialize_material_scalar(
   hpc::for_each(hpc::device_policy(), s.element_sets[material], functor);
 }
 
-HPC_NOINLINE inline void
+void
 common_initialization_part1(input const& in, state& s)
 {
   initialize_V(in, s);
   if (in.enable_viscosity) update_h_art(in, s);
   update_nodal_mass(in, s);
-  for (auto const material : in.materials) {
-    if (in.enable_nodal_energy[material]) { update_nodal_density(s, material); }
-  }
+  update_nodal_density(in, s);
   initialize_grad_N(in, s);
   if (in.enable_adapt) {
     update_quality(in, s);
     update_min_quality(s);
   }
-  update_symm_grad_v(s);
+  update_symm_grad_v(in, s);
   update_h_min(in, s);
 }
 
-HPC_NOINLINE inline void
+void
 common_initialization_part2(input const& in, state& s)
 {
-  hpc::host_vector<hpc::device_vector<hpc::pressure<double>, node_index>, material_index> old_p_h(in.materials.size());
+  hpc::host_vector<hpc::device_vector<hpc::pressure<double>, material_node_index>, material_index> old_p_h(
+      in.materials.size());
   if (hpc::any_of(hpc::serial_policy(), in.enable_p_prime)) {
     hpc::fill(hpc::device_policy(), s.element_dt, hpc::time<double>(0.0));
     hpc::fill(hpc::device_policy(), s.c, hpc::speed<double>(0.0));
   }
   update_material_state(in, s, 0.0, old_p_h);
-  for (auto const material : in.materials) {
-    if (in.enable_nodal_energy[material]) { interpolate_K(s, material); }
-  }
+  interpolate_K(in, s);
   update_c(s);
   if (in.enable_viscosity) {
     apply_viscosity(in, s);
@@ -853,9 +943,9 @@ common_initialization_part2(input const& in, state& s)
   update_element_dt(s);
   find_max_stable_dt(s);
   update_a_from_material_state(in, s);
+  update_p_h_dot_from_a(in, s);
   for (auto const material : in.materials) {
-    if (in.enable_nodal_pressure[material]) { update_p_h_dot_from_a(in, s, material); }
-    if (!(in.enable_nodal_pressure[material] || in.enable_nodal_energy[material])) { update_p(s, material); }
+    if (!(in.enable_nodal_pressure[material] || in.enable_nodal_energy[material])) { update_p(s, s.element_sets[material]); }
     if (in.enable_nodal_energy[material]) {
       hpc::fill(hpc::device_policy(), s.q, hpc::heat_flux<double>::zero());
       if (in.enable_p_prime[material]) { hpc::fill(hpc::device_policy(), s.p_prime, hpc::pressure<double>(0)); }
@@ -863,29 +953,58 @@ common_initialization_part2(input const& in, state& s)
   }
 }
 
+bool
+can_reinitialize_adapted(input const& in)
+{
+  return !hpc::any_of(hpc::serial_policy(), in.enable_nodal_pressure) &&
+         !hpc::any_of(hpc::serial_policy(), in.enable_nodal_energy);
+}
+
 void
-run(input const& in, std::string const& filename)
+reinitialize_adapted(input const& in, state& s)
 {
-  std::cout << std::scientific << std::setprecision(17);
-  auto const num_file_output_periods = in.num_file_output_periods;
-  auto const file_output_period =
-      num_file_output_periods ? in.end_time / double(num_file_output_periods) : hpc::time<double>(0.0);
-  state s;
-  if (filename == "") {
-    build_mesh(in, s);
-  } else {
-    auto const err_code = lgr::read_exodus_file(filename, in, s);
-    if (err_code != 0) {
-      std::string const error_msg = "Error reading Exodus file : " + filename;
-      HPC_ERROR_EXIT(error_msg.c_str());
+  auto const elements = s.adapted_element_sets.all();
+  initialize_V(in, s, elements);
+  if (in.enable_viscosity) update_h_art(in, s, elements);
+  update_nodal_mass(in, s, s.adapted_node_sets);
+  initialize_grad_N(in, s, elements);
+  update_quality(in, s, elements);
+  update_min_quality(s);
+  update_symm_grad_v(in, s, elements);
+  update_h_min(in, s, elements);
+  auto const elements_to_points = s.elements * s.points_in_element;
+  auto const points_to_sigma    = s.sigma.begin();
+  auto const points_to_G        = s.G.begin();
+  auto       zero_functor       = [=] HPC_DEVICE(element_index const element) {
+    for (auto const point : elements_to_points[element]) {
+      points_to_sigma[point] = hpc::symmetric_stress<double>::zero();
+      points_to_G[point]     = hpc::pressure<double>(0.0);
     }
+  };
+  hpc::for_each(hpc::device_policy(), elements, zero_functor);
+  hpc::device_vector<hpc::pressure<double>, material_node_index> const no_old_p_h;
+  for (auto const material : in.materials) {
+    update_single_material_state(in, s, material, 0.0, no_old_p_h, s.adapted_element_sets[material]);
   }
+  update_c(s, elements);
+  if (in.enable_viscosity) apply_viscosity(in, s, elements);
+  update_element_dt(s, elements);
+  find_max_stable_dt(s);
+  update_a_from_material_state(in, s);
+  for (auto const material : in.materials) { update_p(s, s.adapted_element_sets[material]); }
+}
+
+void
+initialize_state(input const& in, state& s)
+{
   if (in.x_transform) in.x_transform(&s.x);
   s.use_displacement_contact = in.use_contact;
   resize_state(in, s);
   assign_element_materials(in, s);
   compute_nodal_materials(in, s);
   collect_node_sets(in, s);
+  collect_material_nodes(in, s);
+  resize_material_nodal_state(in, s);
   collect_element_sets(in, s);
   for (auto const material : in.materials) {
     initialize_material_scalar(in.rho0[material], s, material, s.rho);
@@ -910,12 +1029,44 @@ run(input const& in, std::string const& filename)
   common_initialization_part1(in, s);
   common_initialization_part2(in, s);
   if (in.enable_adapt) initialize_h_adapt(s);
+}
+
+void
+run(input const& in, std::string const& filename)
+{
+  std::cout << std::scientific << std::setprecision(17);
+  auto const num_file_output_periods = in.num_file_output_periods;
+  auto const file_output_period =
+      num_file_output_periods ? in.end_time / double(num_file_output_periods) : hpc::time<double>(0.0);
+  state      s;
+  bool const restart = !in.restart_file.empty();
+  if (restart) {
+    read_checkpoint(in.restart_file, s);
+  } else if (filename == "") {
+    build_mesh(in, s);
+  } else {
+    auto const err_code = lgr::read_exodus_file(filename, in, s);
+    if (err_code != 0) {
+      std::string const error_msg = "Error reading Exodus file : " + filename;
+      HPC_ERROR_EXIT(error_msg.c_str());
+    }
+  }
+  if (!restart) {
+    initialize_state(in, s);
+    s.next_file_output_time = num_file_output_periods ? 0.0 : in.end_time;
+  }
   file_writer output_file(in.name);
-  s.next_file_output_time = num_file_output_periods ? 0.0 : in.end_time;
-  int file_output_index   = 0;
-  int file_period_index   = 0;
+  int         file_output_index = 0;
+  int         file_period_index = 0;
+  if (restart && num_file_output_periods) {
+    // checkpoints are taken right after an output, so resume at the start of the following period
+    file_period_index = int(std::round(double(s.next_file_output_time / file_output_period)));
+    file_output_index = file_period_index;
+    output_file.resume(in, s);
+  }
+  bool skip_output = restart;
   while (s.time < in.end_time) {
-    if (num_file_output_periods) {
+    if (num_file_output_periods && !skip_output) {
       if (in.output_to_command_line) {
         std::cout << "outputting file n " << file_output_index << " time " << double(s.time) << "\n";
       }
@@ -925,7 +1076,11 @@ run(input const& in, std::string const& filename)
       ++file_period_index;
       s.next_file_output_time = double(file_period_index) * file_output_period;
       s.next_file_output_time = std::min(s.next_file_output_time, in.end_time);
+      if (in.write_checkpoints) {
+        write_checkpoint(in.name + "_" + std::to_string(file_output_index - 1) + ".ckpt", s);
+      }
     }
+    skip_output = false;
     while (s.time < s.next_file_output_time) {
       if (in.output_to_command_line) {
         std::cout << "step " << s.n << " time " << double(s.time) << " dt " << double(s.max_stable_dt) << "\n";
@@ -933,12 +1088,18 @@ run(input const& in, std::string const& filename)
       time_integrator_step(in, s);
       if (in.enable_adapt && (s.n % 10 == 0)) {
         for (int i = 0; i < 4; ++i) {
-          adapt(in, s);
+          // another pass over an unchanged mesh would not change it either
+          if (!adapt(in, s)) break;
+          ++s.adapt_epoch;
           resize_state(in, s);
+          resize_material_nodal_state(in, s);
           collect_element_sets(in, s);
-          collect_node_sets(in, s);
-          common_initialization_part1(in, s);
-          common_initialization_part2(in, s);
+          if (can_reinitialize_adapted(in)) {
+            reinitialize_adapted(in, s);
+          } else {
+            common_initialization_part1(in, s);
+            common_initialization_part2(in, s);
+          }
         }
       }
       ++s.n;
@@ -951,6 +1112,7 @@ run(input const& in, std::string const& filename)
     output_file.capture(in, s);
     output_file.write(in, file_output_index);
   }
+  output_file.flush();
   if (in.output_to_command_line) { std::cout << "final time " << double(s.time) << "\n"; }
 }
 
@@ -6,6 +6,27 @@ namespace lgr {
 class input;
 class state;
 
+// builds every derived field of a freshly built or read mesh
+void
+initialize_state(input const& in, state& s);
+
+void
+common_initialization_part1(input const& in, state& s);
+
+void
+common_initialization_part2(input const& in, state& s);
+
+// nodal pressure and energy couple elements through their nodes, so those
+// still need everything reinitialized after adapt()
+bool
+can_reinitialize_adapted(input const& in);
+
+/* adapt() carries over the derived data of every element and node it left
+   alone, so this recomputes common_initialization_part1 and part2 only for
+   the elements it created and the nodes around them. */
+void
+reinitialize_adapted(input const& in, state& s);
+
 void
 run(input const& in, std::string const& filename = "");
 
@@ -23,6 +23,28 @@ update_c(state& s)
   hpc::for_each(hpc::device_policy(), s.points, functor);
 }
 
+template <class Elements>
+HPC_NOINLINE void
+update_c(state& s, Elements const& elements)
+{
+  auto const points_to_rho      = s.rho.cbegin();
+  auto const points_to_K        = s.K.cbegin();
+  auto const points_to_G        = s.G.cbegin();
+  auto const points_to_c        = s.c.begin();
+  auto const elements_to_points = s.elements * s.points_in_element;
+  auto       functor            = [=] HPC_DEVICE(element_index const element) {
+    for (auto const point : elements_to_points[element]) {
+      auto const rho     = points_to_rho[point];
+      auto const K       = points_to_K[point];
+      auto const G       = points_to_G[point];
+      auto const M       = K + (4.0 / 3.0) * G;
+      auto const c       = sqrt(M / rho);
+      points_to_c[point] = c;
+    }
+  };
+  hpc::for_each(hpc::device_policy(), elements, functor);
+}
+
 HPC_NOINLINE inline void
 find_max_stable_dt(state& s)
 {
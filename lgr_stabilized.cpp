@@ -1,6 +1,10 @@
+#include <hpc_array.hpp>
 #include <lgr_input.hpp>
+#include <lgr_material_set.hpp>
 #include <lgr_stabilized.hpp>
 #include <lgr_state.hpp>
+#include <stdexcept>
+#include <string>
 
 namespace lgr {
 
@@ -10,66 +14,127 @@ get_N(state& s)
   return 1.0 / double(hpc::weaken(s.nodes_in_element.size()));
 }
 
+// the most stabilized materials that may meet at one node
+constexpr int max_node_materials = 8;
+
+// the per-node kernels below keep one slot per stabilized material, so more
+// than max_node_materials of them are refused here rather than overrun there
+HPC_NOINLINE inline material_set
+materials_where(input const& in, hpc::host_vector<bool, material_index> const& is_enabled)
+{
+  auto materials = material_set::none();
+  for (auto const material : in.materials) {
+    if (is_enabled[material]) materials = materials | material_set(material);
+  }
+  if (materials.size() > max_node_materials) {
+    throw std::runtime_error(
+        "at most " + std::to_string(max_node_materials) + " materials may use nodal pressure or nodal energy");
+  }
+  return materials;
+}
+
+/* The nodal arrays of a set of materials, reachable from inside a kernel so
+   that one pass over the mesh serves all of those materials at once. This
+   keeps a device array of one pointer per material; kernels capture begin(). */
+template <class T>
+class material_nodal_arrays
+{
+  using pointers_type = hpc::device_vector<T*, material_index>;
+
+ public:
+  class iterator
+  {
+   public:
+    explicit iterator(typename pointers_type::const_iterator pointers_in) : pointers(pointers_in) {}
+    HPC_HOST_DEVICE hpc::pointer_iterator<T, material_node_index>
+                    operator[](material_index const material) const
+    {
+      return hpc::pointer_iterator<T, material_node_index>(pointers[material]);
+    }
+
+   private:
+    typename pointers_type::const_iterator pointers;
+  };
+  template <class Vectors>
+  material_nodal_arrays(input const& in, Vectors& vectors, material_set const materials)
+      : pointers(in.materials.size())
+  {
+    hpc::pinned_vector<T*, material_index> host_pointers(in.materials.size());
+    for (auto const material : in.materials) {
+      host_pointers[material] = materials.contains(material_set(material)) ? vectors[material].data() : nullptr;
+    }
+    hpc::copy(host_pointers, pointers);
+  }
+  iterator
+  begin() const
+  {
+    return iterator(pointers.cbegin());
+  }
+
+ private:
+  pointers_type pointers;
+};
+
 void
 update_p_h(
-    state&                                                       s,
-    hpc::time<double> const                                      dt,
-    material_index const                                         material,
-    hpc::device_vector<hpc::pressure<double>, node_index> const& old_p_h_vector)
+    state&                                                                s,
+    hpc::time<double> const                                               dt,
+    material_index const                                                  material,
+    hpc::device_vector<hpc::pressure<double>, material_node_index> const& old_p_h_vector)
 {
-  auto const nodes_to_p_h     = s.p_h[material].begin();
-  auto const nodes_to_old_p_h = old_p_h_vector.cbegin();
-  auto const nodes_to_p_h_dot = s.p_h_dot[material].cbegin();
-  auto       functor          = [=] HPC_DEVICE(node_index const node) {
-    auto const old_p_h = nodes_to_old_p_h[node];
-    auto const p_h_dot = nodes_to_p_h_dot[node];
-    auto const p_h     = old_p_h + dt * p_h_dot;
-    nodes_to_p_h[node] = p_h;
+  auto const material_nodes_to_p_h     = s.p_h[material].begin();
+  auto const material_nodes_to_old_p_h = old_p_h_vector.cbegin();
+  auto const material_nodes_to_p_h_dot = s.p_h_dot[material].cbegin();
+  auto       functor                   = [=] HPC_DEVICE(material_node_index const material_node) {
+    auto const old_p_h                   = material_nodes_to_old_p_h[material_node];
+    auto const p_h_dot                   = material_nodes_to_p_h_dot[material_node];
+    auto const p_h                       = old_p_h + dt * p_h_dot;
+    material_nodes_to_p_h[material_node] = p_h;
   };
-  hpc::for_each(hpc::device_policy(), s.node_sets[material], functor);
+  hpc::for_each(hpc::device_policy(), hpc::counting_range<material_node_index>(s.p_h[material].size()), functor);
 }
 
 void
 update_e_h(
-    state&                                                              s,
-    hpc::time<double> const                                             dt,
-    material_index const                                                material,
-    hpc::device_vector<hpc::specific_energy<double>, node_index> const& old_e_h_vector)
+    state&                                                                       s,
+    hpc::time<double> const                                                      dt,
+    material_index const                                                         material,
+    hpc::device_vector<hpc::specific_energy<double>, material_node_index> const& old_e_h_vector)
 {
-  auto const nodes_to_e_h_dot = s.e_h_dot[material].cbegin();
-  auto const nodes_to_old_e_h = old_e_h_vector.cbegin();
-  auto const nodes_to_e_h     = s.e_h[material].begin();
-  auto       functor          = [=] HPC_DEVICE(node_index const node) {
-    auto const e_h_dot = nodes_to_e_h_dot[node];
-    auto const old_e_h = nodes_to_old_e_h[node];
+  auto const material_nodes_to_e_h_dot = s.e_h_dot[material].cbegin();
+  auto const material_nodes_to_old_e_h = old_e_h_vector.cbegin();
+  auto const material_nodes_to_e_h     = s.e_h[material].begin();
+  auto       functor                   = [=] HPC_DEVICE(material_node_index const material_node) {
+    auto const e_h_dot = material_nodes_to_e_h_dot[material_node];
+    auto const old_e_h = material_nodes_to_old_e_h[material_node];
     assert(old_e_h > 0.0);
     auto const e_h = old_e_h + dt * e_h_dot;
     assert(e_h > 0.0);
-    nodes_to_e_h[node] = e_h;
+    material_nodes_to_e_h[material_node] = e_h;
   };
-  hpc::for_each(hpc::device_policy(), s.node_sets[material], functor);
+  hpc::for_each(hpc::device_policy(), hpc::counting_range<material_node_index>(s.e_h[material].size()), functor);
 }
 
 void
 update_sigma_with_p_h(state& s, material_index const material)
 {
-  auto const elements_to_element_nodes  = s.elements * s.nodes_in_element;
-  auto const elements_to_element_points = s.elements * s.points_in_element;
-  auto const element_nodes_to_nodes     = s.elements_to_nodes.cbegin();
-  auto const nodes_in_element           = s.nodes_in_element;
-  auto const nodes_to_p_h               = s.p_h[material].cbegin();
-  auto const N                          = get_N(s);
-  auto const points_to_sigma            = s.sigma.begin();
-  auto       functor                    = [=] HPC_DEVICE(element_index const element) {
+  auto const elements_to_element_nodes       = s.elements * s.nodes_in_element;
+  auto const elements_to_element_points      = s.elements * s.points_in_element;
+  auto const element_nodes_to_material_nodes = s.element_nodes_to_material_nodes.cbegin();
+  auto const nodes_in_element                = s.nodes_in_element;
+  auto const material_nodes_to_p_h           = s.p_h[material].cbegin();
+  auto const N                               = get_N(s);
+  auto const points_to_sigma                 = s.sigma.begin();
+  auto       functor                         = [=] HPC_DEVICE(element_index const element) {
     auto const element_nodes  = elements_to_element_nodes[element];
     auto const element_points = elements_to_element_points[element];
     for (auto const point : element_points) {
       hpc::pressure<double> point_p_h = 0.0;
       for (auto const node_in_element : nodes_in_element) {
-        auto const element_node = element_nodes[node_in_element];
-        auto const node         = element_nodes_to_nodes[element_node];
-        auto const p_h          = nodes_to_p_h[node];
-        point_p_h               = point_p_h + N * p_h;
+        auto const element_node  = element_nodes[node_in_element];
+        auto const material_node = element_nodes_to_material_nodes[element_node];
+        auto const p_h           = material_nodes_to_p_h[material_node];
+        point_p_h                = point_p_h + N * p_h;
       }
       auto const old_sigma   = points_to_sigma[point].load();
       auto const new_sigma   = deviatoric_part(old_sigma) - point_p_h;
@@ -82,21 +147,22 @@ update_sigma_with_p_h(state& s, material_index const material)
 HPC_NOINLINE inline void
 update_v_prime(input const& in, state& s, material_index const material)
 {
-  auto const elements_to_element_nodes = s.elements * s.nodes_in_element;
-  auto const elements_to_points        = s.elements * s.points_in_element;
-  auto const points_to_point_nodes     = s.points * s.nodes_in_element;
-  auto const nodes_in_element          = s.nodes_in_element;
-  auto const element_nodes_to_nodes    = s.elements_to_nodes.cbegin();
-  auto const point_nodes_to_grad_N     = s.grad_N.cbegin();
-  auto const points_to_dt              = s.element_dt.cbegin();
-  auto const points_to_rho             = s.rho.cbegin();
-  auto const nodes_to_a                = s.a.cbegin();
-  auto const nodes_to_p_h              = s.p_h[material].cbegin();
-  auto const points_to_v_prime         = s.v_prime.begin();
-  auto const c_tau                     = in.c_tau[material];
-  auto const c_v                       = in.c_v[material];
-  auto const N                         = get_N(s);
-  auto       functor                   = [=] HPC_DEVICE(element_index const element) {
+  auto const elements_to_element_nodes       = s.elements * s.nodes_in_element;
+  auto const elements_to_points              = s.elements * s.points_in_element;
+  auto const points_to_point_nodes           = s.points * s.nodes_in_element;
+  auto const nodes_in_element                = s.nodes_in_element;
+  auto const element_nodes_to_nodes          = s.elements_to_nodes.cbegin();
+  auto const point_nodes_to_grad_N           = s.grad_N.cbegin();
+  auto const points_to_dt                    = s.element_dt.cbegin();
+  auto const points_to_rho                   = s.rho.cbegin();
+  auto const element_nodes_to_material_nodes = s.element_nodes_to_material_nodes.cbegin();
+  auto const nodes_to_a                      = s.a.cbegin();
+  auto const material_nodes_to_p_h           = s.p_h[material].cbegin();
+  auto const points_to_v_prime               = s.v_prime.begin();
+  auto const c_tau                           = in.c_tau[material];
+  auto const c_v                             = in.c_v[material];
+  auto const N                               = get_N(s);
+  auto       functor                         = [=] HPC_DEVICE(element_index const element) {
     auto const element_nodes = elements_to_element_nodes[element];
     for (auto const point : elements_to_points[element]) {
       auto const point_nodes = points_to_point_nodes[point];
@@ -105,14 +171,15 @@ update_v_prime(input const& in, state& s, material_index const material)
       auto       grad_p      = hpc::pressure_gradient<double>::zero();
       auto       a           = hpc::acceleration<double>::zero();
       for (auto const node_in_element : nodes_in_element) {
-        auto const element_node = element_nodes[node_in_element];
-        auto const point_node   = point_nodes[node_in_element];
-        auto const node         = element_nodes_to_nodes[element_node];
-        auto const p_h          = nodes_to_p_h[node];
-        auto const grad_N       = point_nodes_to_grad_N[point_node].load();
-        grad_p                  = grad_p + (grad_N * p_h);
-        auto const a_of_node    = nodes_to_a[node].load();
-        a                       = a + a_of_node;
+        auto const element_node  = element_nodes[node_in_element];
+        auto const point_node    = point_nodes[node_in_element];
+        auto const node          = element_nodes_to_nodes[element_node];
+        auto const material_node = element_nodes_to_material_nodes[element_node];
+        auto const p_h           = material_nodes_to_p_h[material_node];
+        auto const grad_N        = point_nodes_to_grad_N[point_node].load();
+        grad_p                   = grad_p + (grad_N * p_h);
+        auto const a_of_node     = nodes_to_a[node].load();
+        a                        = a + a_of_node;
       }
       a                        = a * N;
       auto const rho           = points_to_rho[point];
@@ -125,26 +192,26 @@ update_v_prime(input const& in, state& s, material_index const material)
 
 HPC_NOINLINE inline void
 update_p_prime(
-    input const&                                                 in,
-    state&                                                       s,
-    material_index const                                         material,
-    hpc::time<double> const                                      dt,
-    hpc::device_vector<hpc::pressure<double>, node_index> const& old_p_h_vector)
+    input const&                                                          in,
+    state&                                                                s,
+    material_index const                                                  material,
+    hpc::time<double> const                                               dt,
+    hpc::device_vector<hpc::pressure<double>, material_node_index> const& old_p_h_vector)
 {
-  auto const elements_to_element_nodes = s.elements * s.nodes_in_element;
-  auto const elements_to_points        = s.elements * s.points_in_element;
-  auto const nodes_in_element          = s.nodes_in_element;
-  auto const element_nodes_to_nodes    = s.elements_to_nodes.cbegin();
-  auto const points_to_symm_grad_v     = s.symm_grad_v.cbegin();
-  auto const points_to_dt              = s.element_dt.cbegin();
-  auto const points_to_K               = s.K.cbegin();
-  auto const nodes_to_p_h              = s.p_h[material].cbegin();
-  auto const nodes_to_old_p_h          = old_p_h_vector.cbegin();
-  auto const points_to_p_prime         = s.p_prime.begin();
-  auto const c_tau                     = in.c_tau[material];
-  auto const c_p                       = in.c_p[material];
-  auto const N                         = get_N(s);
-  auto       functor                   = [=] HPC_DEVICE(element_index const element) {
+  auto const elements_to_element_nodes       = s.elements * s.nodes_in_element;
+  auto const elements_to_points              = s.elements * s.points_in_element;
+  auto const nodes_in_element                = s.nodes_in_element;
+  auto const element_nodes_to_material_nodes = s.element_nodes_to_material_nodes.cbegin();
+  auto const points_to_symm_grad_v           = s.symm_grad_v.cbegin();
+  auto const points_to_dt                    = s.element_dt.cbegin();
+  auto const points_to_K                     = s.K.cbegin();
+  auto const material_nodes_to_p_h           = s.p_h[material].cbegin();
+  auto const material_nodes_to_old_p_h       = old_p_h_vector.cbegin();
+  auto const points_to_p_prime               = s.p_prime.begin();
+  auto const c_tau                           = in.c_tau[material];
+  auto const c_p                             = in.c_p[material];
+  auto const N                               = get_N(s);
+  auto       functor                         = [=] HPC_DEVICE(element_index const element) {
     auto const element_nodes = elements_to_element_nodes[element];
     for (auto const point : elements_to_points[element]) {
       auto const                 point_dt    = points_to_dt[point];
@@ -156,11 +223,11 @@ update_p_prime(
         hpc::pressure<double> old_p = 0.0;
         hpc::pressure<double> p     = 0.0;
         for (auto const node_in_element : nodes_in_element) {
-          auto const       element_node = element_nodes[node_in_element];
-          node_index const node         = element_nodes_to_nodes[element_node];
-          auto const       p_h          = nodes_to_p_h[node];
+          auto const element_node  = element_nodes[node_in_element];
+          auto const material_node = element_nodes_to_material_nodes[element_node];
+          auto const p_h           = material_nodes_to_p_h[material_node];
           p += p_h * N;
-          auto const old_p_h = nodes_to_old_p_h[node];
+          auto const old_p_h = material_nodes_to_old_p_h[material_node];
           old_p += old_p_h * N;
         }
         p_dot = (p - old_p) / dt;
@@ -175,31 +242,31 @@ update_p_prime(
 
 void
 update_sigma_with_p_h_p_prime(
-    input const&                                                 in,
-    state&                                                       s,
-    material_index const                                         material,
-    hpc::time<double> const                                      dt,
-    hpc::device_vector<hpc::pressure<double>, node_index> const& old_p_h_vector)
+    input const&                                                          in,
+    state&                                                                s,
+    material_index const                                                  material,
+    hpc::time<double> const                                               dt,
+    hpc::device_vector<hpc::pressure<double>, material_node_index> const& old_p_h_vector)
 {
   update_p_prime(in, s, material, dt, old_p_h_vector);
-  auto const elements_to_element_nodes  = s.elements * s.nodes_in_element;
-  auto const elements_to_element_points = s.elements * s.points_in_element;
-  auto const element_nodes_to_nodes     = s.elements_to_nodes.cbegin();
-  auto const nodes_in_element           = s.nodes_in_element;
-  auto const nodes_to_p_h               = s.p_h[material].cbegin();
-  auto const N                          = get_N(s);
-  auto const points_to_p_prime          = s.p_prime.begin();
-  auto const points_to_sigma            = s.sigma.begin();
-  auto       functor                    = [=] HPC_DEVICE(element_index const element) {
+  auto const elements_to_element_nodes       = s.elements * s.nodes_in_element;
+  auto const elements_to_element_points      = s.elements * s.points_in_element;
+  auto const element_nodes_to_material_nodes = s.element_nodes_to_material_nodes.cbegin();
+  auto const nodes_in_element                = s.nodes_in_element;
+  auto const material_nodes_to_p_h           = s.p_h[material].cbegin();
+  auto const N                               = get_N(s);
+  auto const points_to_p_prime               = s.p_prime.begin();
+  auto const points_to_sigma                 = s.sigma.begin();
+  auto       functor                         = [=] HPC_DEVICE(element_index const element) {
     auto const element_nodes  = elements_to_element_nodes[element];
     auto const element_points = elements_to_element_points[element];
     for (auto const point : element_points) {
       hpc::pressure<double> point_p_h = 0.0;
       for (auto const node_in_element : nodes_in_element) {
-        auto const element_node = element_nodes[node_in_element];
-        auto const node         = element_nodes_to_nodes[element_node];
-        auto const p_h          = nodes_to_p_h[node];
-        point_p_h               = point_p_h + N * p_h;
+        auto const element_node  = element_nodes[node_in_element];
+        auto const material_node = element_nodes_to_material_nodes[element_node];
+        auto const p_h           = material_nodes_to_p_h[material_node];
+        point_p_h                = point_p_h + N * p_h;
       }
       auto const old_sigma   = points_to_sigma[point].load();
       auto const p_prime     = points_to_p_prime[point];
@@ -213,22 +280,23 @@ update_sigma_with_p_h_p_prime(
 HPC_NOINLINE inline void
 update_q(input const& in, state& s, material_index const material)
 {
-  auto const elements_to_element_nodes = s.elements * s.nodes_in_element;
-  auto const elements_to_points        = s.elements * s.points_in_element;
-  auto const points_to_point_nodes     = s.points * s.nodes_in_element;
-  auto const nodes_in_element          = s.nodes_in_element;
-  auto const element_nodes_to_nodes    = s.elements_to_nodes.cbegin();
-  auto const point_nodes_to_grad_N     = s.grad_N.cbegin();
-  auto const points_to_dt              = s.element_dt.cbegin();
-  auto const points_to_rho             = s.rho.cbegin();
-  auto const nodes_to_a                = s.a.cbegin();
-  auto const nodes_to_p_h              = s.p_h[material].cbegin();
-  auto const nodes_to_dp_de            = s.dp_de_h[material].cbegin();
-  auto const points_to_K               = s.K.cbegin();
-  auto const points_to_q               = s.q.begin();
-  auto const c_tau                     = in.c_tau[material];
-  auto const N                         = get_N(s);
-  auto       functor                   = [=] HPC_DEVICE(element_index const element) {
+  auto const elements_to_element_nodes       = s.elements * s.nodes_in_element;
+  auto const elements_to_points              = s.elements * s.points_in_element;
+  auto const points_to_point_nodes           = s.points * s.nodes_in_element;
+  auto const nodes_in_element                = s.nodes_in_element;
+  auto const element_nodes_to_nodes          = s.elements_to_nodes.cbegin();
+  auto const point_nodes_to_grad_N           = s.grad_N.cbegin();
+  auto const points_to_dt                    = s.element_dt.cbegin();
+  auto const points_to_rho                   = s.rho.cbegin();
+  auto const element_nodes_to_material_nodes = s.element_nodes_to_material_nodes.cbegin();
+  auto const nodes_to_a                      = s.a.cbegin();
+  auto const material_nodes_to_p_h           = s.p_h[material].cbegin();
+  auto const material_nodes_to_dp_de         = s.dp_de_h[material].cbegin();
+  auto const points_to_K                     = s.K.cbegin();
+  auto const points_to_q                     = s.q.begin();
+  auto const c_tau                           = in.c_tau[material];
+  auto const N                               = get_N(s);
+  auto       functor                         = [=] HPC_DEVICE(element_index const element) {
     auto const element_nodes = elements_to_element_nodes[element];
     for (auto const point : elements_to_points[element]) {
       auto const            dt          = points_to_dt[point];
@@ -239,16 +307,17 @@ update_q(input const& in, state& s, material_index const material)
       dp_de_t               dp_de       = 0.0;
       auto const            point_nodes = points_to_point_nodes[point];
       for (auto const node_in_element : nodes_in_element) {
-        auto const element_node = element_nodes[node_in_element];
-        auto const point_node   = point_nodes[node_in_element];
-        auto const node         = element_nodes_to_nodes[element_node];
-        auto const p_h_of_node  = nodes_to_p_h[node];
-        p_h                     = p_h + p_h_of_node;
-        auto const grad_N       = point_nodes_to_grad_N[point_node].load();
-        grad_p                  = grad_p + (grad_N * p_h_of_node);
-        auto const a_of_node    = nodes_to_a[node].load();
-        a                       = a + a_of_node;
-        auto const dp_de_h      = nodes_to_dp_de[node];
+        auto const element_node  = element_nodes[node_in_element];
+        auto const point_node    = point_nodes[node_in_element];
+        auto const node          = element_nodes_to_nodes[element_node];
+        auto const material_node = element_nodes_to_material_nodes[element_node];
+        auto const p_h_of_node   = material_nodes_to_p_h[material_node];
+        p_h                      = p_h + p_h_of_node;
+        auto const grad_N        = point_nodes_to_grad_N[point_node].load();
+        grad_p                   = grad_p + (grad_N * p_h_of_node);
+        auto const a_of_node     = nodes_to_a[node].load();
+        a                        = a + a_of_node;
+        auto const dp_de_h       = material_nodes_to_dp_de[material_node];
         dp_de += dp_de_h;
       }
       a                  = a * N;
@@ -323,194 +392,274 @@ update_e_h_W(state& s, material_index const material)
 }
 
 HPC_NOINLINE inline void
-update_p_h_dot(state& s, material_index const material)
+update_p_h_dot(input const& in, state& s)
 {
+  auto const materials = materials_where(in, in.enable_nodal_pressure);
+  if (materials == material_set::none()) return;
+  material_nodal_arrays<hpc::pressure_rate<double>> const p_h_dot_arrays(in, s.p_h_dot, materials);
+  auto const material_nodes_to_p_h_dot         = p_h_dot_arrays.begin();
   auto const nodes_to_node_elements            = s.nodes_to_node_elements.cbegin();
   auto const node_elements_to_elements         = s.node_elements_to_elements.cbegin();
   auto const node_elements_to_nodes_in_element = s.node_elements_to_nodes_in_element.cbegin();
+  auto const elements_to_element_nodes         = s.elements * s.nodes_in_element;
+  auto const element_nodes_to_material_nodes   = s.element_nodes_to_material_nodes.cbegin();
   auto const point_nodes_to_W                  = s.W.cbegin();
   auto const points_to_V                       = s.V.cbegin();
-  auto const nodes_to_p_h_dot                  = s.p_h_dot[material].begin();
   auto const elements_to_points                = s.elements * s.points_in_element;
   auto const points_to_point_nodes             = s.points * s.nodes_in_element;
   auto const elements_to_material              = s.material.cbegin();
+  auto const nodes_to_materials                = s.nodal_materials.cbegin();
+  auto const all_materials                     = in.materials;
   auto const N                                 = get_N(s);
   auto       functor                           = [=] HPC_DEVICE(node_index const node) {
-    hpc::power<double>  node_W        = 0.0;
-    hpc::volume<double> node_V        = 0.0;
-    auto const          node_elements = nodes_to_node_elements[node];
+    material_set const node_materials = nodes_to_materials[node] & materials;
+    if (node_materials == material_set::none()) return;
+    assert(node_materials.size() <= max_node_materials);
+    hpc::array<hpc::power<double>, max_node_materials>  node_W;
+    hpc::array<hpc::volume<double>, max_node_materials> node_V;
+    hpc::array<material_node_index, max_node_materials> material_nodes;
+    for (int i = 0; i < max_node_materials; ++i) {
+      node_W[i] = 0.0;
+      node_V[i] = 0.0;
+    }
+    auto const node_elements = nodes_to_node_elements[node];
     for (auto const node_element : node_elements) {
       auto const           element          = node_elements_to_elements[node_element];
       material_index const element_material = elements_to_material[element];
-      if (element_material != material) continue;
+      if (!node_materials.contains(material_set(element_material))) continue;
+      int const  i               = node_materials.rank(element_material);
       auto const node_in_element = node_elements_to_nodes_in_element[node_element];
+      auto const element_node    = elements_to_element_nodes[element][node_in_element];
+      material_nodes[i]          = element_nodes_to_material_nodes[element_node];
       for (auto const point : elements_to_points[element]) {
         auto const point_nodes = points_to_point_nodes[point];
         auto const point_node  = point_nodes[node_in_element];
         auto const W           = point_nodes_to_W[point_node];
         auto const V           = points_to_V[point];
-        node_W                 = node_W + W;
-        node_V                 = node_V + (N * V);
+        node_W[i]              = node_W[i] + W;
+        node_V[i]              = node_V[i] + (N * V);
       }
     }
-    auto const p_h_dot     = node_W / node_V;
-    nodes_to_p_h_dot[node] = p_h_dot;
+    for (auto const material : all_materials) {
+      if (!node_materials.contains(material_set(material))) continue;
+      int const  i                                           = node_materials.rank(material);
+      auto const p_h_dot                                     = node_W[i] / node_V[i];
+      material_nodes_to_p_h_dot[material][material_nodes[i]] = p_h_dot;
+    }
   };
-  hpc::for_each(hpc::device_policy(), s.node_sets[material], functor);
+  hpc::for_each(hpc::device_policy(), s.nodes, functor);
 }
 
 HPC_NOINLINE inline void
-update_e_h_dot(state& s, material_index const material)
+update_e_h_dot(input const& in, state& s)
 {
+  auto const materials = materials_where(in, in.enable_nodal_energy);
+  if (materials == material_set::none()) return;
+  material_nodal_arrays<hpc::specific_energy_rate<double>> const e_h_dot_arrays(in, s.e_h_dot, materials);
+  material_nodal_arrays<hpc::mass<double> const> const           m_arrays(in, s.material_mass, materials);
+  auto const material_nodes_to_e_h_dot         = e_h_dot_arrays.begin();
+  auto const material_nodes_to_m               = m_arrays.begin();
   auto const nodes_to_node_elements            = s.nodes_to_node_elements.cbegin();
   auto const node_elements_to_elements         = s.node_elements_to_elements.cbegin();
   auto const node_elements_to_nodes_in_element = s.node_elements_to_nodes_in_element.cbegin();
+  auto const elements_to_element_nodes         = s.elements * s.nodes_in_element;
+  auto const element_nodes_to_material_nodes   = s.element_nodes_to_material_nodes.cbegin();
   auto const point_nodes_to_W                  = s.W.cbegin();
-  auto const nodes_to_e_h_dot                  = s.e_h_dot[material].begin();
   auto const elements_to_points                = s.elements * s.points_in_element;
   auto const points_to_point_nodes             = s.points * s.nodes_in_element;
-  auto const nodes_to_m                        = s.material_mass[material].cbegin();
   auto const elements_to_material              = s.material.cbegin();
+  auto const nodes_to_materials                = s.nodal_materials.cbegin();
+  auto const all_materials                     = in.materials;
   auto       functor                           = [=] HPC_DEVICE(node_index const node) {
-    hpc::power<double> node_W        = 0.0;
-    auto const         node_elements = nodes_to_node_elements[node];
+    material_set const node_materials = nodes_to_materials[node] & materials;
+    if (node_materials == material_set::none()) return;
+    assert(node_materials.size() <= max_node_materials);
+    hpc::array<hpc::power<double>, max_node_materials>  node_W;
+    hpc::array<material_node_index, max_node_materials> material_nodes;
+    for (int i = 0; i < max_node_materials; ++i) { node_W[i] = 0.0; }
+    auto const node_elements = nodes_to_node_elements[node];
     for (auto const node_element : node_elements) {
       element_index const  element          = node_elements_to_elements[node_element];
       material_index const element_material = elements_to_material[element];
-      if (element_material != material) continue;
+      if (!node_materials.contains(material_set(element_material))) continue;
+      int const                   i               = node_materials.rank(element_material);
       node_in_element_index const node_in_element = node_elements_to_nodes_in_element[node_element];
+      auto const                  element_node    = elements_to_element_nodes[element][node_in_element];
+      material_nodes[i]                           = element_nodes_to_material_nodes[element_node];
       for (auto const point : elements_to_points[element]) {
         auto const point_nodes = points_to_point_nodes[point];
         auto const point_node  = point_nodes[node_in_element];
         auto const W           = point_nodes_to_W[point_node];
-        node_W                 = node_W + W;
+        node_W[i]              = node_W[i] + W;
       }
     }
-    auto const m           = nodes_to_m[node];
-    auto const e_h_dot     = node_W / m;
-    nodes_to_e_h_dot[node] = e_h_dot;
+    for (auto const material : all_materials) {
+      if (!node_materials.contains(material_set(material))) continue;
+      int const  i                                           = node_materials.rank(material);
+      auto const m                                           = material_nodes_to_m[material][material_nodes[i]];
+      auto const e_h_dot                                     = node_W[i] / m;
+      material_nodes_to_e_h_dot[material][material_nodes[i]] = e_h_dot;
+    }
   };
-  hpc::for_each(hpc::device_policy(), s.node_sets[material], functor);
+  hpc::for_each(hpc::device_policy(), s.nodes, functor);
 }
 
 void
 nodal_ideal_gas(input const& in, state& s, material_index const material)
 {
-  auto const nodes_to_rho = s.rho_h[material].cbegin();
-  auto const nodes_to_e   = s.e_h[material].cbegin();
-  hpc::fill(hpc::device_policy(), s.p_h[material], double(0.0));
-  auto const nodes_to_p     = s.p_h[material].begin();
-  auto const nodes_to_K     = s.K_h[material].begin();
-  auto const nodes_to_dp_de = s.dp_de_h[material].begin();
-  auto const gamma          = in.gamma[material];
-  auto       functor        = [=] HPC_DEVICE(node_index const node) {
-    auto const rho = nodes_to_rho[node];
+  auto const material_nodes_to_rho   = s.rho_h[material].cbegin();
+  auto const material_nodes_to_e     = s.e_h[material].cbegin();
+  auto const material_nodes_to_p     = s.p_h[material].begin();
+  auto const material_nodes_to_K     = s.K_h[material].begin();
+  auto const material_nodes_to_dp_de = s.dp_de_h[material].begin();
+  auto const gamma                   = in.gamma[material];
+  auto       functor                 = [=] HPC_DEVICE(material_node_index const material_node) {
+    auto const rho = material_nodes_to_rho[material_node];
     assert(rho > 0.0);
-    auto const e = nodes_to_e[node];
+    auto const e = material_nodes_to_e[material_node];
     assert(e > 0.0);
     auto const p = (gamma - 1.0) * (rho * e);
     assert(p > 0.0);
-    nodes_to_p[node]     = p;
-    auto const K         = gamma * p;
-    nodes_to_K[node]     = K;
-    auto const dp_de     = (gamma - 1.0) * rho;
-    nodes_to_dp_de[node] = dp_de;
+    material_nodes_to_p[material_node]     = p;
+    auto const K                           = gamma * p;
+    material_nodes_to_K[material_node]     = K;
+    auto const dp_de                       = (gamma - 1.0) * rho;
+    material_nodes_to_dp_de[material_node] = dp_de;
   };
-  hpc::for_each(hpc::device_policy(), s.node_sets[material], functor);
+  hpc::for_each(hpc::device_policy(), hpc::counting_range<material_node_index>(s.p_h[material].size()), functor);
 }
 
 void
-update_nodal_density(state& s, material_index const material)
+update_nodal_density(input const& in, state& s)
 {
-  auto const nodes_to_node_elements    = s.nodes_to_node_elements.cbegin();
-  auto const node_elements_to_elements = s.node_elements_to_elements.cbegin();
-  auto const points_to_V               = s.V.cbegin();
-  auto const nodes_to_m                = s.material_mass[material].cbegin();
-  hpc::fill(hpc::device_policy(), s.rho_h[material], double(0.0));
-  auto const nodes_to_rho_h       = s.rho_h[material].begin();
-  auto const N                    = get_N(s);
-  auto const elements_to_points   = s.elements * s.points_in_element;
-  auto const elements_to_material = s.material.cbegin();
-  auto       functor              = [=] HPC_DEVICE(node_index const node) {
-    hpc::volume<double> node_V(0.0);
-    auto const          node_elements = nodes_to_node_elements[node];
+  auto const materials = materials_where(in, in.enable_nodal_energy);
+  if (materials == material_set::none()) return;
+  material_nodal_arrays<hpc::mass<double> const> const m_arrays(in, s.material_mass, materials);
+  material_nodal_arrays<hpc::density<double>> const    rho_h_arrays(in, s.rho_h, materials);
+  auto const material_nodes_to_m               = m_arrays.begin();
+  auto const material_nodes_to_rho_h           = rho_h_arrays.begin();
+  auto const nodes_to_node_elements            = s.nodes_to_node_elements.cbegin();
+  auto const node_elements_to_elements         = s.node_elements_to_elements.cbegin();
+  auto const node_elements_to_nodes_in_element = s.node_elements_to_nodes_in_element.cbegin();
+  auto const elements_to_element_nodes         = s.elements * s.nodes_in_element;
+  auto const element_nodes_to_material_nodes   = s.element_nodes_to_material_nodes.cbegin();
+  auto const points_to_V                       = s.V.cbegin();
+  auto const N                                 = get_N(s);
+  auto const elements_to_points                = s.elements * s.points_in_element;
+  auto const elements_to_material              = s.material.cbegin();
+  auto const nodes_to_materials                = s.nodal_materials.cbegin();
+  auto const all_materials                     = in.materials;
+  auto       functor                           = [=] HPC_DEVICE(node_index const node) {
+    material_set const node_materials = nodes_to_materials[node] & materials;
+    if (node_materials == material_set::none()) return;
+    assert(node_materials.size() <= max_node_materials);
+    hpc::array<hpc::volume<double>, max_node_materials> node_V;
+    hpc::array<material_node_index, max_node_materials> material_nodes;
+    for (int i = 0; i < max_node_materials; ++i) { node_V[i] = 0.0; }
+    auto const node_elements = nodes_to_node_elements[node];
     for (auto const node_element : node_elements) {
       element_index const  element          = node_elements_to_elements[node_element];
       material_index const element_material = elements_to_material[element];
-      if (element_material != material) continue;
+      if (!node_materials.contains(material_set(element_material))) continue;
+      int const                   i               = node_materials.rank(element_material);
+      node_in_element_index const node_in_element = node_elements_to_nodes_in_element[node_element];
+      auto const                  element_node    = elements_to_element_nodes[element][node_in_element];
+      material_nodes[i]                           = element_nodes_to_material_nodes[element_node];
       for (auto const point : elements_to_points[element]) {
         auto const V = points_to_V[point];
-        node_V       = node_V + (N * V);
+        node_V[i]    = node_V[i] + (N * V);
       }
     }
-    auto const m         = nodes_to_m[node];
-    nodes_to_rho_h[node] = m / node_V;
+    for (auto const material : all_materials) {
+      if (!node_materials.contains(material_set(material))) continue;
+      int const  i                                         = node_materials.rank(material);
+      auto const m                                         = material_nodes_to_m[material][material_nodes[i]];
+      material_nodes_to_rho_h[material][material_nodes[i]] = m / node_V[i];
+    }
   };
-  hpc::for_each(hpc::device_policy(), s.node_sets[material], functor);
+  hpc::for_each(hpc::device_policy(), s.nodes, functor);
 }
 
 void
-interpolate_K(state& s, material_index const material)
+interpolate_K(input const& in, state& s)
 {
-  auto const elements_to_element_nodes = s.elements * s.nodes_in_element;
-  auto const elements_to_points        = s.elements * s.points_in_element;
-  auto const element_nodes_to_nodes    = s.elements_to_nodes.cbegin();
-  auto const nodes_to_K_h              = s.K_h[material].cbegin();
-  auto const points_to_K               = s.K.begin();
-  auto       functor                   = [=] HPC_DEVICE(element_index const element) {
+  auto const materials = materials_where(in, in.enable_nodal_energy);
+  if (materials == material_set::none()) return;
+  material_nodal_arrays<hpc::pressure<double> const> const K_h_arrays(in, s.K_h, materials);
+  auto const material_nodes_to_K_h           = K_h_arrays.begin();
+  auto const elements_to_element_nodes       = s.elements * s.nodes_in_element;
+  auto const elements_to_points              = s.elements * s.points_in_element;
+  auto const element_nodes_to_material_nodes = s.element_nodes_to_material_nodes.cbegin();
+  auto const elements_to_material            = s.material.cbegin();
+  auto const points_to_K                     = s.K.begin();
+  auto       functor                         = [=] HPC_DEVICE(element_index const element) {
+    material_index const material = elements_to_material[element];
+    if (!materials.contains(material_set(material))) return;
     auto const element_nodes = elements_to_element_nodes[element];
     for (auto const point : elements_to_points[element]) {
       hpc::pressure<double> K = 0.0;
       for (auto const element_node : element_nodes) {
-        node_index const node = element_nodes_to_nodes[element_node];
-        auto const       K_h  = nodes_to_K_h[node];
-        K                     = hpc::max(K, K_h);
+        auto const material_node = element_nodes_to_material_nodes[element_node];
+        auto const K_h           = material_nodes_to_K_h[material][material_node];
+        K                        = hpc::max(K, K_h);
       }
       points_to_K[point] = K;
     }
   };
-  hpc::for_each(hpc::device_policy(), s.element_sets[material], functor);
+  hpc::for_each(hpc::device_policy(), s.elements, functor);
 }
 
 void
-interpolate_rho(state& s, material_index const material)
+interpolate_rho(input const& in, state& s)
 {
-  auto const elements_to_element_nodes = s.elements * s.nodes_in_element;
-  auto const element_nodes_to_nodes    = s.elements_to_nodes.cbegin();
-  auto const elements_to_points        = s.elements * s.points_in_element;
-  auto const nodes_to_rho_h            = s.rho_h[material].cbegin();
-  auto const points_to_rho             = s.rho.begin();
-  auto const N                         = get_N(s);
-  auto       functor                   = [=] HPC_DEVICE(element_index const element) {
+  auto const materials = materials_where(in, in.enable_nodal_energy);
+  if (materials == material_set::none()) return;
+  material_nodal_arrays<hpc::density<double> const> const rho_h_arrays(in, s.rho_h, materials);
+  auto const material_nodes_to_rho_h         = rho_h_arrays.begin();
+  auto const elements_to_element_nodes       = s.elements * s.nodes_in_element;
+  auto const element_nodes_to_material_nodes = s.element_nodes_to_material_nodes.cbegin();
+  auto const elements_to_points              = s.elements * s.points_in_element;
+  auto const elements_to_material            = s.material.cbegin();
+  auto const points_to_rho                   = s.rho.begin();
+  auto const N                               = get_N(s);
+  auto       functor                         = [=] HPC_DEVICE(element_index const element) {
+    material_index const material = elements_to_material[element];
+    if (!materials.contains(material_set(material))) return;
     auto const element_nodes = elements_to_element_nodes[element];
     for (auto const point : elements_to_points[element]) {
       hpc::density<double> rho = 0.0;
       for (auto const element_node : element_nodes) {
-        auto const node  = element_nodes_to_nodes[element_node];
-        auto const rho_h = nodes_to_rho_h[node];
-        rho              = rho + rho_h;
+        auto const material_node = element_nodes_to_material_nodes[element_node];
+        auto const rho_h         = material_nodes_to_rho_h[material][material_node];
+        rho                      = rho + rho_h;
       }
       rho                  = rho * N;
       points_to_rho[point] = rho;
     }
   };
-  hpc::for_each(hpc::device_policy(), s.element_sets[material], functor);
+  hpc::for_each(hpc::device_policy(), s.elements, functor);
 }
 
 void
-update_p_h_dot_from_a(input const& in, state& s, material_index const material)
+update_p_h_dot_from_a(input const& in, state& s)
 {
-  update_v_prime(in, s, material);
-  update_p_h_W(s, material);
-  update_p_h_dot(s, material);
+  for (auto const material : in.materials) {
+    if (!in.enable_nodal_pressure[material]) continue;
+    update_v_prime(in, s, material);
+    update_p_h_W(s, material);
+  }
+  update_p_h_dot(in, s);
 }
 
 void
-update_e_h_dot_from_a(input const& in, state& s, material_index const material)
+update_e_h_dot_from_a(input const& in, state& s)
 {
-  update_q(in, s, material);
-  update_e_h_W(s, material);
-  update_e_h_dot(s, material);
+  for (auto const material : in.materials) {
+    if (!in.enable_nodal_energy[material]) continue;
+    update_q(in, s, material);
+    update_e_h_W(s, material);
+  }
+  update_e_h_dot(in, s);
 }
 
 }  // namespace lgr
@@ -13,34 +13,34 @@ void
 update_sigma_with_p_h(state& s, material_index const material);
 void
 update_sigma_with_p_h_p_prime(
-    input const&                                                 in,
-    state&                                                       s,
-    material_index const                                         material,
-    hpc::time<double> const                                      dt,
-    hpc::device_vector<hpc::pressure<double>, node_index> const& old_p_h_vector);
+    input const&                                                          in,
+    state&                                                                s,
+    material_index const                                                  material,
+    hpc::time<double> const                                               dt,
+    hpc::device_vector<hpc::pressure<double>, material_node_index> const& old_p_h_vector);
 void
 update_p_h(
-    state&                                                       s,
-    hpc::time<double> const                                      dt,
-    material_index const                                         material,
-    hpc::device_vector<hpc::pressure<double>, node_index> const& old_p_h_vector);
+    state&                                                                s,
+    hpc::time<double> const                                               dt,
+    material_index const                                                  material,
+    hpc::device_vector<hpc::pressure<double>, material_node_index> const& old_p_h_vector);
 void
 update_e_h(
-    state&                                                              s,
-    hpc::time<double> const                                             dt,
-    material_index const                                                material,
-    hpc::device_vector<hpc::specific_energy<double>, node_index> const& old_e_h_vector);
+    state&                                                                       s,
+    hpc::time<double> const                                                      dt,
+    material_index const                                                         material,
+    hpc::device_vector<hpc::specific_energy<double>, material_node_index> const& old_e_h_vector);
 void
 nodal_ideal_gas(input const& in, state& s, material_index const);
 void
-update_nodal_density(state& s, material_index const);
+update_nodal_density(input const& in, state& s);
 void
-interpolate_K(state& s, material_index const);
+interpolate_K(input const& in, state& s);
 void
-interpolate_rho(state& s, material_index const);
+interpolate_rho(input const& in, state& s);
 void
-update_p_h_dot_from_a(input const& in, state& s, material_index const material);
+update_p_h_dot_from_a(input const& in, state& s);
 void
-update_e_h_dot_from_a(input const& in, state& s, material_index const material);
+update_e_h_dot_from_a(input const& in, state& s);
 
 }  // namespace lgr
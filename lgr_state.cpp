@@ -38,7 +38,6 @@ resize_state(input const& in, state& s)
     s.ep_dot.resize(s.points.size());
   }
   s.material_mass.resize(in.materials.size());
-  for (auto& mm : s.material_mass) mm.resize(s.nodes.size());
   s.mass.resize(s.nodes.size());
   s.a.resize(s.nodes.size());
   s.h_min.resize(s.elements.size());
@@ -55,21 +54,13 @@ resize_state(input const& in, state& s)
   s.temp.resize(in.materials.size());
   for (auto const material : in.materials) {
     if (in.enable_nodal_pressure[material]) {
-      s.p_h[material].resize(s.nodes.size());
-      s.p_h_dot[material].resize(s.nodes.size());
       s.v_prime.resize(s.points.size());
       s.W.resize(s.points.size() * s.nodes_in_element.size());
     }
     if (in.enable_p_prime[material]) { s.p_prime.resize(s.points.size()); }
     if (in.enable_nodal_energy[material]) {
-      s.p_h[material].resize(s.nodes.size());
-      s.e_h[material].resize(s.nodes.size());
-      s.e_h_dot[material].resize(s.nodes.size());
-      s.rho_h[material].resize(s.nodes.size());
-      s.K_h[material].resize(s.nodes.size());
       s.q.resize(s.points.size());
       s.W.resize(s.points.size() * s.nodes_in_element.size());
-      s.dp_de_h[material].resize(s.nodes.size());
     }
   }
   s.material.resize(s.elements.size());
@@ -79,4 +70,25 @@ resize_state(input const& in, state& s)
   }
 }
 
+void
+resize_material_nodal_state(input const& in, state& s)
+{
+  for (auto const material : in.materials) {
+    material_node_index const material_nodes(s.node_sets[material].size());
+    s.material_mass[material].resize(material_nodes);
+    if (in.enable_nodal_pressure[material]) {
+      s.p_h[material].resize(material_nodes);
+      s.p_h_dot[material].resize(material_nodes);
+    }
+    if (in.enable_nodal_energy[material]) {
+      s.p_h[material].resize(material_nodes);
+      s.e_h[material].resize(material_nodes);
+      s.e_h_dot[material].resize(material_nodes);
+      s.rho_h[material].resize(material_nodes);
+      s.K_h[material].resize(material_nodes);
+      s.dp_de_h[material].resize(material_nodes);
+    }
+  }
+}
+
 }  // namespace lgr
@@ -5,9 +5,11 @@
 #include <hpc_range.hpp>
 #include <hpc_range_sum.hpp>
 #include <hpc_symmetric3x3.hpp>
+#include <lgr_entity_sets.hpp>
 #include <lgr_material_set.hpp>
 #include <lgr_mesh_indices.hpp>
 #include <map>
+#include <tuple>
 
 namespace lgr {
 
@@ -18,6 +20,7 @@ class state
 {
  public:
   int                                                             n{0};
+  int                                                             adapt_epoch{0};  // bumped whenever adapt() changes the mesh
   hpc::time<double>                                               time{0.0};
   hpc::counting_range<element_index>                              elements{element_index(0)};
   hpc::counting_range<node_in_element_index>                      nodes_in_element{node_in_element_index(0)};
@@ -46,17 +49,18 @@ class state
   hpc::device_array_vector<hpc::heat_flux<double>, point_index> q;            // element-center heat flux
   hpc::device_vector<hpc::power<double>, point_node_index> W;  // work done, per element-node pair (contribution to a
                                                                // node's work by an element)
+  // Per-material nodal fields are stored only over the node set of their material
   hpc::host_vector<
-      hpc::device_vector<hpc::pressure_rate<double>, node_index>,
+      hpc::device_vector<hpc::pressure_rate<double>, material_node_index>,
       material_index>
       p_h_dot;  // time derivative of stabilized nodal pressure
   hpc::host_vector<
-      hpc::device_vector<hpc::pressure<double>, node_index>,
+      hpc::device_vector<hpc::pressure<double>, material_node_index>,
       material_index>
                                                          p_h;  // stabilized nodal pressure
   hpc::device_vector<hpc::pressure<double>, point_index> K;    // (tangent/effective) bulk modulus
   hpc::host_vector<
-      hpc::device_vector<hpc::pressure<double>, node_index>,
+      hpc::device_vector<hpc::pressure<double>, material_node_index>,
       material_index>
                                                          K_h;  // (tangent/effective) bulk modulus at nodes
   hpc::device_vector<hpc::pressure<double>, point_index> G;    // (tangent/effective) shear modulus
@@ -71,7 +75,7 @@ class state
                                                     rho_e_dot;  // time derivative of internal energy density
   hpc::device_vector<hpc::mass<double>, node_index> mass;       // total lumped nodal mass
   hpc::host_vector<
-      hpc::device_vector<hpc::mass<double>, node_index>,
+      hpc::device_vector<hpc::mass<double>, material_node_index>,
       material_index>
                                                                   material_mass;  // per-material lumped nodal mass
   hpc::device_array_vector<hpc::acceleration<double>, node_index> a;              // nodal acceleration
@@ -82,24 +86,28 @@ class state
   hpc::device_vector<hpc::kinematic_viscosity<double>, point_index> nu_art;  // artificial kinematic viscosity scalar
   hpc::device_vector<hpc::time<double>, point_index>                element_dt;  // stable time step of each element
   hpc::host_vector<
-      hpc::device_vector<hpc::specific_energy<double>, node_index>,
+      hpc::device_vector<hpc::specific_energy<double>, material_node_index>,
       material_index>
       e_h;  // nodal specific internal energy
   hpc::host_vector<
-      hpc::device_vector<hpc::specific_energy_rate<double>, node_index>,
+      hpc::device_vector<hpc::specific_energy_rate<double>, material_node_index>,
       material_index>
                                    e_h_dot;  // time derivative of nodal specific internal energy
-  hpc::host_vector<hpc::device_vector<hpc::density<double>, node_index>,
+  hpc::host_vector<hpc::device_vector<hpc::density<double>, material_node_index>,
                    material_index> rho_h;  // nodal density
-  hpc::host_vector<hpc::device_vector<dp_de_t, node_index>, material_index>
+  hpc::host_vector<hpc::device_vector<dp_de_t, material_node_index>, material_index>
       dp_de_h;  // nodal derivative of pressure with respect to energy, at
                 // constant density
   hpc::device_vector<material_index, element_index>                        material;         // element material
   hpc::device_vector<material_set, node_index>                             nodal_materials;  // nodal material set
   hpc::device_vector<hpc::adimensional<double>, element_index>             quality;          // inverse element quality
   hpc::device_vector<hpc::length<double>, node_index>                      h_adapt;          // desired edge length
-  hpc::host_vector<hpc::device_vector<node_index, int>, material_index>    node_sets;
-  hpc::host_vector<hpc::device_vector<element_index, int>, material_index> element_sets;
+  entity_sets<node_index>                                                  node_sets;             // nodes of each material and boundary
+  hpc::device_vector<material_node_index, element_node_index>
+      element_nodes_to_material_nodes;  // position of each element node in the node set of its element's material
+  entity_sets<element_index>                                               element_sets;          // elements of each material
+  entity_sets<node_index>                                                  adapted_node_sets;     // nodes adapt() touched, per material
+  entity_sets<element_index>                                               adapted_element_sets;  // elements adapt() created, per material
   hpc::time<double>                                                        next_file_output_time;
   hpc::time<double>                                                        dt     = 0.0;
   hpc::time<double>                                                        dt_old = 0.0;
@@ -122,6 +130,10 @@ class state
   hpc::device_array_vector<hpc::acceleration<double>, point_index>
                                                        b;  // acceleration corresponding to body force, mostly for weight
   hpc::device_vector<hpc::length<double>, point_index> h_otm;  // characteristic length, used for max-ent functions
+  hpc::device_array_vector<hpc::basis_gradient<double>, point_index>
+      mu;  // max-ent Lagrange multipliers of the last solve, its next initial guess
+  hpc::device_array_vector<hpc::position<double>, point_node_index>
+      maxent_r;  // point-to-node vectors N and grad_N were last solved for
   hpc::device_vector<point_index, point_index>         nearest_point_neighbor;  // nearest point neighbor
   hpc::device_vector<hpc::length<double>, point_index>
                                              nearest_point_neighbor_dist;  // distance to nearest point neighbor
@@ -134,6 +146,7 @@ class state
   hpc::counting_range<material_index> boundaries{material_index(0)};  // Copied from input structure
   hpc::adimensional<double>           maxent_desired_tolerance{1.0e-10};
   hpc::adimensional<double>           maxent_acceptable_tolerance{1.0e-05};
+  hpc::adimensional<double>           maxent_update_tolerance{0.0};  // support motion over h_otm that re-solves N
   hpc::strain_rate_rate<double>       contact_penalty_coeff{0.0};
   bool                                use_displacement_contact{false};
   bool                                use_penalty_contact{false};
@@ -156,5 +169,119 @@ class input;
 
 void
 resize_state(input const& in, state& s);
+// sizes the per-material nodal fields to the current node sets
+void
+resize_material_nodal_state(input const& in, state& s);
+
+// what an entity created by adaptivity receives; surviving entities keep their own value
+enum class transfer_rule
+{
+  COPY,         // the value of the old entity it was created from
+  AVERAGE,      // the mean of the two old entities it was created between
+  LIE_AVERAGE,  // as AVERAGE, but of the rotation vectors and stretch logarithms
+  DISTRIBUTE,   // a third of both old entities, which keep two thirds each
+};
+
+template <transfer_rule Rule, class Range>
+class transferable_field
+{
+ public:
+  using range_type                    = Range;
+  static constexpr transfer_rule rule = Rule;
+  Range*                         data;
+};
+
+template <transfer_rule Rule, class Range>
+inline transferable_field<Rule, Range>
+transferable(Range& data)
+{
+  return transferable_field<Rule, Range>{&data};
+}
+
+/* The fields adapt() and otm_adapt() carry over to the new entities, by what
+   they are stored on. Fields left empty are not in use and are skipped. A
+   state field that has to survive adaptivity must be registered here. */
+
+inline auto
+adapt_element_fields(state& s)
+{
+  return std::make_tuple(
+      transferable<transfer_rule::COPY>(s.material),
+      transferable<transfer_rule::COPY>(s.h_min),
+      transferable<transfer_rule::COPY>(s.h_art),
+      transferable<transfer_rule::COPY>(s.quality));
+}
+
+inline auto
+adapt_point_fields(state& s)
+{
+  return std::make_tuple(
+      transferable<transfer_rule::COPY>(s.rho),
+      transferable<transfer_rule::COPY>(s.e),
+      transferable<transfer_rule::COPY>(s.F_total),
+      transferable<transfer_rule::COPY>(s.Fp_total),
+      transferable<transfer_rule::COPY>(s.ep),
+      transferable<transfer_rule::COPY>(s.ep_dot),
+      transferable<transfer_rule::COPY>(s.V),
+      transferable<transfer_rule::COPY>(s.symm_grad_v),
+      transferable<transfer_rule::COPY>(s.sigma),
+      transferable<transfer_rule::COPY>(s.p),
+      transferable<transfer_rule::COPY>(s.K),
+      transferable<transfer_rule::COPY>(s.G),
+      transferable<transfer_rule::COPY>(s.c),
+      transferable<transfer_rule::COPY>(s.nu_art),
+      transferable<transfer_rule::COPY>(s.element_dt));
+}
+
+inline auto
+adapt_point_node_fields(state& s)
+{
+  return std::make_tuple(transferable<transfer_rule::COPY>(s.grad_N));
+}
+
+inline auto
+adapt_node_fields(state& s)
+{
+  return std::make_tuple(
+      transferable<transfer_rule::AVERAGE>(s.x),
+      transferable<transfer_rule::AVERAGE>(s.v),
+      transferable<transfer_rule::AVERAGE>(s.h_adapt),
+      transferable<transfer_rule::AVERAGE>(s.mass));
+}
+
+inline auto
+adapt_material_node_fields(state& s, material_index const material)
+{
+  return std::make_tuple(
+      transferable<transfer_rule::AVERAGE>(s.material_mass[material]),
+      transferable<transfer_rule::COPY>(s.e_h[material]),
+      transferable<transfer_rule::AVERAGE>(s.p_h[material]));
+}
+
+inline auto
+otm_adapt_node_fields(state& s)
+{
+  return std::make_tuple(
+      transferable<transfer_rule::AVERAGE>(s.x),
+      transferable<transfer_rule::AVERAGE>(s.u),
+      transferable<transfer_rule::AVERAGE>(s.v));
+}
+
+inline auto
+otm_adapt_point_fields(state& s)
+{
+  return std::make_tuple(
+      transferable<transfer_rule::AVERAGE>(s.xp),
+      transferable<transfer_rule::AVERAGE>(s.h_otm),
+      transferable<transfer_rule::AVERAGE>(s.mu),
+      transferable<transfer_rule::AVERAGE>(s.K),
+      transferable<transfer_rule::AVERAGE>(s.G),
+      transferable<transfer_rule::AVERAGE>(s.rho),
+      transferable<transfer_rule::AVERAGE>(s.ep),
+      transferable<transfer_rule::AVERAGE>(s.b),
+      transferable<transfer_rule::LIE_AVERAGE>(s.F_total),
+      transferable<transfer_rule::LIE_AVERAGE>(s.Fp_total),
+      transferable<transfer_rule::DISTRIBUTE>(s.V));
+}
 
 }  // namespace lgr
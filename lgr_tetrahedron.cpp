@@ -5,8 +5,9 @@
 
 namespace lgr {
 
-void
-initialize_tetrahedron_V(state& s)
+template <class Elements>
+HPC_NOINLINE void
+initialize_tetrahedron_V(state& s, Elements const& elements)
 {
   auto const element_nodes_to_nodes    = s.elements_to_nodes.cbegin();
   auto const nodes_to_x                = s.x.cbegin();
@@ -26,11 +27,24 @@ initialize_tetrahedron_V(state& s)
     assert(volume > 0.0);
     points_to_V[elements_to_points[element][fp]] = volume;
   };
-  hpc::for_each(hpc::device_policy(), s.elements, functor);
+  hpc::for_each(hpc::device_policy(), elements, functor);
 }
 
 void
-initialize_tetrahedron_grad_N(state& s)
+initialize_tetrahedron_V(state& s)
+{
+  initialize_tetrahedron_V(s, s.elements);
+}
+
+void
+initialize_tetrahedron_V(state& s, element_list const elements)
+{
+  initialize_tetrahedron_V<element_list>(s, elements);
+}
+
+template <class Elements>
+HPC_NOINLINE void
+initialize_tetrahedron_grad_N(state& s, Elements const& elements)
 {
   auto const element_nodes_to_nodes    = s.elements_to_nodes.cbegin();
   auto const nodes_to_x                = s.x.cbegin();
@@ -54,11 +68,24 @@ initialize_tetrahedron_grad_N(state& s)
     auto const grad_N = tetrahedron_basis_gradients(x, volume);
     for (int i = 0; i < 4; ++i) { point_nodes_to_grad_N[point_nodes[l_t(i)]] = grad_N[i]; }
   };
-  hpc::for_each(hpc::device_policy(), s.elements, functor);
+  hpc::for_each(hpc::device_policy(), elements, functor);
 }
 
 void
-update_tetrahedron_h_min_inball(input const&, state& s)
+initialize_tetrahedron_grad_N(state& s)
+{
+  initialize_tetrahedron_grad_N(s, s.elements);
+}
+
+void
+initialize_tetrahedron_grad_N(state& s, element_list const elements)
+{
+  initialize_tetrahedron_grad_N<element_list>(s, elements);
+}
+
+template <class Elements>
+HPC_NOINLINE void
+update_tetrahedron_h_min_inball(input const&, state& s, Elements const& elements)
 {
   auto const point_nodes_to_grad_N = s.grad_N.cbegin();
   auto const elements_to_h_min     = s.h_min.begin();
@@ -89,11 +116,24 @@ update_tetrahedron_h_min_inball(input const&, state& s)
     auto const radius          = 1.0 / surface_area_over_thrice_volume;
     elements_to_h_min[element] = 2.0 * radius;
   };
-  hpc::for_each(hpc::device_policy(), s.elements, functor);
+  hpc::for_each(hpc::device_policy(), elements, functor);
 }
 
 void
-update_tetrahedron_h_art(state& s)
+update_tetrahedron_h_min_inball(input const& in, state& s)
+{
+  update_tetrahedron_h_min_inball(in, s, s.elements);
+}
+
+void
+update_tetrahedron_h_min_inball(input const& in, state& s, element_list const elements)
+{
+  update_tetrahedron_h_min_inball<element_list>(in, s, elements);
+}
+
+template <class Elements>
+HPC_NOINLINE void
+update_tetrahedron_h_art(state& s, Elements const& elements)
 {
   double const C_geom             = std::cbrt(12.0 / std::sqrt(2.0));
   auto const   points_to_V        = s.V.cbegin();
@@ -105,7 +145,19 @@ update_tetrahedron_h_art(state& s)
     auto const h_art           = C_geom * cbrt(volume);
     elements_to_h_art[element] = h_art;
   };
-  hpc::for_each(hpc::device_policy(), s.elements, functor);
+  hpc::for_each(hpc::device_policy(), elements, functor);
+}
+
+void
+update_tetrahedron_h_art(state& s)
+{
+  update_tetrahedron_h_art(s, s.elements);
+}
+
+void
+update_tetrahedron_h_art(state& s, element_list const elements)
+{
+  update_tetrahedron_h_art<element_list>(s, elements);
 }
 
 }  // namespace lgr
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <lgr_entity_sets.hpp>
+
 namespace lgr {
 
 class state;
@@ -8,10 +10,18 @@ class input;
 void
 initialize_triangle_V(state& s);
 void
+initialize_triangle_V(state& s, element_list elements);
+void
 initialize_triangle_grad_N(state& s);
 void
+initialize_triangle_grad_N(state& s, element_list elements);
+void
 update_triangle_h_min_inball(input const&, state& s);
 void
+update_triangle_h_min_inball(input const&, state& s, element_list elements);
+void
 update_triangle_h_art(state& s);
+void
+update_triangle_h_art(state& s, element_list elements);
 
 }  // namespace lgr
@@ -29,8 +29,8 @@ class vector4
   {
     return raw[i];
   }
-  HPC_ALWAYS_INLINE HPC_HOST_DEVICE scalar_type&
-                                    operator()(int const i) noexcept
+  HPC_ALWAYS_INLINE HPC_HOST_DEVICE constexpr scalar_type&
+                                              operator()(int const i) noexcept
   {
     return raw[i];
   }
@@ -1,4 +1,5 @@
 #include <cassert>
+#include <cstdint>
 #include <fstream>
 #include <hpc_algorithm.hpp>
 #include <hpc_execution.hpp>
@@ -11,10 +12,24 @@
 #include <lgr_state.hpp>
 #include <lgr_vtk.hpp>
 #include <lgr_vtk_util.hpp>
+#include <lgr_xdmf.hpp>
 #include <sstream>
+#include <utility>
 
 namespace lgr {
 
+static std::uint8_t
+vtk_cell_type(input const& in)
+{
+  switch (in.element) {
+    case BAR: return 3;
+    case TRIANGLE: return 5;
+    case TETRAHEDRON: return 10;
+    case COMPOSITE_TETRAHEDRON: return 24;
+  }
+  return 0;
+}
+
 static void
 write_vtk_cells(std::ostream& stream, input const& in, captured_state const& s)
 {
@@ -30,13 +45,7 @@ write_vtk_cells(std::ostream& stream, input const& in, captured_state const& s)
     stream << "\n";
   }
   stream << "CELL_TYPES " << s.elements.size() << "\n";
-  int cell_type = -1;
-  switch (in.element) {
-    case BAR: cell_type = 3; break;
-    case TRIANGLE: cell_type = 5; break;
-    case TETRAHEDRON: cell_type = 10; break;
-    case COMPOSITE_TETRAHEDRON: cell_type = 24; break;
-  }
+  int const cell_type = vtk_cell_type(in);
   for (element_index i(0); i < s.elements.size(); ++i) { stream << cell_type << "\n"; }
 }
 
@@ -95,9 +104,34 @@ write_vtk_cell_data(std::ostream& stream, captured_state const& s)
   stream << "CELL_DATA " << s.elements.size() << "\n";
 }
 
+// per-material nodal fields are stored over the node set of their material; output shows zero elsewhere
+template <class Quantity>
+static void
+capture_material_nodal(
+    state const&                                             s,
+    material_index const                                     material,
+    hpc::device_vector<Quantity, material_node_index> const& material_vector,
+    hpc::pinned_vector<Quantity, node_index>&                captured_vector)
+{
+  hpc::device_vector<Quantity, node_index> node_vector(s.nodes.size());
+  hpc::fill(hpc::device_policy(), node_vector, double(0.0));
+  auto const material_nodes_to_nodes = s.node_sets[material].begin();
+  auto const material_nodes_to_value = material_vector.cbegin();
+  auto const nodes_to_value          = node_vector.begin();
+  auto       functor                 = [=] HPC_DEVICE(material_node_index const material_node) {
+    node_index const node = material_nodes_to_nodes[hpc::weaken(material_node)];
+    nodes_to_value[node]  = material_nodes_to_value[material_node];
+  };
+  hpc::for_each(hpc::device_policy(), hpc::counting_range<material_node_index>(material_vector.size()), functor);
+  captured_vector.resize(node_vector.size());
+  hpc::copy(node_vector, captured_vector);
+}
+
 void
 file_writer::capture(input const& in, state const& s)
 {
+  captured.time              = s.time;
+  captured.adapt_epoch       = s.adapt_epoch;
   captured.nodes             = s.nodes;
   captured.elements          = s.elements;
   captured.nodes_in_element  = s.nodes_in_element;
@@ -113,18 +147,11 @@ file_writer::capture(input const& in, state const& s)
   captured.rho_h.resize(s.rho_h.size());
   for (material_index const material : in.materials) {
     if (in.enable_nodal_pressure[material] || in.enable_nodal_energy[material]) {
-      captured.p_h[material].resize(s.p_h[material].size());
-      hpc::copy(s.p_h[material], captured.p_h[material]);
+      capture_material_nodal(s, material, s.p_h[material], captured.p_h[material]);
     }
     if (in.enable_nodal_energy[material]) {
-      {
-        captured.e_h[material].resize(s.e_h[material].size());
-        hpc::copy(s.e_h[material], captured.e_h[material]);
-      }
-      {
-        captured.rho_h[material].resize(s.rho_h[material].size());
-        hpc::copy(s.rho_h[material], captured.rho_h[material]);
-      }
+      capture_material_nodal(s, material, s.e_h[material], captured.e_h[material]);
+      capture_material_nodal(s, material, s.rho_h[material], captured.rho_h[material]);
     }
   }
   if (in.enable_adapt) {
@@ -162,8 +189,130 @@ file_writer::capture(input const& in, state const& s)
   hpc::copy(s.material, captured.material);
 }
 
-void
-file_writer::write(input const& in, int const file_output_index)
+template <class File, class T>
+static void
+gather_vtu_point_data(
+    File&                                             file,
+    std::string const&                                name,
+    int const                                         components,
+    T const*                                          data,
+    hpc::counting_range<element_index> const         elements,
+    hpc::counting_range<point_in_element_index> const points_in_element)
+{
+  using raw_type                = typename vtu_raw_type<T>::type;
+  auto const elements_to_points = elements * points_in_element;
+  auto const raw_data           = reinterpret_cast<raw_type const*>(data);
+  for (auto const qp : points_in_element) {
+    std::vector<raw_type> values(std::size_t(elements.size() * components));
+    for (auto const e : elements) {
+      auto const p = elements_to_points[e][qp];
+      for (int c = 0; c < components; ++c) {
+        values[std::size_t(hpc::weaken(e) * components + c)] = raw_data[hpc::weaken(p) * components + c];
+      }
+    }
+    file.add_cell_data(name + "_" + std::to_string(hpc::weaken(qp)), components, std::move(values));
+  }
+}
+
+// integration point data is written directly when there is one point per element,
+// and as one gathered array per point otherwise, like the ASCII writer
+template <class File, class Quantity>
+static void
+add_vtu_point_data(
+    File&                                             file,
+    std::string const&                                name,
+    hpc::counting_range<element_index> const         elements,
+    hpc::counting_range<point_in_element_index> const points_in_element,
+    hpc::pinned_vector<Quantity, point_index> const&  vec)
+{
+  if (points_in_element.size() == 1) {
+    file.add_cell_data(name, vec);
+    return;
+  }
+  gather_vtu_point_data(file, name, 1, vec.data(), elements, points_in_element);
+}
+
+template <class File, class T>
+static void
+add_vtu_point_data(
+    File&                                             file,
+    std::string const&                                name,
+    hpc::counting_range<element_index> const         elements,
+    hpc::counting_range<point_in_element_index> const points_in_element,
+    hpc::pinned_array_vector<T, point_index> const&   vec)
+{
+  if (points_in_element.size() == 1) {
+    file.add_cell_data(name, vec);
+    return;
+  }
+  gather_vtu_point_data(file, name, int(vec.array_size()), vec.data(), elements, points_in_element);
+}
+
+// the arrays of one output frame, for any writer with the vtu_file interface
+template <class File>
+static void
+describe_binary_output(File& file, input const& in, captured_state const& captured)
+{
+  file.set_points(captured.x);
+  file.set_cells(captured.element_nodes_to_nodes, int(captured.nodes_in_element.size()), vtk_cell_type(in));
+  // POINTS
+  file.add_point_data("position", captured.x);
+  file.add_point_data("velocity", captured.v);
+  for (material_index const material : in.materials) {
+    auto const suffix = "_" + std::to_string(hpc::weaken(material));
+    if (in.enable_nodal_pressure[material] || in.enable_nodal_energy[material]) {
+      file.add_point_data("nodal_pressure" + suffix, captured.p_h[material]);
+    }
+    if (in.enable_nodal_energy[material]) {
+      file.add_point_data("nodal_energy" + suffix, captured.e_h[material]);
+      file.add_point_data("nodal_density" + suffix, captured.rho_h[material]);
+    }
+  }
+  if (in.enable_adapt) { file.add_point_data("h", captured.h_adapt); }
+  // CELLS
+  auto const& elements                      = captured.elements;
+  auto const& points_in_element             = captured.points_in_element;
+  auto        have_nodal_pressure_or_energy = [&](material_index const material) {
+    return in.enable_nodal_pressure[material] || in.enable_nodal_energy[material];
+  };
+  if (!hpc::all_of(hpc::serial_policy(), in.materials, have_nodal_pressure_or_energy)) {
+    add_vtu_point_data(file, "pressure", elements, points_in_element, captured.p);
+  }
+  if (!hpc::all_of(hpc::serial_policy(), in.enable_nodal_energy)) {
+    add_vtu_point_data(file, "energy", elements, points_in_element, captured.e);
+    add_vtu_point_data(file, "density", elements, points_in_element, captured.rho);
+  }
+  if (hpc::any_of(hpc::serial_policy(), in.enable_nodal_energy)) {
+    add_vtu_point_data(file, "q", elements, points_in_element, captured.q);
+    if (hpc::any_of(hpc::serial_policy(), in.enable_p_prime)) {
+      add_vtu_point_data(file, "p_prime", elements, points_in_element, captured.p_prime);
+    }
+  }
+  add_vtu_point_data(file, "time_step", elements, points_in_element, captured.element_dt);
+  if (in.enable_adapt) { file.add_cell_data("quality", captured.quality); }
+  file.set_materials(captured.material);
+}
+
+static void
+write_vtu_file(std::string const& prefix, input const& in, captured_state const& captured, int const file_output_index)
+{
+  vtu_file file(std::int64_t(captured.nodes.size()), std::int64_t(captured.elements.size()));
+  describe_binary_output(file, in, captured);
+  file.write(make_vtu_filename(prefix, file_output_index));
+}
+
+// xdmf_series and exodus_writer keep one file open across steps
+template <class Series>
+static void
+write_series_step(Series& series, input const& in, captured_state const& captured)
+{
+  series.begin_step(double(captured.time), std::int64_t(captured.nodes.size()), captured.adapt_epoch);
+  describe_binary_output(series, in, captured);
+  series.end_step();
+}
+
+static void
+write_vtk_file(std::string const& prefix, input const& in, captured_state const& captured, int const file_output_index)
 {
   auto stream = make_vtk_output_stream(prefix, file_output_index);
 
@@ -229,4 +378,40 @@ file_writer::write(input const& in, int const file_output_index)
   stream.close();
 }
 
+void
+file_writer::resume(input const& in, state const& s)
+{
+  switch (in.output_format) {
+    case VTK_ASCII:
+    case VTU_BINARY: break;
+    case XDMF_SERIES: series.resume(double(s.time)); break;
+    case EXODUS: exodus.resume(double(s.time), s.adapt_epoch); break;
+  }
+}
+
+void
+file_writer::write(input const& in, int const file_output_index)
+{
+  writer_thread.wait();
+  std::swap(captured, in_flight);
+  auto const in_ptr = &in;
+  writer_thread.submit([this, in_ptr, file_output_index]() {
+    switch (in_ptr->output_format) {
+      case VTK_ASCII: write_vtk_file(prefix, *in_ptr, in_flight, file_output_index); break;
+      case VTU_BINARY: write_vtu_file(prefix, *in_ptr, in_flight, file_output_index); break;
+      case XDMF_SERIES: write_series_step(series, *in_ptr, in_flight); break;
+      case EXODUS:
+        exodus.set_block_ids(in_ptr->exodus_block_ids);
+        write_series_step(exodus, *in_ptr, in_flight);
+        break;
+    }
+  });
+}
+
+void
+file_writer::flush()
+{
+  writer_thread.wait();
+}
+
 }  // namespace lgr
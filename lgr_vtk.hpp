@@ -2,7 +2,10 @@
 
 #include <hpc_array_vector.hpp>
 #include <hpc_dimensional.hpp>
+#include <lgr_exodus.hpp>
 #include <lgr_mesh_indices.hpp>
+#include <lgr_output_thread.hpp>
+#include <lgr_xdmf.hpp>
 #include <string>
 
 namespace lgr {
@@ -13,6 +16,8 @@ class state;
 class captured_state
 {
  public:
+  hpc::time<double>                                                                              time{0.0};
+  int                                                                                            adapt_epoch{0};
   hpc::counting_range<element_index>                                                             elements{0};
   hpc::counting_range<node_index>                                                                nodes{0};
   hpc::counting_range<node_in_element_index>                                                     nodes_in_element{0};
@@ -37,16 +42,28 @@ class captured_state
 #endif
 };
 
+// capture() fills `captured` on the calling thread; write() hands that frame
+// to a background thread and swaps in the other buffer for the next capture.
 class file_writer
 {
-  std::string prefix;
+  std::string    prefix;
+  captured_state in_flight;
+  xdmf_series    series;
+  exodus_writer  exodus;
+  output_thread  writer_thread;
 
  public:
-  file_writer(std::string const& prefix_in) : prefix(prefix_in) {}
+  file_writer(std::string const& prefix_in) : prefix(prefix_in), series(prefix_in), exodus(prefix_in + ".exo") {}
+  // a restarted run continues the series files of the original run instead of overwriting them
+  void
+  resume(input const& in, state const& s);
   void
   capture(input const& in, state const& s);
+  // `in` must outlive the write, i.e. until the next write() or flush()
+  void
+  write(input const& in, int const file_output_index);
   void
-                 write(input const& in, int const file_output_index);
+                 flush();
   captured_state captured;
 };
 
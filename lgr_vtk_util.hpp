@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstdint>
+#include <cstring>
 #include <fstream>
 #include <hpc_array_vector.hpp>
 #include <hpc_matrix3x3.hpp>
@@ -11,6 +13,7 @@
 #include <lgr_print.hpp>
 #include <sstream>
 #include <string>
+#include <vector>
 
 namespace lgr {
 
@@ -91,4 +94,214 @@ write_vtk_scalars(std::ostream& stream, std::string const& name, hpc::pinned_vec
   for (Quantity const val : vec) { stream << double(val) << "\n"; }
 }
 
+template <class T>
+struct vtu_type_name;
+template <>
+struct vtu_type_name<double>
+{
+  static constexpr char const* value = "Float64";
+};
+template <>
+struct vtu_type_name<int>
+{
+  static constexpr char const* value = "Int32";
+};
+template <>
+struct vtu_type_name<std::int64_t>
+{
+  static constexpr char const* value = "Int64";
+};
+template <>
+struct vtu_type_name<std::uint8_t>
+{
+  static constexpr char const* value = "UInt8";
+};
+
+// the plain type stored underneath dimensioned quantities and strong indices
+template <class T>
+struct vtu_raw_type
+{
+  using type = T;
+};
+template <class T, class D>
+struct vtu_raw_type<hpc::quantity<T, D>>
+{
+  using type = T;
+};
+#ifdef HPC_ENABLE_STRONG_INDICES
+template <class Tag, class Integral>
+struct vtu_raw_type<hpc::index<Tag, Integral>>
+{
+  using type = Integral;
+};
+#endif
+
+// Builds an XML UnstructuredGrid (.vtu) file with every array stored in a single
+// appended raw binary block, written with one large write() per array. Arrays
+// either point at caller-owned buffers, which must outlive write(), or own a
+// gathered copy of their data.
+class vtu_file
+{
+  struct data_array
+  {
+    std::string       section;
+    std::string       name;
+    char const*       type;
+    int               components;
+    char const*       data;
+    std::uint64_t     bytes;
+    std::vector<char> owned;
+  };
+  std::vector<data_array> arrays;
+  std::int64_t            number_of_points{0};
+  std::int64_t            number_of_cells{0};
+
+  template <class T>
+  void
+  add(std::string const& section, std::string const& name, int const components, T const* data, std::int64_t count)
+  {
+    using raw_type = typename vtu_raw_type<T>::type;
+    static_assert(sizeof(raw_type) == sizeof(T), "VTU arrays must be stored as their raw type");
+    arrays.push_back(
+        {section,
+         name,
+         vtu_type_name<raw_type>::value,
+         components,
+         reinterpret_cast<char const*>(data),
+         std::uint64_t(count) * sizeof(T),
+         {}});
+  }
+  template <class T>
+  void
+  add(std::string const& section, std::string const& name, int const components, std::vector<T>&& values)
+  {
+    using raw_type = typename vtu_raw_type<T>::type;
+    data_array a{section, name, vtu_type_name<raw_type>::value, components, nullptr, values.size() * sizeof(T), {}};
+    a.owned.resize(a.bytes);
+    if (a.bytes) std::memcpy(a.owned.data(), values.data(), a.bytes);
+    arrays.push_back(std::move(a));
+  }
+  template <class Quantity, class Index>
+  void
+  add(std::string const& section, std::string const& name, hpc::pinned_vector<Quantity, Index> const& vec)
+  {
+    add(section, name, 1, vec.data(), std::int64_t(vec.size()));
+  }
+  template <class T, class Index>
+  void
+  add(std::string const& section, std::string const& name, hpc::pinned_array_vector<T, Index> const& vec)
+  {
+    auto const components = int(vec.array_size());
+    add(section, name, components, vec.data(), std::int64_t(vec.size()) * components);
+  }
+  void
+  write_section(std::ostream& stream, std::string const& section, std::uint64_t& offset) const
+  {
+    for (auto const& a : arrays) {
+      if (a.section != section) continue;
+      stream << "<DataArray type=\"" << a.type << "\"";
+      if (!a.name.empty()) stream << " Name=\"" << a.name << "\"";
+      if (a.components != 1) stream << " NumberOfComponents=\"" << a.components << "\"";
+      stream << " format=\"appended\" offset=\"" << offset << "\"/>\n";
+      offset += sizeof(std::uint64_t) + a.bytes;
+    }
+  }
+
+ public:
+  vtu_file(std::int64_t const points, std::int64_t const cells) : number_of_points(points), number_of_cells(cells) {}
+  template <class Quantity, class Index>
+  void
+  set_points(hpc::pinned_array_vector<hpc::vector3<Quantity>, Index> const& x)
+  {
+    add("Points", "", x);
+  }
+  template <class NodeIndex, class ElementNodeIndex>
+  void
+  set_cells(
+      hpc::pinned_vector<NodeIndex, ElementNodeIndex> const& connectivity,
+      int const                                              nodes_per_cell,
+      std::uint8_t const                                     cell_type)
+  {
+    auto offsets = std::vector<std::int64_t>(std::size_t(number_of_cells));
+    for (std::int64_t i = 0; i < number_of_cells; ++i) offsets[std::size_t(i)] = (i + 1) * nodes_per_cell;
+    add("Cells", "connectivity", connectivity);
+    add("Cells", "offsets", 1, std::move(offsets));
+    add("Cells", "types", 1, std::vector<std::uint8_t>(std::size_t(number_of_cells), cell_type));
+  }
+  void
+  set_no_cells()
+  {
+    add("Cells", "connectivity", 1, std::vector<int>());
+    add("Cells", "offsets", 1, std::vector<std::int64_t>());
+    add("Cells", "types", 1, std::vector<std::uint8_t>());
+  }
+  template <class Vector>
+  void
+  add_point_data(std::string const& name, Vector const& vec)
+  {
+    add("PointData", name, vec);
+  }
+  template <class T>
+  void
+  add_point_data(std::string const& name, int const components, std::vector<T>&& values)
+  {
+    add("PointData", name, components, std::move(values));
+  }
+  template <class Vector>
+  void
+  add_cell_data(std::string const& name, Vector const& vec)
+  {
+    add("CellData", name, vec);
+  }
+  template <class Vector>
+  void
+  set_materials(Vector const& material)
+  {
+    add_cell_data("material", material);
+  }
+  template <class T>
+  void
+  add_cell_data(std::string const& name, int const components, std::vector<T>&& values)
+  {
+    add("CellData", name, components, std::move(values));
+  }
+  void
+  write(std::string const& filename) const
+  {
+    std::ofstream stream(filename.c_str(), std::ios::binary);
+    stream << "<?xml version=\"1.0\"?>\n";
+    stream << "<VTKFile type=\"UnstructuredGrid\" version=\"1.0\" byte_order=\"LittleEndian\" "
+              "header_type=\"UInt64\">\n";
+    stream << "<UnstructuredGrid>\n";
+    stream << "<Piece NumberOfPoints=\"" << number_of_points << "\" NumberOfCells=\"" << number_of_cells << "\">\n";
+    std::uint64_t offset     = 0;
+    char const*   sections[] = {"PointData", "CellData", "Points", "Cells"};
+    for (auto const section : sections) {
+      stream << "<" << section << ">\n";
+      write_section(stream, section, offset);
+      stream << "</" << section << ">\n";
+    }
+    stream << "</Piece>\n";
+    stream << "</UnstructuredGrid>\n";
+    stream << "<AppendedData encoding=\"raw\">\n_";
+    for (auto const section : sections) {
+      for (auto const& a : arrays) {
+        if (a.section != section) continue;
+        auto const bytes = a.bytes;
+        stream.write(reinterpret_cast<char const*>(&bytes), sizeof(bytes));
+        auto const data = a.owned.empty() ? a.data : a.owned.data();
+        stream.write(data, std::streamsize(bytes));
+      }
+    }
+    stream << "\n</AppendedData>\n";
+    stream << "</VTKFile>\n";
+  }
+};
+
+inline std::string
+make_vtu_filename(std::string const& prefix, int const file_output_index)
+{
+  return prefix + "_" + std::to_string(file_output_index) + ".vtu";
+}
+
 }  // namespace lgr
@@ -0,0 +1,313 @@
+#pragma once
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <lgr_vtk_util.hpp>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace lgr {
+
+template <class T>
+struct xdmf_number_type;
+template <>
+struct xdmf_number_type<double>
+{
+  static constexpr char const* name      = "Float";
+  static constexpr int         precision = 8;
+};
+template <>
+struct xdmf_number_type<int>
+{
+  static constexpr char const* name      = "Int";
+  static constexpr int         precision = 4;
+};
+template <>
+struct xdmf_number_type<std::int64_t>
+{
+  static constexpr char const* name      = "Int";
+  static constexpr int         precision = 8;
+};
+template <>
+struct xdmf_number_type<std::uint8_t>
+{
+  static constexpr char const* name      = "UChar";
+  static constexpr int         precision = 1;
+};
+
+// Time series output as a single <prefix>.xdmf index plus a single <prefix>.bin
+// file of raw arrays that only ever grows. Each step appends its geometry and
+// fields to the .bin file and one Grid entry to the index. Connectivity and
+// materials are appended only once per adapt epoch; later steps of the epoch
+// point back at the same bytes. Mirrors the vtu_file interface so the same
+// code can describe either kind of output. A restarted run resume()s the
+// series instead of starting it over.
+class xdmf_series
+{
+  std::string                        prefix;
+  std::ofstream                      heavy;
+  std::ofstream                      index;
+  std::uint64_t                      heavy_offset{0};
+  std::streamoff                     index_footer{0};
+  std::int64_t                       number_of_points{0};
+  int                                epoch{-1};
+  std::map<std::string, std::string> epoch_items;  // DataItems written once this epoch, by name
+  std::ostringstream                 grid;
+
+  std::string
+  heavy_name() const
+  {
+    auto const filename = prefix + ".bin";
+    auto const slash    = filename.find_last_of('/');
+    return slash == std::string::npos ? filename : filename.substr(slash + 1);
+  }
+  template <class T>
+  std::string
+  append(T const* data, std::int64_t const rows, int const components)
+  {
+    using raw_type   = typename vtu_raw_type<T>::type;
+    auto const bytes = std::uint64_t(rows) * std::uint64_t(components) * sizeof(T);
+    static_assert(sizeof(raw_type) == sizeof(T), "XDMF arrays must be stored as their raw type");
+    std::ostringstream item;
+    item << "<DataItem Format=\"Binary\" DataType=\"" << xdmf_number_type<raw_type>::name << "\" Precision=\""
+         << xdmf_number_type<raw_type>::precision << "\" Endian=\"Little\" Seek=\"" << heavy_offset
+         << "\" Dimensions=\"" << rows;
+    if (components != 1) item << " " << components;
+    item << "\">" << heavy_name() << "</DataItem>\n";
+    heavy.write(reinterpret_cast<char const*>(data), std::streamsize(bytes));
+    heavy_offset += bytes;
+    return item.str();
+  }
+  static char const*
+  attribute_type(int const components)
+  {
+    switch (components) {
+      case 1: return "Scalar";
+      case 3: return "Vector";
+      case 6: return "Tensor6";
+      case 9: return "Tensor";
+    }
+    return "Matrix";
+  }
+  // returns the DataItem this epoch already wrote under `name`, or appends one
+  template <class T>
+  std::string const&
+  append_once(std::string const& name, T const* data, std::int64_t const rows, int const components)
+  {
+    auto& item = epoch_items[name];
+    if (item.empty()) item = append(data, rows, components);
+    return item;
+  }
+  template <class T>
+  void
+  add(char const* center, std::string const& name, int const components, T const* data, std::int64_t const rows)
+  {
+    grid << "<Attribute Name=\"" << name << "\" AttributeType=\"" << attribute_type(components) << "\" Center=\""
+         << center << "\">\n";
+    grid << append(data, rows, components);
+    grid << "</Attribute>\n";
+  }
+  template <class Quantity, class Index>
+  void
+  add(char const* center, std::string const& name, hpc::pinned_vector<Quantity, Index> const& vec)
+  {
+    add(center, name, 1, vec.data(), std::int64_t(vec.size()));
+  }
+  template <class T, class Index>
+  void
+  add(char const* center, std::string const& name, hpc::pinned_array_vector<T, Index> const& vec)
+  {
+    add(center, name, int(vec.array_size()), vec.data(), std::int64_t(vec.size()));
+  }
+  static std::string
+  attribute_value(std::string const& element, std::string const& name)
+  {
+    auto const key   = name + "=\"";
+    auto const first = element.find(key);
+    if (first == std::string::npos) return "";
+    auto const begin = first + key.size();
+    return element.substr(begin, element.find('"', begin) - begin);
+  }
+  // the end in the .bin file of the last array a step's Grid refers to
+  static std::uint64_t
+  heavy_end(std::string const& step)
+  {
+    std::uint64_t end = 0;
+    for (auto item = step.find("<DataItem "); item != std::string::npos; item = step.find("<DataItem ", item + 1)) {
+      auto const         tag   = step.substr(item, step.find('>', item) - item);
+      std::uint64_t      bytes = std::strtoull(attribute_value(tag, "Precision").c_str(), nullptr, 10);
+      std::istringstream dimensions(attribute_value(tag, "Dimensions"));
+      for (std::uint64_t dimension; dimensions >> dimension;) bytes *= dimension;
+      end = std::max<std::uint64_t>(end, std::strtoull(attribute_value(tag, "Seek").c_str(), nullptr, 10) + bytes);
+    }
+    return end;
+  }
+  void
+  open_index()
+  {
+    index.open((prefix + ".xdmf").c_str(), std::ios::trunc);
+    index << "<?xml version=\"1.0\" ?>\n";
+    index << "<Xdmf Version=\"3.0\">\n<Domain>\n";
+    index << "<Grid Name=\"TimeSeries\" GridType=\"Collection\" CollectionType=\"Temporal\">\n";
+    index_footer = index.tellp();
+  }
+  void
+  close_index()
+  {
+    index_footer = index.tellp();
+    index << "</Grid>\n</Domain>\n</Xdmf>\n";
+    index.flush();
+  }
+  template <class T>
+  void
+  set_topology(std::string const& type, int const nodes_per_cell, T const* data, std::int64_t const count)
+  {
+    grid << "<Topology TopologyType=\"" << type << "\" NumberOfElements=\"" << count / nodes_per_cell
+         << "\" NodesPerElement=\"" << nodes_per_cell << "\">\n";
+    grid << append_once("topology", data, count / nodes_per_cell, nodes_per_cell);
+    grid << "</Topology>\n";
+  }
+
+ public:
+  explicit xdmf_series(std::string const& prefix_in) : prefix(prefix_in) {}
+  // Continues the series of a run restarted at `time`: keeps the steps the
+  // original run wrote up to that time, cuts the .bin file back to the bytes
+  // they use, and appends from there. Steps it wrote later are dropped.
+  void
+  resume(double const time)
+  {
+    std::ifstream     old_index((prefix + ".xdmf").c_str());
+    std::stringstream contents;
+    contents << old_index.rdbuf();
+    old_index.close();
+    auto const        text       = contents.str();
+    std::string const step_begin = "<Grid GridType=\"Uniform\">\n";
+    std::string const step_end   = "</Grid>\n";
+    std::string       kept;
+    heavy_offset = 0;
+    for (auto begin = text.find(step_begin); begin != std::string::npos; begin = text.find(step_begin, begin)) {
+      auto const end = text.find(step_end, begin);
+      if (end == std::string::npos) break;
+      auto const step = text.substr(begin, end + step_end.size() - begin);
+      if (std::strtod(attribute_value(step, "<Time Value").c_str(), nullptr) > time) break;
+      kept += step;
+      heavy_offset = std::max(heavy_offset, heavy_end(step));
+      begin        = end;
+    }
+    auto const heavy_path = prefix + ".bin";
+    if (::truncate(heavy_path.c_str(), off_t(heavy_offset)) != 0 && heavy_offset != 0) {
+      throw std::runtime_error("could not cut " + heavy_path + " back to the restarted step");
+    }
+    heavy.open(heavy_path.c_str(), std::ios::binary | std::ios::app);
+    open_index();
+    index << kept;
+    close_index();
+    epoch = -1;
+    epoch_items.clear();
+  }
+  // a step of a new adapt_epoch (or with a new number of points) writes its
+  // topology and materials again; other steps refer back to the epoch's first
+  void
+  begin_step(double const time, std::int64_t const points, int const adapt_epoch)
+  {
+    if (!index.is_open()) {
+      heavy.open((prefix + ".bin").c_str(), std::ios::binary | std::ios::trunc);
+      open_index();
+    }
+    if (adapt_epoch != epoch || points != number_of_points) epoch_items.clear();
+    epoch            = adapt_epoch;
+    number_of_points = points;
+    grid.str("");
+    grid << std::scientific << std::setprecision(17);
+    grid << "<Grid GridType=\"Uniform\">\n";
+    grid << "<Time Value=\"" << time << "\"/>\n";
+  }
+  template <class Quantity, class Index>
+  void
+  set_points(hpc::pinned_array_vector<hpc::vector3<Quantity>, Index> const& x)
+  {
+    grid << "<Geometry GeometryType=\"XYZ\">\n";
+    grid << append(x.data(), std::int64_t(x.size()), 3);
+    grid << "</Geometry>\n";
+  }
+  template <class NodeIndex, class ElementNodeIndex>
+  void
+  set_cells(
+      hpc::pinned_vector<NodeIndex, ElementNodeIndex> const& connectivity,
+      int const                                              nodes_per_cell,
+      std::uint8_t const                                     cell_type)
+  {
+    std::string type = "Mixed";
+    switch (cell_type) {
+      case 3: type = "Polyline"; break;
+      case 5: type = "Triangle"; break;
+      case 10: type = "Tetrahedron"; break;
+      case 24: type = "Tetrahedron_10"; break;
+    }
+    set_topology(type, nodes_per_cell, connectivity.data(), std::int64_t(connectivity.size()));
+  }
+  // one vertex cell per point
+  void
+  set_no_cells()
+  {
+    std::vector<std::int64_t> vertices;
+    if (!epoch_items.count("topology")) {
+      vertices.resize(std::size_t(number_of_points));
+      for (std::int64_t i = 0; i < number_of_points; ++i) vertices[std::size_t(i)] = i;
+    }
+    set_topology("Polyvertex", 1, vertices.data(), number_of_points);
+  }
+  template <class Vector>
+  void
+  add_point_data(std::string const& name, Vector const& vec)
+  {
+    add("Node", name, vec);
+  }
+  template <class T>
+  void
+  add_point_data(std::string const& name, int const components, std::vector<T>&& values)
+  {
+    add("Node", name, components, values.data(), std::int64_t(values.size()) / components);
+  }
+  template <class Vector>
+  void
+  add_cell_data(std::string const& name, Vector const& vec)
+  {
+    add("Cell", name, vec);
+  }
+  // materials only change when adapt() does
+  template <class MaterialIndex, class ElementIndex>
+  void
+  set_materials(hpc::pinned_vector<MaterialIndex, ElementIndex> const& material)
+  {
+    grid << "<Attribute Name=\"material\" AttributeType=\"Scalar\" Center=\"Cell\">\n";
+    grid << append_once("material", material.data(), std::int64_t(material.size()), 1);
+    grid << "</Attribute>\n";
+  }
+  template <class T>
+  void
+  add_cell_data(std::string const& name, int const components, std::vector<T>&& values)
+  {
+    add("Cell", name, components, values.data(), std::int64_t(values.size()) / components);
+  }
+  // closes the Grid of this step, rewriting only the tail of the index
+  void
+  end_step()
+  {
+    grid << "</Grid>\n";
+    heavy.flush();
+    index.seekp(index_footer);
+    index << grid.str();
+    close_index();
+  }
+};
+
+}  // namespace lgr
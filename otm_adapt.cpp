@@ -335,19 +335,8 @@ otm_adapt(const input& in, state& s)
 
   apply_node_adapt(s, a);
   apply_point_adapt(s, a);
-  interpolate_nodal_data(a, s.x);
-  interpolate_nodal_data(a, s.u);
-  interpolate_nodal_data(a, s.v);
-  interpolate_point_data(a, s.xp);
-  interpolate_point_data(a, s.h_otm);
-  interpolate_point_data(a, s.K);
-  interpolate_point_data(a, s.G);
-  interpolate_point_data(a, s.rho);
-  if (s.ep.size() > 0) interpolate_point_data(a, s.ep);
-  interpolate_point_data(a, s.b);
-  lie_interpolate_point_data(a, s.F_total);
-  if (s.Fp_total.size() > 0) lie_interpolate_point_data(a, s.Fp_total);
-  distribute_point_data(a, s.V);
+  transfer_nodal_fields(a, s);
+  transfer_point_fields(a, s);
   s.nodes  = a.new_nodes;
   s.points = a.new_points;
   s.nearest_node_neighbor.resize(s.nodes.size());
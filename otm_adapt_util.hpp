@@ -8,6 +8,7 @@
 #include <hpc_macros.hpp>
 #include <hpc_range.hpp>
 #include <hpc_vector.hpp>
+#include <lgr_adapt_util.hpp>
 #include <lgr_state.hpp>
 #include <otm_adapt.hpp>
 #include <otm_distance.hpp>
@@ -187,29 +188,42 @@ template <class Range>
 HPC_NOINLINE inline void
 interpolate_nodal_data(const otm_adapt_state& a, Range& data)
 {
-  interpolate_data(a.new_nodes, a.new_nodes_to_old_nodes, a.new_nodes_are_same, a.interpolate_from_nodes, data);
+  transfer_fields(
+      a.new_nodes,
+      a.new_nodes_to_old_nodes,
+      a.new_nodes_are_same,
+      a.interpolate_from_nodes,
+      std::make_tuple(transferable<transfer_rule::AVERAGE>(data)));
 }
 
 template <class Range>
 HPC_NOINLINE inline void
 interpolate_point_data(const otm_adapt_state& a, Range& data)
 {
-  interpolate_data(a.new_points, a.new_points_to_old_points, a.new_points_are_same, a.interpolate_from_points, data);
+  transfer_fields(
+      a.new_points,
+      a.new_points_to_old_points,
+      a.new_points_are_same,
+      a.interpolate_from_points,
+      std::make_tuple(transferable<transfer_rule::AVERAGE>(data)));
 }
 
-template <class Range>
 HPC_NOINLINE inline void
-lie_interpolate_point_data(const otm_adapt_state& a, Range& data)
+transfer_nodal_fields(const otm_adapt_state& a, state& s)
 {
-  lie_interpolate_data(
-      a.new_points, a.new_points_to_old_points, a.new_points_are_same, a.interpolate_from_points, data);
+  transfer_fields(
+      a.new_nodes, a.new_nodes_to_old_nodes, a.new_nodes_are_same, a.interpolate_from_nodes, otm_adapt_node_fields(s));
 }
 
-template <class Range>
 HPC_NOINLINE inline void
-distribute_point_data(const otm_adapt_state& a, Range& data)
+transfer_point_fields(const otm_adapt_state& a, state& s)
 {
-  distribute_data(a.new_points, a.new_points_to_old_points, a.new_points_are_same, a.interpolate_from_points, data);
+  transfer_fields(
+      a.new_points,
+      a.new_points_to_old_points,
+      a.new_points_are_same,
+      a.interpolate_from_points,
+      otm_adapt_point_fields(s));
 }
 
 }  // namespace lgr
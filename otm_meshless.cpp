@@ -4,6 +4,7 @@
 #include <hpc_array.hpp>
 #include <hpc_execution.hpp>
 #include <hpc_math.hpp>
+#include <hpc_symmetric3x3.hpp>
 #include <hpc_transform_reduce.hpp>
 #include <hpc_vector3.hpp>
 #include <iomanip>
@@ -15,6 +16,7 @@
 #include <lgr_input.hpp>
 #include <lgr_physics_util.hpp>
 #include <lgr_state.hpp>
+#include <limits>
 #include <otm_adapt.hpp>
 #include <otm_distance.hpp>
 #include <otm_distance_util.hpp>
@@ -33,10 +35,7 @@ void
 otm_mark_boundary_domains(input const& in, state& s)
 {
   s.boundaries = in.boundaries;
-  for (auto const boundary : s.boundaries) {
-    auto const& domain = in.domains[boundary];
-    domain->mark(s.x, boundary, &s.nodal_materials);
-  }
+  mark_boundary_nodes(in, s);
 }
 
 void
@@ -104,6 +103,133 @@ otm_initialize_point_volume(state& s)
   hpc::for_each(hpc::device_policy(), s.elements, func);
 }
 
+namespace {
+
+// The support of one point as its point-to-node vectors r = xp - xn, for the
+// passes of the max-ent Newton solve. Supports of up to Capacity nodes are
+// gathered once into padded structure-of-arrays storage, with the exponents
+// -beta r.r, so that each pass evaluates all its Boltzmann factors
+// exp(mu.r - beta r.r) in one contiguous loop the compiler can vectorize, exp
+// included where the math library has a vector exp. Padding lanes have r = 0
+// and the lowest exponent, so their factor is 0. Larger supports gather node by
+// node in every pass, as do all supports with a Capacity of 0. Callbacks see the
+// support in order either way, so sums over it are the same as in a node by node
+// loop.
+template <int Capacity, class PointNodes, class PointNodesToNodes, class NodesToX>
+class maxent_support
+{
+ public:
+  static constexpr int lanes   = 8;  // doubles in the widest vector registers
+  static constexpr int storage = Capacity > 0 ? Capacity : 1;  // zero-length arrays are not standard C++
+  static_assert(Capacity % lanes == 0, "packed supports are padded to whole vectors");
+
+  HPC_HOST_DEVICE
+  maxent_support(
+      PointNodes const&               point_nodes,
+      PointNodesToNodes const&        point_nodes_to_nodes,
+      NodesToX const&                 nodes_to_x,
+      hpc::position<double> const&    xp,
+      hpc::inverse_area<double> const beta)
+      : m_point_nodes(point_nodes),
+        m_point_nodes_to_nodes(point_nodes_to_nodes),
+        m_nodes_to_x(nodes_to_x),
+        m_xp(xp),
+        m_beta(beta),
+        m_packed(Capacity > 0 && point_nodes.size() <= Capacity),
+        m_padded_size(0)
+  {
+    if (m_packed == false) return;
+    auto i = 0;
+    for (auto const point_node : m_point_nodes) {
+      auto const r  = vector_to(point_node);
+      m_rx[i]       = r(0);
+      m_ry[i]       = r(1);
+      m_rz[i]       = r(2);
+      m_exponent[i] = -(m_beta * hpc::inner_product(r, r));
+      ++i;
+    }
+    m_padded_size = ((i + lanes - 1) / lanes) * lanes;
+    for (; i < m_padded_size; ++i) {
+      m_rx[i]       = 0.0;
+      m_ry[i]       = 0.0;
+      m_rz[i]       = 0.0;
+      m_exponent[i] = std::numeric_limits<double>::lowest();
+    }
+  }
+
+  // f(point_node, r)
+  template <class F>
+  HPC_HOST_DEVICE void
+  for_each_r(F&& f) const
+  {
+    auto i = 0;
+    for (auto const point_node : m_point_nodes) {
+      f(point_node, m_packed == true ? hpc::position<double>(m_rx[i], m_ry[i], m_rz[i]) : vector_to(point_node));
+      ++i;
+    }
+  }
+
+  // f(point_node, r, exp(mu.r - beta r.r))
+  template <class F>
+  HPC_HOST_DEVICE void
+  for_each_factor(hpc::basis_gradient<double> const& mu, F&& f) const
+  {
+    if (m_packed == false) {
+      for (auto const point_node : m_point_nodes) {
+        auto const r   = vector_to(point_node);
+        auto const rr  = hpc::inner_product(r, r);
+        auto const mur = hpc::inner_product(mu, r);
+        f(point_node, r, std::exp(mur - m_beta * rr));
+      }
+      return;
+    }
+    hpc::array<double, storage, int> factors;
+    for (auto i = 0; i < m_padded_size; ++i) {
+      factors[i] = std::exp(mu(0) * m_rx[i] + mu(1) * m_ry[i] + mu(2) * m_rz[i] + m_exponent[i]);
+    }
+    auto i = 0;
+    for (auto const point_node : m_point_nodes) {
+      f(point_node, hpc::position<double>(m_rx[i], m_ry[i], m_rz[i]), factors[i]);
+      ++i;
+    }
+  }
+
+ private:
+  HPC_HOST_DEVICE hpc::position<double>
+                  vector_to(point_node_index const point_node) const
+  {
+    auto const node = m_point_nodes_to_nodes[point_node];
+    return m_xp - m_nodes_to_x[node].load();
+  }
+
+  PointNodes                                           m_point_nodes;
+  PointNodesToNodes                                    m_point_nodes_to_nodes;
+  NodesToX                                             m_nodes_to_x;
+  hpc::position<double>                                m_xp;
+  hpc::inverse_area<double>                            m_beta;
+  bool                                                 m_packed;
+  int                                                  m_padded_size;
+  hpc::array<hpc::length<double>, storage, int>       m_rx;
+  hpc::array<hpc::length<double>, storage, int>       m_ry;
+  hpc::array<hpc::length<double>, storage, int>       m_rz;
+  hpc::array<hpc::adimensional<double>, storage, int> m_exponent;
+};
+
+template <int Capacity, class PointNodes, class PointNodesToNodes, class NodesToX>
+HPC_HOST_DEVICE inline maxent_support<Capacity, PointNodes, PointNodesToNodes, NodesToX>
+make_maxent_support(
+    PointNodes const&               point_nodes,
+    PointNodesToNodes const&        point_nodes_to_nodes,
+    NodesToX const&                 nodes_to_x,
+    hpc::position<double> const&    xp,
+    hpc::inverse_area<double> const beta)
+{
+  return maxent_support<Capacity, PointNodes, PointNodesToNodes, NodesToX>(
+      point_nodes, point_nodes_to_nodes, nodes_to_x, xp, beta);
+}
+
+}  // anonymous namespace
+
 #define DEBUG_MAXENT 0
 
 void
@@ -114,51 +240,93 @@ otm_update_shape_functions(state& s)
   auto const gamma = s.otm_gamma;
   auto const h_otm = std::sqrt(gamma / beta);
 #endif
+  if (s.mu.size() != s.points.size()) {
+    s.mu.resize(s.points.size());
+    hpc::fill(hpc::device_policy(), s.mu, hpc::basis_gradient<double>::zero());
+  }
+  auto const lazy   = s.maxent_update_tolerance > 0.0;
+  auto const cached = lazy == true && s.maxent_r.size() == s.N.size();
+  if (lazy == true) s.maxent_r.resize(s.N.size());
   auto const point_nodes_to_nodes  = s.point_nodes_to_nodes.cbegin();
   auto const nodes_to_x            = s.x.cbegin();
   auto const point_nodes_to_N      = s.N.begin();
   auto const point_nodes_to_grad_N = s.grad_N.begin();
   auto const points_to_xp          = s.xp.cbegin();
   auto const points_to_point_nodes = s.points_to_point_nodes.cbegin();
+  auto const points_to_mu          = s.mu.begin();
+  auto const points_to_h           = s.h_otm.cbegin();
+  auto const point_nodes_to_r      = s.maxent_r.begin();
+  auto const update_tolerance      = s.maxent_update_tolerance;
   auto const eps                   = s.maxent_desired_tolerance;
   auto const delta                 = s.maxent_acceptable_tolerance;
   auto const use_log               = s.use_maxent_log_objective;
   auto const use_line_search       = s.use_maxent_line_search;
-  auto       functor               = [=] HPC_DEVICE(point_index const point) {
+#ifdef HPC_CUDA
+  // a packed support is about 2.5 KB per thread, which would live in local memory on a device
+  constexpr int packed_capacity = 0;
+#else
+  constexpr int packed_capacity = 64;  // nodes; supports beyond it gather in every pass
+#endif
+  auto functor = [=] HPC_DEVICE(point_index const point) {
     auto       point_nodes = points_to_point_nodes[point];
     auto const xp          = points_to_xp[point].load();
-    // Newton's algorithm
-    auto converged      = false;
-    auto mu             = hpc::basis_gradient<double>::zero();
-    using jacobian      = hpc::matrix3x3<hpc::quantity<double, hpc::area_dimension>>;
-    auto       J        = jacobian::zero();
-    auto       iter     = 0;
-    auto const max_iter = 16;
-    auto       R0       = hpc::position<double>::zero();
-    auto       norm_R0  = 0.0;
+    // Keep N and grad_N while no point-to-node vector moved by more than the
+    // tolerance since they were solved for, as in rigid or resting regions.
+    if (cached == true) {
+      auto const max_change = update_tolerance * points_to_h[point];
+      auto       moved      = false;
+      for (auto const point_node : point_nodes) {
+        auto const r = xp - nodes_to_x[point_nodes_to_nodes[point_node]].load();
+        if (hpc::norm(r - point_nodes_to_r[point_node].load()) > max_change) {
+          moved = true;
+          break;
+        }
+      }
+      if (moved == false) return;
+    }
+    auto const support =
+        make_maxent_support<packed_capacity>(point_nodes, point_nodes_to_nodes, nodes_to_x, xp, beta);
+    // Newton's algorithm, started from the multipliers of the last solve as
+    // points move little per step. Residuals stay relative to the one at zero.
+    auto       converged  = false;
+    auto       mu         = points_to_mu[point].load();
+    auto const warm_start = hpc::norm(mu) > 0.0;
+    using jacobian        = hpc::symmetric3x3<hpc::quantity<double, hpc::area_dimension>>;
+    auto       J          = jacobian::zero();
+    auto       iter       = 0;
+    auto const max_iter   = 16;
+    auto       R0         = hpc::position<double>::zero();
+    auto       norm_R0    = 0.0;
     while (converged == false) {
       auto Z       = hpc::adimensional<double>(0.0);
       auto dZdmu   = hpc::position<double>::zero();
       auto ddZddmu = jacobian::zero();
-      for (auto point_node : point_nodes) {
-        auto const node             = point_nodes_to_nodes[point_node];
-        auto const xn               = nodes_to_x[node].load();
-        auto const r                = xp - xn;
-        auto const rr               = hpc::inner_product(r, r);
-        auto const mur              = hpc::inner_product(mu, r);
-        auto const boltzmann_factor = std::exp(mur - beta * rr);
-        Z += boltzmann_factor;
-        dZdmu += boltzmann_factor * r;
-        ddZddmu += boltzmann_factor * hpc::outer_product(r, r);
+      support.for_each_factor(
+          mu, [&](point_node_index, hpc::position<double> const& r, hpc::adimensional<double> const boltzmann_factor) {
+            Z += boltzmann_factor;
+            dZdmu += boltzmann_factor * r;
+            ddZddmu += boltzmann_factor * hpc::self_outer_product(r);
+          });
+      auto Z0     = Z;
+      auto dZ0dmu = dZdmu;
+      if (iter == 0 && warm_start == true) {
+        Z0     = 0.0;
+        dZ0dmu = hpc::position<double>::zero();
+        support.for_each_factor(
+            hpc::basis_gradient<double>::zero(),
+            [&](point_node_index, hpc::position<double> const& r, hpc::adimensional<double> const prior_factor) {
+              Z0 += prior_factor;
+              dZ0dmu += prior_factor * r;
+            });
       }
       auto const f       = use_log == true ? std::log(Z) : Z;
       auto const dfdmu   = use_log == true ? dZdmu / Z : dZdmu;
-      auto const ddfddmu = use_log == true ? ddZddmu / Z - hpc::outer_product(dfdmu, dfdmu) : ddZddmu;
+      auto const ddfddmu = use_log == true ? ddZddmu / Z - hpc::self_outer_product(dfdmu) : ddZddmu;
       if (iter == 0) {
-        R0      = dfdmu;
+        R0      = use_log == true ? dZ0dmu / Z0 : dZ0dmu;
         norm_R0 = hpc::norm(R0);
       }
-      auto const dmu   = -hpc::solve_full_pivot(ddfddmu, dfdmu);
+      auto const dmu   = -hpc::solve_spd(ddfddmu, dfdmu);
       auto       alpha = 1.0;
       if (use_line_search == true) {
         auto const contraction_factor     = 0.5;
@@ -174,15 +342,11 @@ otm_update_shape_functions(state& s)
           auto const function = f;
           auto const trial_mu = mu + alpha * dmu;
           auto       trial_Z  = 0.0;
-          for (auto point_node : point_nodes) {
-            auto const node             = point_nodes_to_nodes[point_node];
-            auto const xn               = nodes_to_x[node].load();
-            auto const r                = xp - xn;
-            auto const rr               = hpc::inner_product(r, r);
-            auto const mur              = hpc::inner_product(trial_mu, r);
-            auto const boltzmann_factor = std::exp(mur - beta * rr);
-            trial_Z += boltzmann_factor;
-          }
+          support.for_each_factor(
+              trial_mu,
+              [&](point_node_index, hpc::position<double> const&, hpc::adimensional<double> const boltzmann_factor) {
+                trial_Z += boltzmann_factor;
+              });
           auto const trial_function = use_log == true ? std::log(trial_Z) : trial_Z;
           if (trial_function > function + change_factor * alpha * step_change) {
             alpha = contraction_factor * alpha;
@@ -210,14 +374,11 @@ otm_update_shape_functions(state& s)
         mu -= (alpha * dmu);
         auto min_dist = hpc::length<double>(std::numeric_limits<double>::max());
         auto max_dist = hpc::length<double>(std::numeric_limits<double>::min());
-        for (auto point_node : point_nodes) {
-          auto const node = point_nodes_to_nodes[point_node];
-          auto const xn   = nodes_to_x[node].load();
-          auto const r    = xn - xp;
-          auto const d    = hpc::norm(r);
-          min_dist        = std::min(min_dist, d);
-          max_dist        = std::max(max_dist, d);
-        }
+        support.for_each_r([&](point_node_index, hpc::position<double> const& r) {
+          auto const d = hpc::norm(r);
+          min_dist     = std::min(min_dist, d);
+          max_dist     = std::max(max_dist, d);
+        });
         std::cout << "********************" << '\n';
         std::cout << "**** beta     : " << beta << '\n';
         std::cout << "**** gamma    : " << gamma << '\n';
@@ -231,16 +392,15 @@ otm_update_shape_functions(state& s)
         Z       = 0.0;
         dZdmu   = hpc::position<double>::zero();
         ddZddmu = jacobian::zero();
-        for (auto point_node : point_nodes) {
+        support.for_each_factor(mu, [&](point_node_index const point_node, hpc::position<double> const& r, double bf) {
           auto const node             = point_nodes_to_nodes[point_node];
-          auto const xn               = nodes_to_x[node].load();
-          auto const r                = xp - xn;
+          auto const xn               = xp - r;
           auto const rr               = hpc::inner_product(r, r);
           auto const mur              = hpc::inner_product(mu, r);
-          auto const boltzmann_factor = std::exp(mur - beta * rr);
+          auto const boltzmann_factor = bf;
           Z += boltzmann_factor;
           dZdmu += r * boltzmann_factor;
-          ddZddmu += boltzmann_factor * hpc::outer_product(r, r);
+          ddZddmu += boltzmann_factor * hpc::self_outer_product(r);
           std::cout << "**** node     : " << node << '\n';
           std::cout << "**** xn       : " << xn << '\n';
           std::cout << "**** r        : " << r << '\n';
@@ -251,10 +411,10 @@ otm_update_shape_functions(state& s)
           std::cout << "**** Z        : " << Z << '\n';
           std::cout << "**** dZdmu    : " << dZdmu << '\n';
           std::cout << "**** ddZddmu  : " << ddZddmu << '\n';
-        }
+        });
         auto const f       = use_log == true ? std::log(Z) : Z;
         auto const dfdmu   = use_log == true ? dZdmu / Z : dZdmu;
-        auto const ddfddmu = use_log == true ? ddZddmu / Z - hpc::outer_product(dfdmu, dfdmu) : ddZddmu;
+        auto const ddfddmu = use_log == true ? ddZddmu / Z - hpc::self_outer_product(dfdmu) : ddZddmu;
         std::cout << "--------------------" << '\n';
         std::cout << "**** z        : " << f << '\n';
         std::cout << "**** dfdmu    : " << dfdmu << '\n';
@@ -274,28 +434,25 @@ otm_update_shape_functions(state& s)
       }
       ++iter;
     }
-    auto const Jinv = hpc::inverse_full_pivot(J);
-    auto       Z    = 0.0;
-    for (auto point_node : point_nodes) {
-      auto const node             = point_nodes_to_nodes[point_node];
-      auto const xn               = nodes_to_x[node].load();
-      auto const r                = xp - xn;
-      auto const rr               = hpc::inner_product(r, r);
-      auto const mur              = hpc::inner_product(mu, r);
-      auto const boltzmann_factor = std::exp(mur - beta * rr);
-      Z += boltzmann_factor;
-      point_nodes_to_N[point_node] = boltzmann_factor;
-    }
-    for (auto point_node : point_nodes) {
-      auto const node                   = point_nodes_to_nodes[point_node];
-      auto const xn                     = nodes_to_x[node].load();
-      auto const r                      = xp - xn;
+    points_to_mu[point] = mu;
+    auto const Jinv     = hpc::inverse_spd(J);
+    auto       Z        = 0.0;
+    support.for_each_factor(
+        mu,
+        [&](point_node_index const point_node,
+            hpc::position<double> const& r,
+            hpc::adimensional<double> const boltzmann_factor) {
+          Z += boltzmann_factor;
+          point_nodes_to_N[point_node] = boltzmann_factor;
+          if (lazy == true) point_nodes_to_r[point_node] = r;
+        });
+    support.for_each_r([&](point_node_index const point_node, hpc::position<double> const& r) {
       auto const boltzmann_factor       = point_nodes_to_N[point_node];
       auto const N                      = boltzmann_factor / Z;
       point_nodes_to_N[point_node]      = N;
       auto const dNdx                   = use_log == true ? -N * Jinv * r : -N * Z * Jinv * r;
       point_nodes_to_grad_N[point_node] = dNdx;
-    }
+    });
   };
   hpc::for_each(hpc::device_policy(), s.points, functor);
 }
@@ -638,6 +795,7 @@ otm_allocate_state(input const& in, state& s)
   auto const total_support_size = hpc::transform_reduce(hpc::device_policy(), s.points, 0, hpc::plus<int>(), functor);
   s.grad_N.resize(total_support_size);
   s.N.resize(total_support_size);
+  s.maxent_r.clear();  // supports or beta may have changed, so every point solves again
   s.F_total.resize(num_points);
   s.Fp_total.resize(num_points);
   s.sigma_full.resize(num_points);
@@ -787,7 +945,7 @@ otm_set_beta(double gamma, state& s)
 void
 otm_run(input const& in, state& s)
 {
-  lgr::otm_file_writer output_file(in.name);
+  lgr::otm_file_writer output_file(in.name, in.output_format);
   std::cout << std::scientific << std::setprecision(17);
   auto const num_file_output_periods = in.num_file_output_periods;
   auto const file_output_period =
@@ -813,7 +971,7 @@ otm_run(input const& in, state& s)
         ++file_output_index;
       }
       if (s.n >= s.num_time_steps) continue;
-      if (in.enable_adapt && (s.n % 10 == 0)) { otm_adapt(in, s); }
+      if (in.enable_adapt && (s.n % 10 == 0) && otm_adapt(in, s)) ++s.adapt_epoch;
       otm_time_integrator_step(in, s);
     }
   } else {
@@ -837,10 +995,11 @@ otm_run(input const& in, state& s)
         ++file_output_index;
         s.next_file_output_time = double(file_output_index) * file_output_period;
       }
-      if (in.enable_adapt && (s.n % 10 == 0)) { otm_adapt(in, s); }
+      if (in.enable_adapt && (s.n % 10 == 0) && otm_adapt(in, s)) ++s.adapt_epoch;
       otm_time_integrator_step(in, s);
       ++s.n;
     }
   }
+  output_file.flush();
 }
 }  // namespace lgr
@@ -1,4 +1,5 @@
 #include <cassert>
+#include <cstdint>
 #include <fstream>
 #include <hpc_array_vector.hpp>
 #include <hpc_range.hpp>
@@ -8,15 +9,17 @@
 #include <lgr_vtk_util.hpp>
 #include <otm_vtk.hpp>
 #include <sstream>
+#include <utility>
 
 namespace lgr {
 
 void
 otm_file_writer::capture(state const& s)
 {
-  host_s.nodes  = s.nodes;
-  host_s.points = s.points;
-  host_s.time   = s.time;
+  host_s.nodes       = s.nodes;
+  host_s.points      = s.points;
+  host_s.time        = s.time;
+  host_s.adapt_epoch = s.adapt_epoch;
 
   auto const num_points = s.points.size();
   auto const num_nodes  = s.nodes.size();
@@ -66,8 +69,64 @@ otm_file_writer::capture(state const& s)
   }
 }
 
-void
-otm_file_writer::write(int const file_output_index)
+template <class File>
+static void
+describe_node_output(File& file, otm_host_pinned_output_state const& host_s)
+{
+  file.set_points(host_s.x);
+  file.set_no_cells();
+  file.add_point_data("node_position", host_s.x);
+  file.add_point_data("node_displacement", host_s.u);
+  file.add_point_data("node_velocity", host_s.v);
+  file.add_point_data("node_mass", host_s.mass);
+}
+
+template <class File>
+static void
+describe_point_output(File& file, otm_host_pinned_output_state const& host_s)
+{
+  file.set_points(host_s.xp);
+  file.set_no_cells();
+  file.add_point_data("point_position", host_s.xp);
+  file.add_point_data("density", host_s.rho);
+  file.add_point_data("volume", host_s.V);
+  file.add_point_data("sigma", host_s.sigma);
+  file.add_point_data("deformation_gradient", host_s.F_total);
+  file.add_point_data("G", host_s.G);
+  file.add_point_data("K", host_s.K);
+  file.add_point_data("potential_density", host_s.potential_density);
+  if (host_s.Fp_total.size() > 0) { file.add_point_data("plastic_deformation_gradient", host_s.Fp_total); }
+  if (host_s.ep.size() > 0) { file.add_point_data("ep", host_s.ep); }
+  if (host_s.ep_dot.size() > 0) { file.add_point_data("ep_dot", host_s.ep_dot); }
+}
+
+static void
+write_vtu_files(std::string const& prefix, otm_host_pinned_output_state const& host_s, int const file_output_index)
+{
+  vtu_file node_file(std::int64_t(host_s.nodes.size()), 0);
+  describe_node_output(node_file, host_s);
+  node_file.write(make_vtu_filename(prefix + "_nodes", file_output_index));
+
+  vtu_file point_file(std::int64_t(host_s.points.size()), 0);
+  describe_point_output(point_file, host_s);
+  point_file.write(make_vtu_filename(prefix + "_points", file_output_index));
+}
+
+static void
+write_xdmf_steps(
+    xdmf_series& node_series, xdmf_series& point_series, otm_host_pinned_output_state const& host_s)
+{
+  node_series.begin_step(double(host_s.time), std::int64_t(host_s.nodes.size()), host_s.adapt_epoch);
+  describe_node_output(node_series, host_s);
+  node_series.end_step();
+
+  point_series.begin_step(double(host_s.time), std::int64_t(host_s.points.size()), host_s.adapt_epoch);
+  describe_point_output(point_series, host_s);
+  point_series.end_step();
+}
+
+static void
+write_vtk_files(std::string const& prefix, otm_host_pinned_output_state const& host_s, int const file_output_index)
 {
   auto node_stream  = make_vtk_output_stream(prefix + "_nodes", file_output_index);
   auto point_stream = make_vtk_output_stream(prefix + "_points", file_output_index);
@@ -104,6 +163,27 @@ otm_file_writer::write(int const file_output_index)
   point_stream.close();
 }
 
+void
+otm_file_writer::write(int const file_output_index)
+{
+  writer_thread.wait();
+  std::swap(host_s, in_flight);
+  writer_thread.submit([this, file_output_index]() {
+    switch (format) {
+      case VTK_ASCII: write_vtk_files(prefix, in_flight, file_output_index); break;
+      case VTU_BINARY: write_vtu_files(prefix, in_flight, file_output_index); break;
+      case XDMF_SERIES: write_xdmf_steps(node_series, point_series, in_flight); break;
+      case EXODUS: break;
+    }
+  });
+}
+
+void
+otm_file_writer::flush()
+{
+  writer_thread.wait();
+}
+
 void
 otm_file_writer::to_console()
 {
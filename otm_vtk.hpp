@@ -3,8 +3,12 @@
 #include <hpc_array_vector.hpp>
 #include <hpc_dimensional.hpp>
 #include <hpc_range.hpp>
+#include <lgr_input.hpp>
 #include <lgr_mesh_indices.hpp>
+#include <lgr_output_thread.hpp>
+#include <lgr_xdmf.hpp>
 #include <otm_host_pinned_state.hpp>
+#include <stdexcept>
 #include <string>
 
 namespace lgr {
@@ -17,6 +21,7 @@ struct otm_host_pinned_output_state : public otm_host_pinned_state
   hpc::counting_range<point_index> points{point_index(0)};
 
   hpc::time<double> time;
+  int               adapt_epoch{0};
 
   hpc::pinned_array_vector<hpc::displacement<double>, node_index> u;
   hpc::pinned_array_vector<hpc::velocity<double>, node_index>     v;
@@ -32,17 +37,30 @@ struct otm_host_pinned_output_state : public otm_host_pinned_state
   hpc::pinned_vector<hpc::energy_density<double>, point_index>             potential_density;
 };
 
+// Double-buffered like file_writer: write() serializes the captured frame on a
+// background thread while the next capture fills the other buffer.
 class otm_file_writer
 {
-  std::string prefix;
+  std::string                  prefix;
+  output_format_kind           format;
+  otm_host_pinned_output_state in_flight;
+  xdmf_series                  node_series;
+  xdmf_series                  point_series;
+  output_thread                writer_thread;
 
  public:
-  otm_file_writer(std::string const& prefix_in) : prefix(prefix_in) {}
+  otm_file_writer(std::string const& prefix_in, output_format_kind const format_in = VTK_ASCII)
+      : prefix(prefix_in), format(format_in), node_series(prefix_in + "_nodes"), point_series(prefix_in + "_points")
+  {
+    if (format == EXODUS) throw std::runtime_error("Exodus output needs an element mesh, not OTM points");
+  }
   void
   capture(state const& s);
   void
   write(int const file_output_index);
   void
+  flush();
+  void
   to_console();
 
   otm_host_pinned_output_state host_s;
@@ -1,6 +1,13 @@
 #include <gtest/gtest.h>
 #include <gtest/internal/gtest-internal.h>
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <map>
+#include <set>
+#include <vector>
+
 #include <hpc_array.hpp>
 #include <hpc_array_vector.hpp>
 #include <hpc_dimensional.hpp>
@@ -11,8 +18,14 @@
 #include <hpc_range.hpp>
 #include <hpc_range_sum.hpp>
 #include <hpc_vector.hpp>
+#include <lgr_adapt.hpp>
 #include <lgr_adapt_util.hpp>
+#include <lgr_domain.hpp>
+#include <lgr_element_specific_inline.hpp>
+#include <lgr_input.hpp>
 #include <lgr_mesh_indices.hpp>
+#include <lgr_meshing.hpp>
+#include <lgr_physics.hpp>
 #include <lgr_state.hpp>
 #include <otm_adapt.hpp>
 #include <otm_adapt_util.hpp>
@@ -32,7 +45,10 @@ class adapt : public ::testing::Test
   void
   SetUp() override
   {
+#ifdef LGR_ENABLE_SEARCH
+    // only the meshless tests search, the mesh tests below also run without ArborX
     lgr_unit::arborx_testing_singleton::instance();
+#endif
   }
 };
 
@@ -356,3 +372,494 @@ TEST_F(adapt, performance_test_adapt)
 
   EXPECT_TRUE(otm_adapt(in, s));
 }
+
+namespace {
+
+inline hpc::array<hpc::position<double>, 4>
+host_tetrahedron_x(
+    hpc::pinned_array_vector<hpc::position<double>, node_index> const& x,
+    hpc::pinned_vector<node_index, element_node_index> const&          elements_to_nodes,
+    element_index const                                                element)
+{
+  hpc::array<hpc::position<double>, 4> element_x;
+  for (int i = 0; i < 4; ++i) {
+    element_x[i] = x[elements_to_nodes[element_node_index(hpc::weaken(element) * 4 + i)]].load();
+  }
+  return element_x;
+}
+
+struct tetrahedron_mesh_check
+{
+  hpc::volume<double> min_volume   = hpc::numeric_limits<double>::max();
+  hpc::volume<double> total_volume = 0.0;
+  int                 bad_faces    = 0;  // shared by more than two tets, or shared by one but not on the boundary
+};
+
+// on_boundary tells from the positions of its nodes whether a face lies on the boundary of the domain
+template <class OnBoundary>
+inline tetrahedron_mesh_check
+check_tetrahedron_mesh(state const& s, OnBoundary on_boundary)
+{
+  hpc::pinned_array_vector<hpc::position<double>, node_index> x(s.nodes.size());
+  hpc::copy(s.x, x);
+  hpc::pinned_vector<node_index, element_node_index> elements_to_nodes(s.elements_to_nodes.size());
+  hpc::copy(s.elements_to_nodes, elements_to_nodes);
+  tetrahedron_mesh_check            check;
+  std::map<std::array<int, 3>, int> face_counts;
+  for (auto const element : s.elements) {
+    auto const volume  = tetrahedron_volume(host_tetrahedron_x(x, elements_to_nodes, element));
+    check.min_volume   = hpc::min(check.min_volume, volume);
+    check.total_volume = check.total_volume + volume;
+    for (int skipped = 0; skipped < 4; ++skipped) {
+      std::array<int, 3> face;
+      int                n = 0;
+      for (int i = 0; i < 4; ++i) {
+        if (i != skipped) face[n++] = hpc::weaken(elements_to_nodes[element_node_index(hpc::weaken(element) * 4 + i)]);
+      }
+      std::sort(face.begin(), face.end());
+      ++face_counts[face];
+    }
+  }
+  for (auto const& face_count : face_counts) {
+    auto const& face = face_count.first;
+    if (face_count.second > 2) ++check.bad_faces;
+    if (face_count.second == 1 &&
+        !on_boundary(x[node_index(face[0])].load(), x[node_index(face[1])].load(), x[node_index(face[2])].load()))
+      ++check.bad_faces;
+  }
+  return check;
+}
+
+inline bool
+on_unit_box_boundary(hpc::position<double> const a, hpc::position<double> const b, hpc::position<double> const c)
+{
+  for (int axis = 0; axis < 3; ++axis) {
+    for (double const side : {0.0, 1.0}) {
+      if (std::abs(a(axis) - side) < 1.0e-12 && std::abs(b(axis) - side) < 1.0e-12 &&
+          std::abs(c(axis) - side) < 1.0e-12)
+        return true;
+    }
+  }
+  return false;
+}
+
+inline void
+adapt_mesh_to(input const& in, state& s, hpc::length<double> const h)
+{
+  resize_state(in, s);
+  hpc::fill(hpc::device_policy(), s.h_adapt, h);
+  hpc::fill(hpc::device_policy(), s.quality, double(1.0));
+  ASSERT_TRUE(lgr::adapt(in, s));
+}
+
+// the faces of the unit box are boundaries, so adapt() keeps its shape
+inline void
+build_single_material_box(input& in, state& s, element_kind const element)
+{
+  int const dimension = element == TRIANGLE ? 2 : 3;
+  assert(in.boundaries.size() == material_index(2 * dimension));
+  for (int axis = 0; axis < dimension; ++axis) {
+    auto normal  = hpc::vector3<double>::zero();
+    normal(axis) = 1.0;
+    for (int side = 0; side < 2; ++side) {
+      material_index const boundary(1 + 2 * axis + side);
+      in.domains[boundary] = epsilon_around_plane_domain({normal, double(side)}, 1.0e-10);
+    }
+  }
+  in.element                = element;
+  in.elements_along_x       = 2;
+  in.elements_along_y       = 2;
+  in.elements_along_z       = 2;
+  in.output_to_command_line = false;
+  in.enable_adapt           = true;
+  build_mesh(in, s);
+  s.material.resize(s.elements.size());
+  hpc::fill(hpc::device_policy(), s.material, material_index(0));
+  compute_nodal_materials(in, s);
+}
+
+}  // namespace
+
+TEST_F(adapt, tetrahedron_splits_then_collapses_keep_a_conforming_mesh)
+{
+  input in(material_index(1), material_index(6));
+  state s;
+  build_single_material_box(in, s, TETRAHEDRON);
+  auto const initial_elements = s.elements.size();
+
+  adapt_mesh_to(in, s, 0.2);
+  auto const refined_elements = s.elements.size();
+  EXPECT_GT(refined_elements, initial_elements);
+  auto const refined = check_tetrahedron_mesh(s, on_unit_box_boundary);
+  EXPECT_GT(refined.min_volume, 0.0);
+  EXPECT_NEAR(refined.total_volume, 1.0, 1.0e-12);
+  EXPECT_EQ(refined.bad_faces, 0);
+
+  adapt_mesh_to(in, s, 2.0);
+  EXPECT_LT(s.elements.size(), refined_elements);
+  auto const coarsened = check_tetrahedron_mesh(s, on_unit_box_boundary);
+  EXPECT_GT(coarsened.min_volume, 0.0);
+  EXPECT_NEAR(coarsened.total_volume, 1.0, 1.0e-12);
+  EXPECT_EQ(coarsened.bad_faces, 0);
+}
+
+TEST_F(adapt, tetrahedron_swap_replaces_three_tets_by_two)
+{
+  // three tets around the long edge between the apexes of a bipyramid, two would be better shaped
+  double const half_height = 0.8;
+  input        in(material_index(1), material_index(0));
+  in.element                = TETRAHEDRON;
+  in.output_to_command_line = false;
+  in.enable_adapt           = true;
+  state s;
+  s.nodes.resize(node_index(5));
+  s.elements.resize(element_index(3));
+  s.nodes_in_element.resize(node_in_element_index(4));
+  hpc::pinned_array_vector<hpc::position<double>, node_index> x(s.nodes.size());
+  for (int i = 0; i < 3; ++i) {
+    double const angle = 2.0 * std::acos(-1.0) * double(i) / 3.0;
+    x[node_index(i)]   = hpc::position<double>(std::cos(angle), std::sin(angle), 0.0);
+  }
+  x[node_index(3)] = hpc::position<double>(0.0, 0.0, half_height);
+  x[node_index(4)] = hpc::position<double>(0.0, 0.0, -half_height);
+  hpc::pinned_vector<node_index, element_node_index> elements_to_nodes(s.elements.size() * s.nodes_in_element.size());
+  for (auto const element : s.elements) {
+    int const i            = hpc::weaken(element);
+    int       tet_nodes[4] = {i, (i + 1) % 3, 3, 4};
+    hpc::array<hpc::position<double>, 4> tet_x;
+    for (int j = 0; j < 4; ++j) tet_x[j] = x[node_index(tet_nodes[j])].load();
+    if (tetrahedron_volume(tet_x) < 0.0) std::swap(tet_nodes[2], tet_nodes[3]);
+    for (int j = 0; j < 4; ++j) elements_to_nodes[element_node_index(4 * i + j)] = node_index(tet_nodes[j]);
+  }
+  s.x.resize(s.nodes.size());
+  hpc::copy(x, s.x);
+  s.elements_to_nodes.resize(elements_to_nodes.size());
+  hpc::copy(elements_to_nodes, s.elements_to_nodes);
+  propagate_connectivity(s);
+  s.material.resize(s.elements.size());
+  hpc::fill(hpc::device_policy(), s.material, material_index(0));
+  compute_nodal_materials(in, s);
+  // hull faces have exactly one apex
+  auto const on_hull = [](hpc::position<double> const a, hpc::position<double> const b, hpc::position<double> const c) {
+    return int(a(2) != 0.0) + int(b(2) != 0.0) + int(c(2) != 0.0) == 1;
+  };
+  auto const before = check_tetrahedron_mesh(s, on_hull);
+  ASSERT_EQ(before.bad_faces, 0);
+
+  // every edge is of acceptable length, so the swap is the only operation
+  adapt_mesh_to(in, s, 1.5);
+  EXPECT_EQ(s.elements.size(), element_index(2));
+  EXPECT_EQ(s.nodes.size(), node_index(5));
+  auto const after = check_tetrahedron_mesh(s, on_hull);
+  EXPECT_GT(after.min_volume, 0.0);
+  EXPECT_NEAR(after.total_volume, before.total_volume, 1.0e-12);
+  EXPECT_EQ(after.bad_faces, 0);
+}
+
+namespace {
+
+// how far the node-to-element adjacency adapt() left in s is from what
+// propagate_connectivity builds from scratch on a copy of its elements
+inline int
+count_adapted_connectivity_mismatches(state const& s)
+{
+  state rebuilt;
+  rebuilt.nodes.resize(s.nodes.size());
+  rebuilt.elements.resize(s.elements.size());
+  rebuilt.nodes_in_element.resize(s.nodes_in_element.size());
+  rebuilt.points_in_element.resize(s.points_in_element.size());
+  rebuilt.elements_to_nodes.resize(s.elements_to_nodes.size());
+  hpc::copy(s.elements_to_nodes, rebuilt.elements_to_nodes);
+  propagate_connectivity(rebuilt);
+  if (rebuilt.node_elements_to_elements.size() != s.node_elements_to_elements.size()) return -1;
+  auto const adapted_nodes_to_node_elements    = s.nodes_to_node_elements.cbegin();
+  auto const rebuilt_nodes_to_node_elements    = rebuilt.nodes_to_node_elements.cbegin();
+  auto const adapted_node_elements_to_elements = s.node_elements_to_elements.cbegin();
+  auto const rebuilt_node_elements_to_elements = rebuilt.node_elements_to_elements.cbegin();
+  auto const adapted_node_elements_to_nodes_in = s.node_elements_to_nodes_in_element.cbegin();
+  auto const rebuilt_node_elements_to_nodes_in = rebuilt.node_elements_to_nodes_in_element.cbegin();
+  auto       node_mismatches                   = [=] HPC_DEVICE(node_index const node) {
+    auto const adapted_node_elements = adapted_nodes_to_node_elements[node];
+    auto const rebuilt_node_elements = rebuilt_nodes_to_node_elements[node];
+    if (adapted_node_elements.size() != rebuilt_node_elements.size()) return 1;
+    int count = 0;
+    for (node_element_index i(0); i < adapted_node_elements.size(); ++i) {
+      auto const adapted_node_element = adapted_node_elements[i];
+      auto const rebuilt_node_element = rebuilt_node_elements[i];
+      if (adapted_node_elements_to_elements[adapted_node_element] !=
+          rebuilt_node_elements_to_elements[rebuilt_node_element])
+        ++count;
+      if (adapted_node_elements_to_nodes_in[adapted_node_element] !=
+          rebuilt_node_elements_to_nodes_in[rebuilt_node_element])
+        ++count;
+    }
+    return count;
+  };
+  return hpc::transform_reduce(hpc::device_policy(), s.nodes, 0, hpc::plus<int>(), node_mismatches);
+}
+
+}  // namespace
+
+TEST_F(adapt, adapted_connectivity_matches_rebuilt_connectivity)
+{
+  for (auto const element : {TRIANGLE, TETRAHEDRON}) {
+    input in(material_index(1), material_index(element == TRIANGLE ? 4 : 6));
+    state s;
+    build_single_material_box(in, s, element);
+    auto const initial_elements = s.elements.size();
+    adapt_mesh_to(in, s, 0.2);
+    EXPECT_GT(s.elements.size(), initial_elements);
+    EXPECT_EQ(count_adapted_connectivity_mismatches(s), 0);
+    auto const refined_elements = s.elements.size();
+    adapt_mesh_to(in, s, 2.0);
+    EXPECT_LT(s.elements.size(), refined_elements);
+    EXPECT_EQ(count_adapted_connectivity_mismatches(s), 0);
+  }
+}
+
+namespace {
+
+// for each node, the other nodes of the elements around it
+inline std::vector<std::set<int>>
+host_node_neighbors(state const& s)
+{
+  hpc::pinned_vector<node_index, element_node_index> elements_to_nodes(s.elements_to_nodes.size());
+  hpc::copy(s.elements_to_nodes, elements_to_nodes);
+  int const                  nodes_per_element = int(hpc::weaken(s.nodes_in_element.size()));
+  std::vector<std::set<int>> neighbors(std::size_t(hpc::weaken(s.nodes.size())));
+  for (auto const element : s.elements) {
+    auto const first = hpc::weaken(element) * nodes_per_element;
+    for (int i = 0; i < nodes_per_element; ++i) {
+      auto const node = int(hpc::weaken(elements_to_nodes[element_node_index(first + i)]));
+      for (int j = 0; j < nodes_per_element; ++j) {
+        auto const other = int(hpc::weaken(elements_to_nodes[element_node_index(first + j)]));
+        if (other != node) neighbors[std::size_t(node)].insert(other);
+      }
+    }
+  }
+  return neighbors;
+}
+
+inline std::vector<bool>
+host_choose_independent_cavities(state const& s, std::vector<double> const& host_criteria)
+{
+  hpc::pinned_vector<double, node_index> pinned_criteria(s.nodes.size());
+  for (auto const node : s.nodes) pinned_criteria[node] = host_criteria[std::size_t(hpc::weaken(node))];
+  hpc::device_vector<double, node_index> criteria(s.nodes.size());
+  hpc::copy(pinned_criteria, criteria);
+  hpc::device_vector<bool, node_index> is_chosen;
+  choose_independent_cavities(s, criteria, is_chosen);
+  hpc::pinned_vector<bool, node_index> pinned_is_chosen(s.nodes.size());
+  hpc::copy(is_chosen, pinned_is_chosen);
+  std::vector<bool> chosen;
+  for (auto const node : s.nodes) chosen.push_back(pinned_is_chosen[node]);
+  return chosen;
+}
+
+// the triangles of s with node n renamed permutation[n], listed in reverse order
+inline void
+renumber_triangles(state const& s, std::vector<int> const& permutation, state& renumbered)
+{
+  renumbered.nodes.resize(s.nodes.size());
+  renumbered.elements.resize(s.elements.size());
+  renumbered.nodes_in_element.resize(s.nodes_in_element.size());
+  renumbered.points_in_element.resize(s.points_in_element.size());
+  hpc::pinned_vector<node_index, element_node_index> elements_to_nodes(s.elements_to_nodes.size());
+  hpc::copy(s.elements_to_nodes, elements_to_nodes);
+  hpc::pinned_vector<node_index, element_node_index> renumbered_elements_to_nodes(s.elements_to_nodes.size());
+  int const                                          num_elements = int(hpc::weaken(s.elements.size()));
+  for (int element = 0; element < num_elements; ++element) {
+    for (int i = 0; i < 3; ++i) {
+      auto const node = hpc::weaken(elements_to_nodes[element_node_index(3 * element + i)]);
+      renumbered_elements_to_nodes[element_node_index(3 * (num_elements - 1 - element) + i)] =
+          node_index(permutation[std::size_t(node)]);
+    }
+  }
+  renumbered.elements_to_nodes.resize(renumbered_elements_to_nodes.size());
+  hpc::copy(renumbered_elements_to_nodes, renumbered.elements_to_nodes);
+  propagate_connectivity(renumbered);
+}
+
+}  // namespace
+
+TEST_F(adapt, independent_cavities_are_maximal_and_independent_of_traversal_order)
+{
+  input in(material_index(1), material_index(0));
+  in.element                = TRIANGLE;
+  in.elements_along_x       = 4;
+  in.elements_along_y       = 4;
+  in.output_to_command_line = false;
+  state s;
+  build_mesh(in, s);
+  int const num_nodes = int(hpc::weaken(s.nodes.size()));
+  ASSERT_EQ(num_nodes, 25);
+  auto const host_size = std::size_t(num_nodes);
+  // Criteria grow with the node number, so a round only has winners at the
+  // top of each run of candidates and the selection takes several rounds.
+  // They are distinct, so no tie falls back to node numbers. The middle
+  // column of nodes has no candidates.
+  std::vector<double> criteria(host_size);
+  for (int node = 0; node < num_nodes; ++node) criteria[std::size_t(node)] = node % 5 == 2 ? 0.0 : 1.0 + double(node);
+  auto const chosen         = host_choose_independent_cavities(s, criteria);
+  auto const neighbors      = host_node_neighbors(s);
+  int        num_candidates = 0;
+  int        num_chosen     = 0;
+  for (int node = 0; node < num_nodes; ++node) {
+    auto const n = std::size_t(node);
+    if (criteria[n] == 0.0) {
+      EXPECT_FALSE(chosen[n]) << "node " << node;
+      continue;
+    }
+    ++num_candidates;
+    auto next_to_chosen = false;
+    for (auto const neighbor : neighbors[n]) next_to_chosen = next_to_chosen || chosen[std::size_t(neighbor)];
+    if (chosen[n]) {
+      ++num_chosen;
+      EXPECT_FALSE(next_to_chosen) << "chosen node " << node << " is adjacent to another chosen node";
+    } else {
+      EXPECT_TRUE(next_to_chosen) << "node " << node << " could still be chosen";
+    }
+  }
+  // the candidates do not all fit in one independent set
+  EXPECT_GT(num_chosen, 0);
+  EXPECT_LT(num_chosen, num_candidates);
+
+  // the same mesh with renumbered nodes and reversed elements is traversed in another order
+  std::vector<int> permutation(host_size);
+  for (int node = 0; node < num_nodes; ++node) permutation[std::size_t(node)] = (7 * node + 3) % num_nodes;
+  state renumbered;
+  renumber_triangles(s, permutation, renumbered);
+  std::vector<double> renumbered_criteria(host_size);
+  for (int node = 0; node < num_nodes; ++node) {
+    renumbered_criteria[std::size_t(permutation[std::size_t(node)])] = criteria[std::size_t(node)];
+  }
+  auto const renumbered_chosen = host_choose_independent_cavities(renumbered, renumbered_criteria);
+  for (int node = 0; node < num_nodes; ++node) {
+    EXPECT_EQ(renumbered_chosen[std::size_t(permutation[std::size_t(node)])], chosen[std::size_t(node)]) << "node "
+                                                                                                         << node;
+  }
+}
+
+namespace {
+
+inline void
+zero_initial_v(
+    hpc::counting_range<node_index> const,
+    hpc::device_array_vector<hpc::position<double>, node_index> const&,
+    hpc::device_array_vector<hpc::velocity<double>, node_index>* v)
+{
+  hpc::fill(hpc::device_policy(), *v, hpc::velocity<double>::zero());
+}
+
+// two ideal gases side by side in a unit square, boundaries on all four sides
+inline void
+build_two_gas_triangle_box(input& in)
+{
+  constexpr material_index left(0);
+  constexpr material_index right(1);
+  in.element                     = TRIANGLE;
+  in.elements_along_x            = 4;
+  in.elements_along_y            = 4;
+  in.output_to_command_line      = false;
+  in.enable_adapt                = true;
+  in.enable_viscosity            = true;
+  in.linear_artificial_viscosity = 0.5;
+  in.initial_v                   = zero_initial_v;
+  for (auto const material : {left, right}) {
+    in.enable_ideal_gas[material] = true;
+    in.c_tau[material]            = 1.0;
+  }
+  in.rho0[left]     = 1.0;
+  in.rho0[right]    = 0.125;
+  in.gamma[left]    = 1.4;
+  in.gamma[right]   = 1.5;
+  in.e0[left]       = 2.0;
+  in.e0[right]      = 0.25;
+  double const eps  = 1.0e-10;
+  in.domains[left]  = box_domain({0.0, 0.0, -eps}, {0.5, 1.0, eps});
+  in.domains[right] = box_domain({0.5, 0.0, -eps}, {1.0, 1.0, eps});
+  for (int axis = 0; axis < 2; ++axis) {
+    auto normal  = hpc::vector3<double>::zero();
+    normal(axis) = 1.0;
+    for (int side = 0; side < 2; ++side) {
+      material_index const boundary(2 + 2 * axis + side);
+      in.domains[boundary] = epsilon_around_plane_domain({normal, double(side)}, eps);
+      in.zero_acceleration_conditions.push_back({boundary, normal});
+    }
+  }
+}
+
+// everything run() does up to the reinitialization that follows a successful adapt()
+inline void
+initialize_then_adapt(input const& in, state& s)
+{
+  build_mesh(in, s);
+  initialize_state(in, s);
+  hpc::fill(hpc::device_policy(), s.h_adapt, hpc::length<double>(0.15));
+  ASSERT_TRUE(lgr::adapt(in, s));
+  resize_state(in, s);
+  resize_material_nodal_state(in, s);
+  collect_element_sets(in, s);
+}
+
+template <class T, class Index>
+inline double
+max_relative_difference(hpc::device_vector<T, Index> const& a, hpc::device_vector<T, Index> const& b)
+{
+  if (a.size() != b.size()) return hpc::numeric_limits<double>::max();
+  hpc::pinned_vector<T, Index> host_a(a.size());
+  hpc::pinned_vector<T, Index> host_b(b.size());
+  hpc::copy(a, host_a);
+  hpc::copy(b, host_b);
+  double result = 0.0;
+  for (Index i(0); i < a.size(); ++i) {
+    double const value_a = double(host_a[i]);
+    double const value_b = double(host_b[i]);
+    result = std::max(result, std::abs(value_a - value_b) / std::max(std::abs(value_a) + std::abs(value_b), 1.0e-300));
+  }
+  return result;
+}
+
+template <class T, class Index>
+inline double
+max_relative_difference(hpc::device_array_vector<T, Index> const& a, hpc::device_array_vector<T, Index> const& b)
+{
+  if (a.size() != b.size()) return hpc::numeric_limits<double>::max();
+  hpc::pinned_array_vector<T, Index> host_a(a.size());
+  hpc::pinned_array_vector<T, Index> host_b(b.size());
+  hpc::copy(a, host_a);
+  hpc::copy(b, host_b);
+  double result = 0.0;
+  for (Index i(0); i < a.size(); ++i) {
+    T const value_a = host_a[i].load();
+    T const value_b = host_b[i].load();
+    double const scale = std::max(double(norm(value_a) + norm(value_b)), 1.0e-300);
+    result             = std::max(result, double(norm(value_a - value_b)) / scale);
+  }
+  return result;
+}
+
+}  // namespace
+
+TEST_F(adapt, reinitialize_adapted_matches_full_reinitialization)
+{
+  input in(material_index(2), material_index(4));
+  build_two_gas_triangle_box(in);
+  ASSERT_TRUE(can_reinitialize_adapted(in));
+  state partial;
+  initialize_then_adapt(in, partial);
+  state full;
+  initialize_then_adapt(in, full);
+  ASSERT_EQ(partial.elements.size(), full.elements.size());
+  ASSERT_GT(partial.adapted_element_sets.all().size(), element_index(0));
+
+  reinitialize_adapted(in, partial);
+  common_initialization_part1(in, full);
+  common_initialization_part2(in, full);
+  double const tolerance = 1.0e-12;
+  EXPECT_LT(max_relative_difference(partial.V, full.V), tolerance);
+  EXPECT_LT(max_relative_difference(partial.grad_N, full.grad_N), tolerance);
+  EXPECT_LT(max_relative_difference(partial.mass, full.mass), tolerance);
+  EXPECT_LT(max_relative_difference(partial.c, full.c), tolerance);
+  EXPECT_LT(max_relative_difference(partial.element_dt, full.element_dt), tolerance);
+}
@@ -0,0 +1,66 @@
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <hpc_algorithm.hpp>
+#include <hpc_array_vector.hpp>
+#include <hpc_vector.hpp>
+#include <lgr_checkpoint.hpp>
+#include <lgr_input.hpp>
+#include <lgr_state.hpp>
+#include <otm_meshless.hpp>
+#include <unit_tests/otm_unit_mesh.hpp>
+
+TEST(checkpoint, canRestoreOtmState)
+{
+  lgr::state s;
+  using MI = lgr::material_index;
+  lgr::input in(MI(1), MI(0));
+
+  tetrahedron_single_point(s);
+  lgr::otm_update_nodal_mass(s);
+  lgr::otm_allocate_state(in, s);
+  s.n           = 42;
+  s.time        = 1.5e-3;
+  s.adapt_epoch = 3;
+  hpc::fill(hpc::device_policy(), s.v, hpc::velocity<double>(1.0, 2.0, 3.0));
+  s.p_h.resize(in.materials.size());
+  s.p_h[MI(0)].resize(s.nodes.size());
+  hpc::fill(hpc::device_policy(), s.p_h[MI(0)], hpc::pressure<double>(7.0));
+
+  lgr::write_checkpoint("checkpoint_single_point.ckpt", s);
+  lgr::state r;
+  lgr::read_checkpoint("checkpoint_single_point.ckpt", r);
+  unlink("checkpoint_single_point.ckpt");
+
+  ASSERT_EQ(r.n, s.n);
+  ASSERT_EQ(r.time, s.time);
+  ASSERT_EQ(r.adapt_epoch, s.adapt_epoch);
+  ASSERT_EQ(r.nodes.size(), s.nodes.size());
+  ASSERT_EQ(r.points.size(), s.points.size());
+  ASSERT_EQ(r.points_to_point_nodes.size(), s.points_to_point_nodes.size());
+  ASSERT_EQ(r.point_nodes_to_nodes.size(), s.point_nodes_to_nodes.size());
+  ASSERT_EQ(r.x.size(), s.x.size());
+  ASSERT_EQ(r.mass.size(), s.mass.size());
+  ASSERT_EQ(r.p_h.size(), s.p_h.size());
+  ASSERT_EQ(r.p_h[MI(0)].size(), s.nodes.size());
+
+  for (auto const point : s.points) {
+    ASSERT_EQ(r.points_to_point_nodes[point].size(), s.points_to_point_nodes[point].size());
+    for (auto const point_node : s.points_to_point_nodes[point]) {
+      ASSERT_EQ(r.point_nodes_to_nodes[point_node], s.point_nodes_to_nodes[point_node]);
+    }
+    ASSERT_EQ(hpc::norm(r.xp[point].load() - s.xp[point].load()), 0.0);
+  }
+  for (auto const node : s.nodes) {
+    ASSERT_EQ(hpc::norm(r.x[node].load() - s.x[node].load()), 0.0);
+    ASSERT_EQ(hpc::norm(r.v[node].load() - s.v[node].load()), 0.0);
+    ASSERT_EQ(r.mass[node], s.mass[node]);
+    ASSERT_EQ(r.p_h[MI(0)][node], 7.0);
+  }
+}
+
+TEST(checkpoint, rejectsMissingFile)
+{
+  lgr::state s;
+  ASSERT_THROW(lgr::read_checkpoint("does_not_exist.ckpt", s), std::runtime_error);
+}
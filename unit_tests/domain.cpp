@@ -0,0 +1,94 @@
+#include <gtest/gtest.h>
+
+#include <hpc_array_vector.hpp>
+#include <hpc_vector.hpp>
+#include <hpc_vector3.hpp>
+#include <lgr_domain.hpp>
+#include <lgr_entity_sets.hpp>
+#include <random>
+
+using namespace lgr;
+
+TEST(domain, binnedMarkingMatchesMarkingEachDomain)
+{
+  int const                                                   n = 5000;
+  hpc::pinned_array_vector<hpc::position<double>, node_index> host_points(n);
+  std::mt19937                                                gen(42);
+  std::uniform_real_distribution<double>                      dist(-1.0, 2.0);
+  for (int i = 0; i < n; ++i) { host_points[i] = hpc::position<double>(dist(gen), dist(gen), 0.5 * dist(gen)); }
+  // points exactly on domain boundaries must be marked too
+  host_points[0] = hpc::position<double>(0.0, 0.0, 0.0);
+  host_points[1] = hpc::position<double>(1.0, 0.5, 0.25);
+  hpc::device_array_vector<hpc::position<double>, node_index> points(n);
+  hpc::copy(host_points, points);
+
+  hpc::host_vector<std::unique_ptr<domain>, material_index> domains(material_index(6));
+  domains[material_index(0)] = box_domain(hpc::position<double>(0.0, 0.0, 0.0), hpc::position<double>(1.0, 1.0, 1.0));
+  domains[material_index(1)] = sphere_domain(hpc::position<double>(1.5, 0.5, 0.0), 0.4);
+  domains[material_index(2)] = epsilon_around_plane_domain({hpc::vector3<double>(0.6, 0.8, 0.0), 0.5}, 0.05);
+  domains[material_index(3)] = half_space_domain({hpc::vector3<double>(0.0, 0.0, -1.0), -0.25});
+  auto cyl = std::make_unique<clipped_domain<cylinder>>(cylinder{hpc::vector3<double>::z_axis(), {0.0, 1.0, 0.0}, 0.3});
+  cyl->clip({hpc::vector3<double>::z_axis(), 0.0});
+  auto u = std::make_unique<union_domain>();
+  u->add(std::move(cyl));
+  u->add(sphere_domain(hpc::position<double>(-0.5, -0.5, 0.5), 0.2));
+  domains[material_index(5)] = std::move(u);
+  std::vector<material_index> const markers{material_index(0), material_index(1), material_index(2),
+                                            material_index(3), material_index(4), material_index(5)};
+
+  hpc::device_vector<material_set, node_index> expected(n, material_set::none());
+  for (auto const marker : markers) {
+    if (domains[marker]) domains[marker]->mark(points, marker, &expected);
+  }
+  hpc::device_vector<material_set, node_index> binned(n, material_set::none());
+  mark_domains(domains, markers, points, &binned);
+
+  hpc::pinned_vector<material_set, node_index> host_expected(n);
+  hpc::pinned_vector<material_set, node_index> host_binned(n);
+  hpc::copy(expected, host_expected);
+  hpc::copy(binned, host_binned);
+  int marked = 0;
+  for (int i = 0; i < n; ++i) {
+    ASSERT_EQ(std::uint64_t(host_expected[i]), std::uint64_t(host_binned[i]));
+    marked += host_binned[i].size();
+  }
+  EXPECT_GT(marked, n / 4);
+  auto const on_corner = material_set(material_index(0)) | material_set(material_index(3));
+  EXPECT_EQ(std::uint64_t(host_binned[0]), std::uint64_t(on_corner));
+}
+
+TEST(domain, bucketedSetsListTheirItemsInOrder)
+{
+  int const                                    n = 5000;
+  material_index const                         set_count(5);
+  hpc::pinned_vector<material_set, node_index> host_item_sets(n);
+  std::mt19937                                 gen(7);
+  std::uniform_int_distribution<int>           dist(0, 31);
+  for (int i = 0; i < n; ++i) {
+    auto const bits      = dist(gen);
+    auto       item_sets = material_set::none();
+    for (material_index set(0); set < set_count; ++set) {
+      if (bits & (1 << hpc::weaken(set))) item_sets = item_sets | material_set(set);
+    }
+    host_item_sets[i] = item_sets;
+  }
+  hpc::device_vector<material_set, node_index> item_sets(n);
+  hpc::copy(host_item_sets, item_sets);
+  auto const items_to_sets = item_sets.cbegin();
+  auto       sets_functor  = [=] HPC_DEVICE(node_index const node) -> material_set { return items_to_sets[node]; };
+  entity_sets<node_index> sets;
+  bucket_sets(hpc::counting_range<node_index>(n), set_count, sets_functor, sets);
+
+  ASSERT_EQ(sets.size(), set_count);
+  hpc::pinned_vector<node_index, int> host_items(sets.items.size());
+  hpc::copy(sets.items, host_items);
+  for (material_index set(0); set < set_count; ++set) {
+    std::vector<node_index> expected;
+    for (int i = 0; i < n; ++i) {
+      if (host_item_sets[i].contains(material_set(set))) expected.push_back(node_index(i));
+    }
+    ASSERT_EQ(sets[set].size(), int(expected.size()));
+    int const first = sets.offsets[set];
+    for (std::size_t i = 0; i < expected.size(); ++i) ASSERT_EQ(host_items[first + int(i)], expected[i]);
+  }
+}
@@ -16,6 +16,8 @@
 #include <unit_tests/otm_unit_mesh.hpp>
 #include <unit_tests/unit_device_util.hpp>
 
+#include <exodusII.h>
+
 using namespace lgr;
 
 namespace {
@@ -185,3 +187,202 @@ TEST(exodus, convertTetMeshToMeshfreeInterpolateMaterialPoints)
 
   lgr_unit::check_connectivity_sizes(st, 4);
 }
+
+namespace {
+
+// writes two steps of two tets of materials 0 and 1, with pressure 1 and 2 at the second step
+void
+write_two_tets(std::string const& filename, hpc::host_vector<int, material_index> const& block_ids)
+{
+  hpc::pinned_array_vector<hpc::position<double>, node_index> x(5);
+  x[0] = hpc::position<double>(0.0, 0.0, 0.0);
+  x[1] = hpc::position<double>(1.0, 0.0, 0.0);
+  x[2] = hpc::position<double>(0.0, 1.0, 0.0);
+  x[3] = hpc::position<double>(0.0, 0.0, 1.0);
+  x[4] = hpc::position<double>(1.0, 1.0, 1.0);
+  hpc::pinned_vector<node_index, element_node_index> conn(8);
+  int const                                          tets[8] = {0, 1, 2, 3, 1, 4, 2, 3};
+  for (int i = 0; i < 8; ++i) conn[element_node_index(i)] = node_index(tets[i]);
+  hpc::pinned_vector<material_index, element_index>        material(2);
+  hpc::pinned_vector<hpc::pressure<double>, element_index> p(2);
+  material[element_index(0)] = material_index(0);
+  material[element_index(1)] = material_index(1);
+  exodus_writer writer(filename);
+  writer.set_block_ids(block_ids);
+  for (int step = 0; step < 2; ++step) {
+    p[element_index(0)] = double(step) * 1.0;
+    p[element_index(1)] = double(step) * 2.0;
+    writer.begin_step(double(step), 5, 0);
+    writer.set_points(x);
+    writer.set_cells(conn, 4, 10);
+    writer.add_cell_data("pressure", p);
+    writer.set_materials(material);
+    writer.end_step();
+  }
+}
+
+void
+check_two_tets(std::string const& filename, input const& in, int const first_block_id, int const second_block_id)
+{
+  state st;
+  ASSERT_EQ(read_exodus_file(filename, in, st), 0);
+  ASSERT_EQ(st.nodes.size(), nodes_size_type(5));
+  ASSERT_EQ(st.elements.size(), elems_size_type(2));
+
+  hpc::host_array_vector<hpc::position<double>, node_index> x(st.x.size());
+  hpc::copy(st.x, x);
+  EXPECT_EQ(norm(x[node_index(1)].load() - hpc::position<double>(1.0, 0.0, 0.0)), 0.0);
+  EXPECT_EQ(norm(x[node_index(4)].load() - hpc::position<double>(1.0, 1.0, 1.0)), 0.0);
+  hpc::host_vector<material_index, element_index> material(st.material.size());
+  hpc::copy(st.material, material);
+  EXPECT_EQ(material[element_index(0)], material_index(0));
+  EXPECT_EQ(material[element_index(1)], material_index(1));
+
+  int   comp_ws = int(sizeof(double));
+  int   io_ws   = 0;
+  float version = 0.0;
+  int   file    = ex_open(filename.c_str(), EX_READ, &comp_ws, &io_ws, &version);
+  ASSERT_GE(file, 0);
+  int block_ids[2] = {0, 0};
+  ASSERT_EQ(ex_get_ids(file, EX_ELEM_BLOCK, block_ids), 0);
+  EXPECT_EQ(block_ids[0], first_block_id);
+  EXPECT_EQ(block_ids[1], second_block_id);
+  double pressure = 0.0;
+  ASSERT_EQ(ex_get_var(file, 2, EX_ELEM_BLOCK, 1, first_block_id, 1, &pressure), 0);
+  EXPECT_EQ(pressure, 1.0);
+  ASSERT_EQ(ex_get_var(file, 2, EX_ELEM_BLOCK, 1, second_block_id, 1, &pressure), 0);
+  EXPECT_EQ(pressure, 2.0);
+  ex_close(file);
+}
+
+}  // namespace
+
+TEST(exodus, writeAndReadBackTwoMaterials)
+{
+  material_index mat(2);
+  material_index bnd(0);
+  input          in(mat, bnd);
+  in.element = TETRAHEDRON;
+  // without block ids material m is written as block m + 1 and read back from it
+  write_two_tets("two_tets.exo", in.exodus_block_ids);
+  check_two_tets("two_tets.exo", in, 1, 2);
+  in.exodus_block_ids[material_index(0)] = 10;
+  in.exodus_block_ids[material_index(1)] = 20;
+  write_two_tets("two_tets.exo", in.exodus_block_ids);
+  check_two_tets("two_tets.exo", in, 10, 20);
+  unlink("two_tets.exo");
+}
+
+namespace {
+
+// one step of a tet whose fourth node moves up by the time, in the file sequence of adapt_epoch
+void
+write_moving_tet_step(exodus_writer& writer, double const time, int const adapt_epoch)
+{
+  hpc::pinned_array_vector<hpc::position<double>, node_index> x(4);
+  x[0] = hpc::position<double>(0.0, 0.0, 0.0);
+  x[1] = hpc::position<double>(1.0, 0.0, 0.0);
+  x[2] = hpc::position<double>(0.0, 1.0, 0.0);
+  x[3] = hpc::position<double>(0.0, 0.0, 1.0 + time);
+  hpc::pinned_vector<node_index, element_node_index> conn(4);
+  for (int i = 0; i < 4; ++i) conn[element_node_index(i)] = node_index(i);
+  hpc::pinned_vector<material_index, element_index> material(1, material_index(0));
+  writer.begin_step(time, 4, adapt_epoch);
+  writer.set_points(x);
+  writer.set_cells(conn, 4, 10);
+  writer.set_materials(material);
+  writer.end_step();
+}
+
+std::vector<double>
+read_exodus_times(std::string const& filename)
+{
+  int   comp_ws = int(sizeof(double));
+  int   io_ws   = 0;
+  float version = 0.0;
+  int   file    = ex_open(filename.c_str(), EX_READ, &comp_ws, &io_ws, &version);
+  if (file < 0) return {};
+  std::vector<double> times(std::size_t(ex_inquire_int(file, EX_INQ_TIME)));
+  if (!times.empty()) ex_get_all_times(file, times.data());
+  ex_close(file);
+  return times;
+}
+
+}  // namespace
+
+TEST(exodus, resumedWriterAppendsToTheFileOfTheRestartedStep)
+{
+  {
+    exodus_writer writer("resumed_tet.exo");
+    write_moving_tet_step(writer, 0.0, 0);
+    write_moving_tet_step(writer, 1.0, 1);
+    write_moving_tet_step(writer, 2.0, 1);
+  }
+  // restarted from the checkpoint of time 1, which the second file of the sequence holds
+  {
+    exodus_writer writer("resumed_tet.exo");
+    writer.resume(1.0, 1);
+    write_moving_tet_step(writer, 1.5, 1);
+  }
+  auto const first_times = read_exodus_times("resumed_tet.exo");
+  ASSERT_EQ(first_times.size(), 1u);
+  EXPECT_EQ(first_times[0], 0.0);
+  auto const second_times = read_exodus_times("resumed_tet.exo-s0002");
+  ASSERT_EQ(second_times.size(), 2u);
+  EXPECT_EQ(second_times[0], 1.0);
+  EXPECT_EQ(second_times[1], 1.5);
+  // displacements stay relative to the coordinates the file was created with
+  int   comp_ws = int(sizeof(double));
+  int   io_ws   = 0;
+  float version = 0.0;
+  int   file    = ex_open("resumed_tet.exo-s0002", EX_READ, &comp_ws, &io_ws, &version);
+  ASSERT_GE(file, 0);
+  double displacement_z[4] = {0.0, 0.0, 0.0, 0.0};
+  ASSERT_EQ(ex_get_var(file, 2, EX_NODAL, 3, 1, 4, displacement_z), 0);
+  EXPECT_EQ(displacement_z[3], 0.5);
+  ex_close(file);
+  unlink("resumed_tet.exo");
+  unlink("resumed_tet.exo-s0002");
+}
+
+TEST(exodus, readBlocksAndNodeSetsAsMaterialsAndBoundaries)
+{
+  material_index mat(1);
+  material_index bnd(1);
+  input          in(mat, bnd);
+  state          st;
+  in.exodus_block_ids[material_index(0)]    = 1;
+  in.exodus_node_set_ids[material_index(1)] = 1;
+
+  ASSERT_EQ(read_exodus_file("cube.g", in, st), 0);
+
+  hpc::host_vector<material_index, element_index> host_material(st.material.size());
+  hpc::copy(st.material, host_material);
+  for (auto const material : host_material) EXPECT_EQ(material, material_index(0));
+
+  ASSERT_EQ(st.node_sets[material_index(1)].size(), 4);
+  hpc::host_vector<node_index, int> host_nodes(st.node_sets.items.size());
+  hpc::copy(st.node_sets.items, host_nodes);
+  int const first = st.node_sets.offsets[material_index(1)];
+  EXPECT_EQ(host_nodes[first + 0], node_index(1));
+  EXPECT_EQ(host_nodes[first + 1], node_index(6));
+  EXPECT_EQ(host_nodes[first + 2], node_index(7));
+  EXPECT_EQ(host_nodes[first + 3], node_index(8));
+}
+
+TEST(exodus, readSideSetNodesAsBoundary)
+{
+  material_index mat(1);
+  material_index bnd(1);
+  input          in(mat, bnd);
+  state          st;
+  in.exodus_block_ids[material_index(0)]    = 1;
+  in.exodus_side_set_ids[material_index(1)] = 1;
+
+  ASSERT_EQ(read_exodus_file("tets.g", in, st), 0);
+
+  // two triangular sides
+  auto const num_boundary_nodes = st.node_sets[material_index(1)].size();
+  EXPECT_GE(num_boundary_nodes, 3);
+  EXPECT_LE(num_boundary_nodes, 6);
+}
@@ -184,3 +184,121 @@ TEST(maxent, linear_reproducibility_3)
 
   ASSERT_LE(error, eps);
 }
+
+TEST(maxent, warm_start_matches_cold_start)
+{
+  lgr::state s;
+
+  two_tetrahedra_two_points(s);
+
+  auto const dx = hpc::position<double>(1.0e-4, -2.0e-4, 3.0e-4);
+  auto const xp = s.xp.begin();
+  for (auto const point : s.points) xp[point] = xp[point].load() + dx;
+
+  lgr::otm_update_shape_functions(s);
+  auto const warm_error = lgr_unit::compute_linear_reproducibility_error(s);
+  hpc::host_vector<hpc::basis_value<double>, lgr::point_node_index> warm_N(s.N.size());
+  hpc::copy(s.N, warm_N);
+
+  hpc::fill(hpc::device_policy(), s.mu, hpc::basis_gradient<double>::zero());
+  lgr::otm_update_shape_functions(s);
+  hpc::host_vector<hpc::basis_value<double>, lgr::point_node_index> cold_N(s.N.size());
+  hpc::copy(s.N, cold_N);
+
+  auto const eps = 1.0e-12;
+  ASSERT_LE(warm_error, hpc::machine_epsilon<double>());
+  for (auto const point_node : hpc::make_counting_range(s.N.size())) {
+    ASSERT_NEAR(warm_N[point_node], cold_N[point_node], eps);
+  }
+}
+
+TEST(maxent, lazy_update_keeps_shape_functions_of_resting_points)
+{
+  lgr::state s;
+
+  two_tetrahedra_two_points(s);
+
+  s.maxent_update_tolerance = 1.0e-4;
+  lgr::otm_update_shape_functions(s);
+  hpc::host_vector<hpc::basis_value<double>, lgr::point_node_index> old_N(s.N.size());
+  hpc::copy(s.N, old_N);
+
+  auto const xp = s.xp.begin();
+  xp[lgr::point_index(0)] = xp[lgr::point_index(0)].load() + hpc::position<double>(1.0e-6, 0.0, 0.0);
+  xp[lgr::point_index(1)] = xp[lgr::point_index(1)].load() + hpc::position<double>(1.0e-2, 0.0, 0.0);
+  lgr::otm_update_shape_functions(s);
+  hpc::host_vector<hpc::basis_value<double>, lgr::point_node_index> new_N(s.N.size());
+  hpc::copy(s.N, new_N);
+
+  auto const supports = s.points_to_point_nodes.cbegin();
+  for (auto const point_node : supports[lgr::point_index(0)]) { ASSERT_EQ(new_N[point_node], old_N[point_node]); }
+  auto changed = false;
+  for (auto const point_node : supports[lgr::point_index(1)]) { changed = changed || new_N[point_node] != old_N[point_node]; }
+  ASSERT_TRUE(changed);
+  ASSERT_LE(lgr_unit::compute_linear_reproducibility_error(s), 1.0e-6);
+}
+
+namespace lgr_unit {
+
+// one point inside a cubic lattice of nodes, all of them in its support
+inline void
+lattice_single_point(lgr::state& s, int const nodes_per_side)
+{
+  using NI              = lgr::node_index;
+  using PI              = lgr::point_index;
+  using PNI             = lgr::point_node_index;
+  auto const num_nodes  = NI(nodes_per_side * nodes_per_side * nodes_per_side);
+  auto const num_points = PI(1);
+
+  s.nodes.resize(num_nodes);
+  s.x.resize(num_nodes);
+  hpc::host_array_vector<hpc::position<double>, NI> host_x(num_nodes);
+  hpc::host_vector<NI, PNI>                         host_point_nodes_to_nodes(PNI(hpc::weaken(num_nodes)));
+  for (auto i = 0; i < num_nodes; ++i) {
+    auto const x                              = i % nodes_per_side;
+    auto const y                              = (i / nodes_per_side) % nodes_per_side;
+    auto const z                              = i / (nodes_per_side * nodes_per_side);
+    host_x.begin()[NI(i)]                     = hpc::position<double>(x, y, z);
+    host_point_nodes_to_nodes.begin()[PNI(i)] = NI(i);
+  }
+  hpc::copy(host_x, s.x);
+
+  s.points.resize(num_points);
+  s.xp.resize(num_points);
+  auto const center = 0.5 * (nodes_per_side - 1);
+  hpc::fill(hpc::device_policy(), s.xp, hpc::position<double>(center + 0.1, center - 0.2, center + 0.3));
+  hpc::device_vector<PNI, PI> support_sizes(num_points, PNI(hpc::weaken(num_nodes)));
+  s.points_to_point_nodes.assign_sizes(support_sizes);
+  s.point_nodes_to_nodes.resize(PNI(hpc::weaken(num_nodes)));
+  hpc::copy(host_point_nodes_to_nodes, s.point_nodes_to_nodes);
+  s.N.resize(PNI(hpc::weaken(num_nodes)));
+  s.grad_N.resize(PNI(hpc::weaken(num_nodes)));
+
+  double const gamma_otm = 1.5;
+  double const h         = 1.0;
+  s.otm_beta             = gamma_otm / (h * h);
+
+  lgr::otm_update_shape_functions(s);
+}
+
+}  // namespace lgr_unit
+
+TEST(maxent, partition_unity_and_linear_reproducibility_of_large_supports)
+{
+  // supports that fit the packed buffers and supports too large for them
+  for (auto const nodes_per_side : {4, 5}) {
+    lgr::state s;
+
+    lgr_unit::lattice_single_point(s, nodes_per_side);
+
+    double const init           = -1.0;
+    auto const   unity_error    = std::abs(hpc::reduce(hpc::device_policy(), s.N, init));
+    auto const   gradient_error = lgr_unit::compute_basis_gradient_error(s);
+    auto const   linear_error   = lgr_unit::compute_linear_reproducibility_error(s);
+    auto const   eps            = 64 * hpc::machine_epsilon<double>();
+
+    ASSERT_LE(unity_error, eps);
+    ASSERT_LE(gradient_error, eps);
+    ASSERT_LE(linear_error, 1.0e-10);
+  }
+}
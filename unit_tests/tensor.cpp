@@ -1,11 +1,13 @@
 #include <gtest/gtest.h>
 
 #include <hpc_matrix3x3.hpp>
+#include <hpc_symmetric3x3.hpp>
 #include <otm_util.hpp>
 
 using Real   = double;
 using Tensor = hpc::matrix3x3<Real>;
 using Vector = hpc::vector3<Real>;
+using Symm   = hpc::symmetric3x3<Real>;
 
 TEST(tensor, exp)
 {
@@ -83,6 +85,28 @@ TEST(tensor, solve)
   ASSERT_LE(error, tol);
 }
 
+TEST(tensor, solve_spd)
+{
+  auto const eps = hpc::machine_epsilon<Real>();
+  // Tolerance: see Golub & Van Loan, Matrix Computations 4th Ed., pp 122-123
+  auto const dim     = 3;
+  auto const tol     = 2 * (dim - 1) * eps;
+  auto const A       = Symm(8, 7, 6, 1, 2, 3);
+  auto const b       = Vector(1, 2, 4);
+  auto const c       = hpc::solve_spd(A, b);
+  auto const error_1 = hpc::norm(A * c - b) / hpc::norm(A);
+  ASSERT_LE(error_1, tol);
+  auto const B       = hpc::inverse_spd(A);
+  auto const I       = Tensor::identity();
+  auto const error_2 = hpc::norm(A * B - I) / hpc::norm(A);
+  ASSERT_LE(error_2, tol);
+  // Indefinite, so solved by full pivoting instead
+  auto const C       = Symm(1, -2, 3, 2, 1, 0);
+  auto const d       = hpc::solve_spd(C, b);
+  auto const error_3 = hpc::norm(C * d - b) / hpc::norm(C);
+  ASSERT_LE(error_3, tol);
+}
+
 TEST(tensor, sqrt)
 {
   auto const eps = hpc::machine_epsilon<Real>();
@@ -1,7 +1,15 @@
 #include <gtest/gtest.h>
 
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
 #include <lgr_input.hpp>
+#include <lgr_output_thread.hpp>
 #include <lgr_state.hpp>
+#include <lgr_xdmf.hpp>
 #include <otm_meshless.hpp>
 #include <otm_vtk.hpp>
 #include <unit_tests/otm_unit_mesh.hpp>
@@ -36,7 +44,149 @@ TEST(vtk, canPrintOtmStateToFile)
   ASSERT_EQ(writer.host_s.K.size(), s.K.size());
 
   writer.write(0);
+  writer.flush();
 
   unlink("tetrahedron_single_point_nodes_0.vtk");
   unlink("tetrahedron_single_point_points_0.vtk");
 }
+
+TEST(vtk, canPrintOtmStateToBinaryVtuFile)
+{
+  lgr::state s;
+  using MI = lgr::material_index;
+  lgr::input in(MI(0), MI(0));
+
+  tetrahedron_single_point(s);
+  lgr::otm_update_nodal_mass(s);
+  lgr::otm_allocate_state(in, s);
+
+  lgr::otm_file_writer writer("tetrahedron_single_point", lgr::VTU_BINARY);
+
+  writer.capture(s);
+  writer.write(0);
+  writer.flush();
+
+  std::ifstream node_file("tetrahedron_single_point_nodes_0.vtu", std::ios::binary);
+  ASSERT_TRUE(node_file.good());
+  std::string contents((std::istreambuf_iterator<char>(node_file)), std::istreambuf_iterator<char>());
+  EXPECT_NE(contents.find("NumberOfPoints=\"4\""), std::string::npos);
+  EXPECT_NE(contents.find("<AppendedData encoding=\"raw\">"), std::string::npos);
+  EXPECT_NE(contents.find("Name=\"node_mass\""), std::string::npos);
+
+  std::ifstream point_file("tetrahedron_single_point_points_0.vtu", std::ios::binary);
+  ASSERT_TRUE(point_file.good());
+
+  unlink("tetrahedron_single_point_nodes_0.vtu");
+  unlink("tetrahedron_single_point_points_0.vtu");
+}
+
+TEST(vtk, canWriteOtmStateToXdmfSeries)
+{
+  lgr::state s;
+  using MI = lgr::material_index;
+  lgr::input in(MI(0), MI(0));
+
+  tetrahedron_single_point(s);
+  lgr::otm_update_nodal_mass(s);
+  lgr::otm_allocate_state(in, s);
+
+  lgr::otm_file_writer writer("tetrahedron_single_point", lgr::XDMF_SERIES);
+
+  writer.capture(s);
+  writer.write(0);
+  writer.capture(s);
+  writer.write(1);
+  ++s.adapt_epoch;
+  writer.capture(s);
+  writer.write(2);
+  writer.flush();
+
+  std::ifstream index_file("tetrahedron_single_point_nodes.xdmf");
+  ASSERT_TRUE(index_file.good());
+  std::string contents((std::istreambuf_iterator<char>(index_file)), std::istreambuf_iterator<char>());
+  auto count = [&](std::string const& pattern) {
+    int n = 0;
+    for (auto i = contents.find(pattern); i != std::string::npos; i = contents.find(pattern, i + 1)) ++n;
+    return n;
+  };
+  auto topology_seek = [&](std::string::size_type const from) {
+    auto const topology = contents.find("<Topology ", from);
+    auto const seek     = contents.find("Seek=", topology);
+    return std::make_pair(topology, contents.substr(seek, contents.find(' ', seek) - seek));
+  };
+  EXPECT_EQ(count("<Time "), 3);
+  EXPECT_EQ(count("<Topology "), 3);
+  // the second step of an adapt epoch refers back to the topology of the first,
+  // the first step of the next epoch writes it again
+  auto const first  = topology_seek(0);
+  auto const second = topology_seek(first.first + 1);
+  auto const third  = topology_seek(second.first + 1);
+  EXPECT_EQ(first.second, second.second);
+  EXPECT_NE(second.second, third.second);
+  EXPECT_NE(contents.find("</Xdmf>"), std::string::npos);
+
+  unlink("tetrahedron_single_point_nodes.xdmf");
+  unlink("tetrahedron_single_point_nodes.bin");
+  unlink("tetrahedron_single_point_points.xdmf");
+  unlink("tetrahedron_single_point_points.bin");
+}
+
+namespace {
+
+inline void
+write_xdmf_test_step(lgr::xdmf_series& series, double const time)
+{
+  series.begin_step(time, 2, 0);
+  series.add_point_data("f", 1, std::vector<double>{time, time});
+  series.set_no_cells();
+  series.end_step();
+}
+
+}  // namespace
+
+TEST(vtk, xdmfSeriesResumesAfterTheRestartedStep)
+{
+  {
+    lgr::xdmf_series series("xdmf_resume");
+    for (double const time : {0.0, 1.0, 2.0}) write_xdmf_test_step(series, time);
+  }
+  // a restart from the checkpoint taken at time 1 drops the step at time 2 and appends after time 1
+  {
+    lgr::xdmf_series series("xdmf_resume");
+    series.resume(1.0);
+    write_xdmf_test_step(series, 1.5);
+  }
+  std::ifstream index_file("xdmf_resume.xdmf");
+  ASSERT_TRUE(index_file.good());
+  std::string contents((std::istreambuf_iterator<char>(index_file)), std::istreambuf_iterator<char>());
+  int times = 0;
+  for (auto i = contents.find("<Time "); i != std::string::npos; i = contents.find("<Time ", i + 1)) ++times;
+  EXPECT_EQ(times, 3);
+  EXPECT_NE(contents.find("1.50000000000000000e+00"), std::string::npos);
+  EXPECT_EQ(contents.find("2.00000000000000000e+00"), std::string::npos);
+  EXPECT_NE(contents.find("</Xdmf>"), std::string::npos);
+  // two steps of 2 doubles sharing 2 int64 vertex ids, then the resumed step writes both again
+  std::ifstream heavy_file("xdmf_resume.bin", std::ios::binary | std::ios::ate);
+  EXPECT_EQ(std::int64_t(heavy_file.tellg()), std::int64_t(3 * 16 + 2 * 16));
+
+  unlink("xdmf_resume.xdmf");
+  unlink("xdmf_resume.bin");
+}
+
+TEST(vtk, outputThreadRunsJobsOnOneWorkerAndRethrows)
+{
+  lgr::output_thread writer;
+  std::thread::id    first_worker;
+  std::thread::id    second_worker;
+  writer.submit([&]() { first_worker = std::this_thread::get_id(); });
+  writer.submit([&]() { second_worker = std::this_thread::get_id(); });
+  writer.wait();
+  EXPECT_EQ(first_worker, second_worker);
+  EXPECT_NE(first_worker, std::this_thread::get_id());
+  writer.submit([]() { throw std::runtime_error("disk full"); });
+  EXPECT_THROW(writer.wait(), std::runtime_error);
+  int frames = 0;
+  writer.submit([&]() { ++frames; });
+  writer.wait();
+  EXPECT_EQ(frames, 1);
+}